@@ -1,6 +1,9 @@
 #include "jni_bridge.hpp"
+#include "../../../../../jni/src/edge_worker.hpp"
 #include "../../../../../jni/src/opencv_pipeline.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <android/log.h>
 
@@ -8,34 +11,120 @@
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
 namespace {
-    std::vector<uint8_t> g_grayBuffer; // reused across calls
+    // Gray frame handed to Kotlin; valid until the next processGrayscale call.
+    edgeviewer::FrameArena g_grayFrame;
+
+    // Edge detection state per caller: color frames come from the render
+    // loop, luma frames from the camera's ImageReader thread, so each has its
+    // own pipeline and output buffer.
+    struct EdgeStream {
+        edgeviewer::EdgePipeline pipeline;
+        std::vector<uint8_t> output;
+    };
+    EdgeStream g_colorEdges;
+    EdgeStream g_lumaEdges;
+
+    // Camera frames handed to a worker thread. Replaced by the capture
+    // thread when the frame size or mode changes (through std::atomic_store,
+    // so the display thread never sees a half-built one); the display thread
+    // keeps the worker it last took a mask from alive until its next call,
+    // since the returned buffer points into that worker.
+    std::shared_ptr<edgeviewer::EdgeWorker> g_lumaWorker;
+    std::shared_ptr<edgeviewer::EdgeWorker> g_shownWorker;
+
+    // Camera frames up to this size gain more from running whole frames side
+    // by side (FramePolicy::Parallel) than from splitting each into bands;
+    // at most this many are in flight, each adding a frame of latency.
+    constexpr int kFrameParallelMaxPixels = 640 * 480;
+    constexpr int kMaxFramesInFlight = 3;
 }
 
 namespace edgeviewer_jni {
 
+// NativeBridge.PIXEL_* values are PixelFormat's enumerators in order.
+static bool toPixelFormat(int value, edgeviewer::PixelFormat& format) {
+    format = static_cast<edgeviewer::PixelFormat>(value);
+    if (value < 0 || edgeviewer::bytesPerPixel(format) == 0) {
+        LOGE("unknown pixel format %d", value);
+        return false;
+    }
+    return true;
+}
+
 void init(JNIEnv* /*env*/, jobject /*context*/) {
-    g_grayBuffer.clear();
+    g_grayFrame.release();
 }
 
 jobject processGrayscale(JNIEnv* env,
                          const uint8_t* rgba,
                          int width,
                          int height,
-                         int strideBytes) {
-    if (!rgba || width <= 0 || height <= 0) return nullptr;
+                         int strideBytes,
+                         int pixelFormat) {
+    edgeviewer::PixelFormat format;
+    if (!rgba || width <= 0 || height <= 0 || !toPixelFormat(pixelFormat, format)) return nullptr;
 
-    edgeviewer::ImageView src{rgba, width, height, strideBytes, 4};
+    edgeviewer::ImageView src{rgba, width, height, strideBytes, format};
     size_t outBytes = 0;
-    if (!edgeviewer::processGrayscale(src, nullptr, 0, outBytes)) {
-        g_grayBuffer.resize(outBytes);
-    }
+    edgeviewer::processGrayscale(src, nullptr, 0, outBytes);
+    // Uninitialized and cache-line aligned; after a size change the arena
+    // settles on a single block within two frames.
+    g_grayFrame.reset();
+    uint8_t* gray = g_grayFrame.allocate<uint8_t>(outBytes);
     size_t written = 0;
-    if (!edgeviewer::processGrayscale(src, g_grayBuffer.data(), g_grayBuffer.size(), written)) {
+    if (!edgeviewer::processGrayscale(src, gray, outBytes, written)) {
         LOGE("processGrayscale failed even after buffer alloc");
         return nullptr;
     }
 
-    return env->NewDirectByteBuffer(g_grayBuffer.data(), static_cast<jlong>(written));
+    return env->NewDirectByteBuffer(gray, static_cast<jlong>(written));
+}
+
+static edgeviewer::ThresholdParams autoThresholds(int mode) {
+    edgeviewer::ThresholdParams thresholds;
+    thresholds.mode = (mode == 1) ? edgeviewer::ThresholdMode::Median : edgeviewer::ThresholdMode::Otsu;
+    return thresholds;
+}
+
+// Runs `stream`'s pipeline on one frame and wraps its output buffer. The
+// pipeline is only rebuilt (and the buffer resized to its maxOutputBytes)
+// when the frame size or format changes, so steady frames allocate nothing
+// and need no size query. `chosen`, if given, receives the thresholds used.
+template <typename View>
+static jobject detectEdges(JNIEnv* env,
+                           EdgeStream& stream,
+                           const View& src,
+                           edgeviewer::EdgeMaskFormat format,
+                           const edgeviewer::ThresholdParams& thresholds,
+                           double* chosen) {
+    const edgeviewer::EdgePipelineConfig& current = stream.pipeline.config();
+    if (!stream.pipeline.isConfigured() || current.maxWidth != src.width || current.maxHeight != src.height ||
+        current.format != format) {
+        edgeviewer::EdgePipelineConfig config;
+        config.maxWidth = src.width;
+        config.maxHeight = src.height;
+        config.format = format;
+        config.thresholds = thresholds;
+        if (!stream.pipeline.configure(config)) {
+            LOGE("edge pipeline rejected a %dx%d frame", src.width, src.height);
+            return nullptr;
+        }
+        stream.output.resize(stream.pipeline.maxOutputBytes());
+    } else {
+        stream.pipeline.setThresholds(thresholds);
+    }
+
+    size_t written = 0;
+    if (!stream.pipeline.process(src, stream.output.data(), stream.output.size(), written)) {
+        LOGE("edge detection failed");
+        return nullptr;
+    }
+    if (chosen) {
+        chosen[0] = stream.pipeline.lastThresholds().low;
+        chosen[1] = stream.pipeline.lastThresholds().high;
+    }
+
+    return env->NewDirectByteBuffer(stream.output.data(), static_cast<jlong>(written));
 }
 
 jobject processCanny(JNIEnv* env,
@@ -43,22 +132,144 @@ jobject processCanny(JNIEnv* env,
                     int width,
                     int height,
                     int strideBytes,
+                    int pixelFormat,
                     double lowThresh,
                     double highThresh) {
-    if (!rgba || width <= 0 || height <= 0) return nullptr;
+    edgeviewer::PixelFormat format;
+    if (!rgba || width <= 0 || height <= 0 || !toPixelFormat(pixelFormat, format)) return nullptr;
 
-    edgeviewer::ImageView src{rgba, width, height, strideBytes, 4};
-    size_t outBytes = 0;
-    if (!edgeviewer::processCannyEdges(src, lowThresh, highThresh, nullptr, 0, outBytes)) {
-        g_grayBuffer.resize(outBytes);
-    }
+    edgeviewer::ImageView src{rgba, width, height, strideBytes, format};
+    return detectEdges(env, g_colorEdges, src, edgeviewer::EdgeMaskFormat::Bytes,
+                       edgeviewer::fixedThresholds(lowThresh, highThresh), nullptr);
+}
+
+jobject processLumaCanny(JNIEnv* env,
+                         const uint8_t* luma,
+                         int width,
+                         int height,
+                         int rowStride,
+                         int pixelStride,
+                         double lowThresh,
+                         double highThresh,
+                         bool packed) {
+    if (!luma || width <= 0 || height <= 0) return nullptr;
+
+    edgeviewer::PlaneView src{luma, width, height, rowStride, pixelStride};
+    const edgeviewer::EdgeMaskFormat format = packed ? edgeviewer::EdgeMaskFormat::Packed : edgeviewer::EdgeMaskFormat::Bytes;
+    return detectEdges(env, g_lumaEdges, src, format, edgeviewer::fixedThresholds(lowThresh, highThresh), nullptr);
+}
+
+jobject processCannyAuto(JNIEnv* env,
+                         const uint8_t* rgba,
+                         int width,
+                         int height,
+                         int strideBytes,
+                         int pixelFormat,
+                         int mode,
+                         double chosen[2]) {
+    edgeviewer::PixelFormat format;
+    if (!rgba || width <= 0 || height <= 0 || !toPixelFormat(pixelFormat, format)) return nullptr;
+
+    edgeviewer::ImageView src{rgba, width, height, strideBytes, format};
+    return detectEdges(env, g_colorEdges, src, edgeviewer::EdgeMaskFormat::Bytes, autoThresholds(mode), chosen);
+}
+
+jobject processLumaCannyAuto(JNIEnv* env,
+                             const uint8_t* luma,
+                             int width,
+                             int height,
+                             int rowStride,
+                             int pixelStride,
+                             int mode,
+                             double chosen[2]) {
+    if (!luma || width <= 0 || height <= 0) return nullptr;
+
+    edgeviewer::PlaneView src{luma, width, height, rowStride, pixelStride};
+    return detectEdges(env, g_lumaEdges, src, edgeviewer::EdgeMaskFormat::Bytes, autoThresholds(mode), chosen);
+}
+
+bool yuv420ToRgba(const uint8_t* y, int yRowStride, int yPixelStride,
+                  const uint8_t* u, int uRowStride, int uPixelStride,
+                  const uint8_t* v, int vRowStride, int vPixelStride,
+                  int width,
+                  int height,
+                  uint8_t* outRgba,
+                  size_t outSize) {
+    if (!y || !u || !v || !outRgba || width <= 0 || height <= 0) return false;
+
+    const int chromaW = (width + 1) / 2;
+    const int chromaH = (height + 1) / 2;
+    edgeviewer::Yuv420View src{
+        {y, width, height, yRowStride, yPixelStride},
+        {u, chromaW, chromaH, uRowStride, uPixelStride},
+        {v, chromaW, chromaH, vRowStride, vPixelStride},
+    };
     size_t written = 0;
-    if (!edgeviewer::processCannyEdges(src, lowThresh, highThresh, g_grayBuffer.data(), g_grayBuffer.size(), written)) {
-        LOGE("processCanny failed even after buffer alloc");
-        return nullptr;
+    return edgeviewer::convertYuv420ToRgba(src, outRgba, outSize, written);
+}
+
+bool submitLumaFrame(const uint8_t* luma,
+                     int width,
+                     int height,
+                     int rowStride,
+                     int pixelStride,
+                     int64_t timestampNs,
+                     int mode) {
+    if (!luma || width <= 0 || height <= 0) return false;
+
+    std::shared_ptr<edgeviewer::EdgeWorker> worker = std::atomic_load(&g_lumaWorker);
+    const edgeviewer::ThresholdParams thresholds = autoThresholds(mode);
+    if (!worker || worker->config().maxWidth != width || worker->config().maxHeight != height ||
+        worker->config().thresholds.mode != thresholds.mode) {
+        edgeviewer::EdgePipelineConfig config;
+        config.maxWidth = width;
+        config.maxHeight = height;
+        config.thresholds = thresholds;
+        const int threads = edgeviewer::workerThreadCount();
+        const bool frameParallel = threads > 1 && width * height <= kFrameParallelMaxPixels;
+        worker = std::make_shared<edgeviewer::EdgeWorker>();
+        if (!worker->start(config, frameParallel ? edgeviewer::FramePolicy::Parallel : edgeviewer::FramePolicy::Latest,
+                           static_cast<size_t>(std::min(threads, kMaxFramesInFlight)))) {
+            LOGE("edge worker rejected a %dx%d frame", width, height);
+            return false;
+        }
+        std::atomic_store(&g_lumaWorker, worker);
     }
+    edgeviewer::PlaneView src{luma, width, height, rowStride, pixelStride};
+    return worker->submit(src, timestampNs);
+}
+
+jobject takeLumaEdges(JNIEnv* env, int size[2], double chosen[2]) {
+    g_shownWorker = std::atomic_load(&g_lumaWorker);
+    if (!g_shownWorker) return nullptr;
+    const edgeviewer::EdgeFrame* frame = g_shownWorker->takeLatest();
+    if (!frame) return nullptr;
+    size[0] = frame->width;
+    size[1] = frame->height;
+    chosen[0] = frame->thresholds.low;
+    chosen[1] = frame->thresholds.high;
+    return env->NewDirectByteBuffer(const_cast<uint8_t*>(frame->mask.data()), static_cast<jlong>(frame->bytes));
+}
+
+bool lumaWorkerStats(uint64_t counts[6]) {
+    const std::shared_ptr<edgeviewer::EdgeWorker> worker = std::atomic_load(&g_lumaWorker);
+    if (!worker) return false;
+    const edgeviewer::EdgeWorkerStats stats = worker->stats();
+    counts[0] = stats.received;
+    counts[1] = stats.dropped;
+    counts[2] = stats.failed;
+    counts[3] = stats.processed;
+    counts[4] = stats.superseded;
+    counts[5] = stats.displayed;
+    return true;
+}
+
+void stopLumaWorker() {
+    std::atomic_store(&g_lumaWorker, std::shared_ptr<edgeviewer::EdgeWorker>());
+}
 
-    return env->NewDirectByteBuffer(g_grayBuffer.data(), static_cast<jlong>(written));
+void setWorkerThreads(int threads) {
+    edgeviewer::setWorkerThreadCount(threads);
 }
 
 } // namespace edgeviewer_jni
@@ -9,13 +9,18 @@ namespace edgeviewer_jni {
 // Initialize any native singletons/resources if needed
 void init(JNIEnv* env, jobject context);
 
-// Process an RGBA image buffer to grayscale; returns a direct ByteBuffer (read-only) if succeed,
+// The color entry points take interleaved pixels in any edgeviewer::PixelFormat
+// (`pixelFormat` is its enumerator index, NativeBridge.PIXEL_*), so callers pass
+// Bitmap or camera bytes as they are, without reordering channels first.
+
+// Process a color image buffer to grayscale; returns a direct ByteBuffer (read-only) if succeed,
 // or null on failure. The buffer is owned by native code and is valid until the next call.
 jobject processGrayscale(JNIEnv* env,
                          const uint8_t* rgba,
                          int width,
                          int height,
-                         int strideBytes);
+                         int strideBytes,
+                         int pixelFormat);
 
 // Process with Canny and return a direct ByteBuffer (single-channel mask)
 jobject processCanny(JNIEnv* env,
@@ -23,9 +28,85 @@ jobject processCanny(JNIEnv* env,
                     int width,
                     int height,
                     int strideBytes,
+                    int pixelFormat,
                     double lowThresh,
                     double highThresh);
 
+// Process Canny directly on an 8-bit luma plane (e.g. the Y plane of a YUV_420_888 image)
+// and return a direct ByteBuffer (single-channel mask). With `packed`, the mask is
+// 1 bit per pixel, rows padded to 64 bits (see jni/src/edge_mask.hpp): 8x smaller.
+jobject processLumaCanny(JNIEnv* env,
+                         const uint8_t* luma,
+                         int width,
+                         int height,
+                         int rowStride,
+                         int pixelStride,
+                         double lowThresh,
+                         double highThresh,
+                         bool packed = false);
+
+// processCanny / processLumaCanny with thresholds picked per frame from the
+// image itself: mode 1 = median sigma rule, 2 = Otsu on the gradient
+// magnitudes (see jni/src/auto_threshold.hpp). The pair used is written to
+// chosen[0] (low) and chosen[1] (high).
+jobject processCannyAuto(JNIEnv* env,
+                         const uint8_t* rgba,
+                         int width,
+                         int height,
+                         int strideBytes,
+                         int pixelFormat,
+                         int mode,
+                         double chosen[2]);
+
+jobject processLumaCannyAuto(JNIEnv* env,
+                             const uint8_t* luma,
+                             int width,
+                             int height,
+                             int rowStride,
+                             int pixelStride,
+                             int mode,
+                             double chosen[2]);
+
+// Convert a YUV_420_888 image (any row/pixel strides: I420, NV12, NV21) into a
+// caller-owned packed RGBA buffer. Returns false if the buffer is too small.
+bool yuv420ToRgba(const uint8_t* y, int yRowStride, int yPixelStride,
+                  const uint8_t* u, int uRowStride, int uPixelStride,
+                  const uint8_t* v, int vRowStride, int vPixelStride,
+                  int width,
+                  int height,
+                  uint8_t* outRgba,
+                  size_t outSize);
+
+// Camera luma frames processed off the capture thread (jni/src/edge_worker.hpp).
+// submitLumaFrame copies the plane into the mailbox of a native worker, started
+// or restarted for the frame size and threshold mode (as in processLumaCannyAuto);
+// a frame the worker has not started on yet is replaced, so it always works on the
+// newest one. Frames up to 640x480 on a multi-core pool instead run up to three at
+// a time, one per thread, and are published in capture order; a frame arriving
+// while all are busy is dropped. Call it from one thread only.
+bool submitLumaFrame(const uint8_t* luma,
+                     int width,
+                     int height,
+                     int rowStride,
+                     int pixelStride,
+                     int64_t timestampNs,
+                     int mode);
+
+// The newest mask the worker finished since the last call, or null. Its size goes
+// to size[0] (width) and size[1] (height), its thresholds to chosen[]. The buffer is
+// valid until the next call; call it from one thread only (the display loop).
+jobject takeLumaEdges(JNIEnv* env, int size[2], double chosen[2]);
+
+// The worker's EdgeWorkerStats since it (re)started, in declaration order: received,
+// dropped, failed, processed, superseded, displayed. False when no worker runs.
+bool lumaWorkerStats(uint64_t counts[6]);
+
+// Stops the worker once the display has let go of its last mask.
+void stopLumaWorker();
+
+// Set the number of native worker threads used for processing (0 = one per core)
+void setWorkerThreads(int threads);
+
 }
 
 
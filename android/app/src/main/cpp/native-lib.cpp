@@ -61,10 +61,11 @@ Java_com_example_edgeviewer_NativeBridge_processGrayscale(
         jbyteArray rgbaBuffer,
         jint width,
         jint height,
-        jint strideBytes) {
+        jint strideBytes,
+        jint pixelFormat) {
     jsize len = env->GetArrayLength(rgbaBuffer);
     jbyte* ptr = env->GetByteArrayElements(rgbaBuffer, nullptr);
-    jobject result = edgeviewer_jni::processGrayscale(env, reinterpret_cast<const uint8_t*>(ptr), width, height, strideBytes);
+    jobject result = edgeviewer_jni::processGrayscale(env, reinterpret_cast<const uint8_t*>(ptr), width, height, strideBytes, pixelFormat);
     env->ReleaseByteArrayElements(rgbaBuffer, ptr, JNI_ABORT);
     return result;
 }
@@ -77,12 +78,198 @@ Java_com_example_edgeviewer_NativeBridge_processCanny(
         jint width,
         jint height,
         jint strideBytes,
+        jint pixelFormat,
         jdouble lowThresh,
         jdouble highThresh) {
     jbyte* ptr = env->GetByteArrayElements(rgbaBuffer, nullptr);
-    jobject result = edgeviewer_jni::processCanny(env, reinterpret_cast<const uint8_t*>(ptr), width, height, strideBytes, lowThresh, highThresh);
+    jobject result = edgeviewer_jni::processCanny(env, reinterpret_cast<const uint8_t*>(ptr), width, height, strideBytes, pixelFormat, lowThresh, highThresh);
     env->ReleaseByteArrayElements(rgbaBuffer, ptr, JNI_ABORT);
     return result;
 }
 
 
+
+// Address of a direct ByteBuffer holding a plane of `width` x `height` samples
+// with the given strides, or null if the buffer is not direct or too small.
+static const uint8_t* planeAddress(JNIEnv* env, jobject buffer, int width, int height, int rowStride, int pixelStride) {
+    if (!buffer || rowStride <= 0 || pixelStride <= 0) return nullptr;
+    const uint8_t* data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+    if (!data) return nullptr;
+    const jlong lastByte = static_cast<jlong>(height - 1) * rowStride + static_cast<jlong>(width - 1) * pixelStride;
+    return (lastByte < env->GetDirectBufferCapacity(buffer)) ? data : nullptr;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_edgeviewer_NativeBridge_processLumaCanny(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jobject lumaBuffer,
+        jint width,
+        jint height,
+        jint rowStride,
+        jint pixelStride,
+        jdouble lowThresh,
+        jdouble highThresh) {
+    if (width <= 0 || height <= 0) return nullptr;
+    const uint8_t* luma = planeAddress(env, lumaBuffer, width, height, rowStride, pixelStride);
+    if (!luma) return nullptr;
+    return edgeviewer_jni::processLumaCanny(env, luma, width, height, rowStride, pixelStride, lowThresh, highThresh);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_edgeviewer_NativeBridge_processLumaCannyPacked(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jobject lumaBuffer,
+        jint width,
+        jint height,
+        jint rowStride,
+        jint pixelStride,
+        jdouble lowThresh,
+        jdouble highThresh) {
+    if (width <= 0 || height <= 0) return nullptr;
+    const uint8_t* luma = planeAddress(env, lumaBuffer, width, height, rowStride, pixelStride);
+    if (!luma) return nullptr;
+    return edgeviewer_jni::processLumaCanny(env, luma, width, height, rowStride, pixelStride, lowThresh, highThresh, true);
+}
+
+// Copies the thresholds an auto call used into a Kotlin DoubleArray of size >= 2.
+static void storeThresholds(JNIEnv* env, jdoubleArray out, const double chosen[2]) {
+    if (out && env->GetArrayLength(out) >= 2) {
+        env->SetDoubleArrayRegion(out, 0, 2, chosen);
+    }
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_edgeviewer_NativeBridge_processCannyAuto(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jbyteArray rgbaBuffer,
+        jint width,
+        jint height,
+        jint strideBytes,
+        jint pixelFormat,
+        jint mode,
+        jdoubleArray outThresholds) {
+    double chosen[2] = {0.0, 0.0};
+    jbyte* ptr = env->GetByteArrayElements(rgbaBuffer, nullptr);
+    jobject result = edgeviewer_jni::processCannyAuto(env, reinterpret_cast<const uint8_t*>(ptr), width, height, strideBytes, pixelFormat, mode, chosen);
+    env->ReleaseByteArrayElements(rgbaBuffer, ptr, JNI_ABORT);
+    if (result) storeThresholds(env, outThresholds, chosen);
+    return result;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_edgeviewer_NativeBridge_processLumaCannyAuto(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jobject lumaBuffer,
+        jint width,
+        jint height,
+        jint rowStride,
+        jint pixelStride,
+        jint mode,
+        jdoubleArray outThresholds) {
+    if (width <= 0 || height <= 0) return nullptr;
+    const uint8_t* luma = planeAddress(env, lumaBuffer, width, height, rowStride, pixelStride);
+    if (!luma) return nullptr;
+    double chosen[2] = {0.0, 0.0};
+    jobject result = edgeviewer_jni::processLumaCannyAuto(env, luma, width, height, rowStride, pixelStride, mode, chosen);
+    if (result) storeThresholds(env, outThresholds, chosen);
+    return result;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_edgeviewer_NativeBridge_yuv420ToRgba(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jobject yBuffer, jint yRowStride, jint yPixelStride,
+        jobject uBuffer, jint uRowStride, jint uPixelStride,
+        jobject vBuffer, jint vRowStride, jint vPixelStride,
+        jint width,
+        jint height,
+        jbyteArray outRgba) {
+    if (width <= 0 || height <= 0) return JNI_FALSE;
+    const int chromaW = (width + 1) / 2;
+    const int chromaH = (height + 1) / 2;
+    const uint8_t* y = planeAddress(env, yBuffer, width, height, yRowStride, yPixelStride);
+    const uint8_t* u = planeAddress(env, uBuffer, chromaW, chromaH, uRowStride, uPixelStride);
+    const uint8_t* v = planeAddress(env, vBuffer, chromaW, chromaH, vRowStride, vPixelStride);
+    if (!y || !u || !v) return JNI_FALSE;
+
+    const jsize outLen = env->GetArrayLength(outRgba);
+    void* out = env->GetPrimitiveArrayCritical(outRgba, nullptr);
+    if (!out) return JNI_FALSE;
+    const bool ok = edgeviewer_jni::yuv420ToRgba(y, yRowStride, yPixelStride,
+                                                 u, uRowStride, uPixelStride,
+                                                 v, vRowStride, vPixelStride,
+                                                 width, height,
+                                                 static_cast<uint8_t*>(out), static_cast<size_t>(outLen));
+    env->ReleasePrimitiveArrayCritical(outRgba, out, 0);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_edgeviewer_NativeBridge_submitLumaFrame(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jobject lumaBuffer,
+        jint width,
+        jint height,
+        jint rowStride,
+        jint pixelStride,
+        jlong timestampNs,
+        jint mode) {
+    if (width <= 0 || height <= 0) return JNI_FALSE;
+    const uint8_t* luma = planeAddress(env, lumaBuffer, width, height, rowStride, pixelStride);
+    if (!luma) return JNI_FALSE;
+    return edgeviewer_jni::submitLumaFrame(luma, width, height, rowStride, pixelStride, timestampNs, mode)
+               ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_edgeviewer_NativeBridge_takeLumaEdges(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jintArray outSize,
+        jdoubleArray outThresholds) {
+    if (!outSize || env->GetArrayLength(outSize) < 2) return nullptr;
+    int size[2] = {0, 0};
+    double chosen[2] = {0.0, 0.0};
+    jobject result = edgeviewer_jni::takeLumaEdges(env, size, chosen);
+    if (result) {
+        const jint sizeOut[2] = {size[0], size[1]};
+        env->SetIntArrayRegion(outSize, 0, 2, sizeOut);
+        storeThresholds(env, outThresholds, chosen);
+    }
+    return result;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_edgeviewer_NativeBridge_lumaWorkerStats(
+        JNIEnv* env,
+        jobject /* thiz */,
+        jlongArray outCounts) {
+    if (!outCounts || env->GetArrayLength(outCounts) < 6) return JNI_FALSE;
+    uint64_t counts[6];
+    if (!edgeviewer_jni::lumaWorkerStats(counts)) return JNI_FALSE;
+    jlong values[6];
+    for (int i = 0; i < 6; ++i) values[i] = static_cast<jlong>(counts[i]);
+    env->SetLongArrayRegion(outCounts, 0, 6, values);
+    return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_edgeviewer_NativeBridge_stopLumaWorker(
+        JNIEnv* /* env */,
+        jobject /* thiz */) {
+    edgeviewer_jni::stopLumaWorker();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_edgeviewer_NativeBridge_setWorkerThreads(
+        JNIEnv* /* env */,
+        jobject /* thiz */,
+        jint threads) {
+    edgeviewer_jni::setWorkerThreads(threads);
+}
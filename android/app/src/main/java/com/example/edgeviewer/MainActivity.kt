@@ -35,11 +35,16 @@ class MainActivity : ComponentActivity() {
     private lateinit var cameraController: Camera2Controller
     private var renderHandler: Handler? = null
     private val fpsMeter = FpsMeter()
+    // Low/high Canny thresholds the last camera mask ran with
+    private val readerThresholds = DoubleArray(2)
+    // Native camera worker counters (NativeBridge.STAT_*)
+    private val workerStats = LongArray(6)
+    // Size of the last camera mask taken from the native worker
+    private val readerSize = IntArray(2)
     private var rendering = false
     private var useCanny = true
     private var frameCounter = 0
     private var imageReader: ImageReader? = null
-    private var rgbaBuffer: ByteArray? = null
     private var lastFrameW: Int = 0
     private var lastFrameH: Int = 0
 
@@ -123,33 +128,30 @@ class MainActivity : ComponentActivity() {
                     val w = if (textureView.width > 0) textureView.width else 1280
                     val h = if (textureView.height > 0) textureView.height else 720
                     imageReader = ImageReader.newInstance(w, h, ImageFormat.YUV_420_888, 3)
-                    rgbaBuffer = ByteArray(w * h * 4)
                     lastFrameW = w
                     lastFrameH = h
 
                     imageReader?.setOnImageAvailableListener({ reader ->
                         val image = reader.acquireLatestImage() ?: return@setOnImageAvailableListener
-                        // Realloc and resize GL if frame size changes (some devices adjust stream size)
+                        // Resize GL if frame size changes (some devices adjust stream size)
                         val width = image.width
                         val height = image.height
                         if (width != lastFrameW || height != lastFrameH) {
-                            rgbaBuffer = ByteArray(width * height * 4)
                             lastFrameW = width
                             lastFrameH = height
                             try { GLBridge.resize(width, height) } catch (_: Throwable) {}
                         }
-                        val rgba = rgbaBuffer ?: run { image.close(); return@setOnImageAvailableListener }
-                        val ok = com.example.edgeviewer.processing.YuvUtils.yuv420ToRgba(image, rgba)
+                        // The Y plane already is the luma image: hand it to the native edge
+                        // worker, which copies it and runs Canny on its own thread, so capture
+                        // never waits for a slow frame. The render loop shows the result.
+                        val yPlane = image.planes[0]
+                        try {
+                            // Thresholds follow the scene (Otsu on the gradient magnitudes)
+                            NativeBridge.submitLumaFrame(yPlane.buffer, width, height,
+                                yPlane.rowStride, yPlane.pixelStride, image.timestamp,
+                                NativeBridge.THRESHOLD_OTSU)
+                        } catch (_: Throwable) {}
                         image.close()
-                        if (ok) {
-                            val buffer: ByteBuffer? = try {
-                                // Stronger thresholds to match the crisp web result
-                                NativeBridge.processCanny(rgba, width, height, width * 4, 80.0, 200.0)
-                            } catch (_: Throwable) { null }
-                            if (buffer != null) {
-                                try { GLBridge.uploadGrayTexture(buffer, width, height) } catch (_: Throwable) {}
-                            }
-                        }
                     }, cameraController.getBackgroundHandler())
 
                     val readerSurface = imageReader!!.surface
@@ -177,31 +179,30 @@ class MainActivity : ComponentActivity() {
         val loop = object : Runnable {
             override fun run() {
                 if (!rendering) return
-                // Try to grab a frame from TextureView, process edges/gray via JNI, upload to GL
-                val textureView = findViewById<TextureView>(R.id.textureView)
-                val w = textureView.width
-                val h = textureView.height
-                if (w > 0 && h > 0) {
-                    frameCounter += 1
-                    val rgba = FrameProcessor.captureRgba(textureView)
-                    if (rgba != null) {
-                        // Occasionally send a JPEG to the local web server (every ~60 frames)
-                        if (frameCounter % 60 == 0) {
-                            try { sendFrameToWeb(textureView) } catch (_: Exception) {}
-                        }
-                        val buffer: ByteBuffer? = try {
-                            NativeBridge.processCanny(rgba, w, h, w * 4, 50.0, 150.0)
-                        } catch (_: Throwable) {
-                            null
-                        }
-                        if (buffer != null) {
-                            try { GLBridge.uploadGrayTexture(buffer, w, h) } catch (_: Throwable) {}
-                        }
-                    }
+                // Show the newest camera mask the native worker finished since the last
+                // tick; edges are only computed on camera frames, never on the view.
+                val cameraEdges: ByteBuffer? = try {
+                    NativeBridge.takeLumaEdges(readerSize, readerThresholds)
+                } catch (_: Throwable) { null }
+                if (cameraEdges != null) {
+                    try { GLBridge.uploadGrayTexture(cameraEdges, readerSize[0], readerSize[1]) } catch (_: Throwable) {}
+                    fpsMeter.tick()
+                }
+                // Occasionally send a JPEG to the local web server (every ~60 ticks)
+                frameCounter += 1
+                if (frameCounter % 60 == 0) {
+                    try { sendFrameToWeb(findViewById(R.id.textureView)) } catch (_: Exception) {}
                 }
                 try { GLBridge.renderFrame() } catch (_: Throwable) {}
-                val fps = fpsMeter.tick()
-                if (fps > 0.0) statusText.text = "FPS: ${"%.1f".format(fps)}"
+                val fps = fpsMeter.getFps()
+                if (fps > 0.0 && NativeBridge.lumaWorkerStats(workerStats)) {
+                    statusText.text = "FPS: ${"%.1f".format(fps)} | Canny " +
+                        "${readerThresholds[0].toInt()}/${readerThresholds[1].toInt()}\n" +
+                        "in ${workerStats[NativeBridge.STAT_RECEIVED]} " +
+                        "dropped ${workerStats[NativeBridge.STAT_DROPPED]} " +
+                        "done ${workerStats[NativeBridge.STAT_PROCESSED]} " +
+                        "shown ${workerStats[NativeBridge.STAT_DISPLAYED]}"
+                }
                 renderHandler?.postDelayed(this, 16L)
             }
         }
@@ -253,6 +254,7 @@ class MainActivity : ComponentActivity() {
         renderHandler?.removeCallbacksAndMessages(null)
         cameraController.close()
         cameraController.stopBackgroundThread()
+        try { NativeBridge.stopLumaWorker() } catch (_: Throwable) {}
     }
 
     override fun onDestroy() {
@@ -1,21 +1,128 @@
 package com.example.edgeviewer
 
 object NativeBridge {
+    const val THRESHOLD_MEDIAN = 1
+    const val THRESHOLD_OTSU = 2
+
+    // Byte order of the pixels passed to the color entry points
+    // (edgeviewer::PixelFormat in jni/src/luma_kernels.hpp, same order)
+    const val PIXEL_RGBA = 0
+    const val PIXEL_BGRA = 1
+    const val PIXEL_ARGB = 2
+    const val PIXEL_RGB = 3
+    const val PIXEL_BGR = 4
+    const val PIXEL_RGBX = 5
+
     external fun processGrayscale(
-        rgbaBuffer: ByteArray,
+        pixels: ByteArray,
         width: Int,
         height: Int,
-        strideBytes: Int
+        strideBytes: Int,
+        pixelFormat: Int
     ): java.nio.ByteBuffer?
 
     external fun processCanny(
-        rgbaBuffer: ByteArray,
+        pixels: ByteArray,
         width: Int,
         height: Int,
         strideBytes: Int,
+        pixelFormat: Int,
+        lowThresh: Double,
+        highThresh: Double
+    ): java.nio.ByteBuffer?
+
+    // Canny straight on a luma plane (direct ByteBuffer, e.g. Image.planes[0].buffer)
+    external fun processLumaCanny(
+        lumaBuffer: java.nio.ByteBuffer,
+        width: Int,
+        height: Int,
+        rowStride: Int,
+        pixelStride: Int,
         lowThresh: Double,
         highThresh: Double
     ): java.nio.ByteBuffer?
+
+    // Same as processLumaCanny, but the mask is 1 bit per pixel (LSB first),
+    // each row padded to a multiple of 8 bytes: ((width + 63) / 64) * 8 bytes per row
+    external fun processLumaCannyPacked(
+        lumaBuffer: java.nio.ByteBuffer,
+        width: Int,
+        height: Int,
+        rowStride: Int,
+        pixelStride: Int,
+        lowThresh: Double,
+        highThresh: Double
+    ): java.nio.ByteBuffer?
+
+    // Canny with thresholds picked per frame from the image (mode THRESHOLD_MEDIAN
+    // or THRESHOLD_OTSU, see jni/src/auto_threshold.hpp); the pair used is
+    // written to outThresholds[0] (low) and [1] (high)
+    external fun processCannyAuto(
+        pixels: ByteArray,
+        width: Int,
+        height: Int,
+        strideBytes: Int,
+        pixelFormat: Int,
+        mode: Int,
+        outThresholds: DoubleArray
+    ): java.nio.ByteBuffer?
+
+    external fun processLumaCannyAuto(
+        lumaBuffer: java.nio.ByteBuffer,
+        width: Int,
+        height: Int,
+        rowStride: Int,
+        pixelStride: Int,
+        mode: Int,
+        outThresholds: DoubleArray
+    ): java.nio.ByteBuffer?
+
+    // YUV_420_888 planes (direct ByteBuffers, any strides) -> packed RGBA in outRgba
+    external fun yuv420ToRgba(
+        yBuffer: java.nio.ByteBuffer, yRowStride: Int, yPixelStride: Int,
+        uBuffer: java.nio.ByteBuffer, uRowStride: Int, uPixelStride: Int,
+        vBuffer: java.nio.ByteBuffer, vRowStride: Int, vPixelStride: Int,
+        width: Int,
+        height: Int,
+        outRgba: ByteArray
+    ): Boolean
+
+    // Camera frames processed on a native thread instead of the caller's: the
+    // luma plane is copied into a preallocated mailbox slot and the caller can
+    // release the Image right away. A frame still waiting there is replaced, so
+    // the worker always runs on the newest one. mode as for processLumaCannyAuto.
+    // Call from one thread (the ImageReader's).
+    external fun submitLumaFrame(
+        lumaBuffer: java.nio.ByteBuffer,
+        width: Int,
+        height: Int,
+        rowStride: Int,
+        pixelStride: Int,
+        timestampNs: Long,
+        mode: Int
+    ): Boolean
+
+    // Newest mask finished since the last call, or null; its width and height go
+    // to outSize[0..1] and its thresholds to outThresholds[0..1]. Valid until the
+    // next call. Call from one thread (the render loop).
+    external fun takeLumaEdges(outSize: IntArray, outThresholds: DoubleArray): java.nio.ByteBuffer?
+
+    // Indices into lumaWorkerStats' array (edgeviewer::EdgeWorkerStats)
+    const val STAT_RECEIVED = 0
+    const val STAT_DROPPED = 1    // replaced by a newer frame before processing
+    const val STAT_FAILED = 2
+    const val STAT_PROCESSED = 3
+    const val STAT_SUPERSEDED = 4 // mask replaced by a newer one before display
+    const val STAT_DISPLAYED = 5
+
+    // Frame counters of the camera worker since it started (6 entries, STAT_*);
+    // false when no worker is running
+    external fun lumaWorkerStats(outCounts: LongArray): Boolean
+
+    external fun stopLumaWorker()
+
+    // Native worker threads for frame processing; 0 = one per CPU core
+    external fun setWorkerThreads(threads: Int)
 }
 
 
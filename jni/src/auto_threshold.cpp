@@ -0,0 +1,76 @@
+#include "auto_threshold.hpp"
+
+#include <cstring>
+
+namespace edgeviewer {
+
+void HistogramAccumulator::clear() {
+    std::memset(counts_, 0, sizeof(counts_));
+}
+
+void HistogramAccumulator::addRow(const uint8_t* row, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        ++counts_[0][row[x]];
+        ++counts_[1][row[x + 1]];
+        ++counts_[2][row[x + 2]];
+        ++counts_[3][row[x + 3]];
+    }
+    for (; x < width; ++x) {
+        ++counts_[0][row[x]];
+    }
+}
+
+void HistogramAccumulator::flush(Histogram& out) {
+    for (int i = 0; i < 256; ++i) {
+        out[i] += counts_[0][i] + counts_[1][i] + counts_[2][i] + counts_[3][i];
+    }
+    clear();
+}
+
+void addHistogram(const Histogram& src, Histogram& dst) {
+    for (int i = 0; i < 256; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+int histogramMedian(const Histogram& hist) {
+    uint64_t total = 0;
+    for (uint32_t count : hist) total += count;
+    if (total == 0) return 0;
+    uint64_t seen = 0;
+    for (int i = 0; i < 256; ++i) {
+        seen += hist[i];
+        if (2 * seen >= total) return i;
+    }
+    return 255;
+}
+
+int otsuThreshold(const Histogram& hist, int first, int last) {
+    double total = 0.0, weighted = 0.0;
+    for (int i = first; i <= last; ++i) {
+        total += hist[i];
+        weighted += static_cast<double>(i) * hist[i];
+    }
+
+    // Maximize w0 * w1 * (mu0 - mu1)^2 over the split point.
+    int best = first - 1;
+    double bestScore = 0.0;
+    double w0 = 0.0, sum0 = 0.0;
+    for (int t = first; t < last; ++t) {
+        w0 += hist[t];
+        sum0 += static_cast<double>(t) * hist[t];
+        const double w1 = total - w0;
+        if (w0 == 0.0) continue;
+        if (w1 == 0.0) break;
+        const double diff = sum0 / w0 - (weighted - sum0) / w1;
+        const double score = w0 * w1 * diff * diff;
+        if (score > bestScore) {
+            bestScore = score;
+            best = t;
+        }
+    }
+    return best;
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace edgeviewer {
+
+// How the Canny paths get their thresholds.
+//  Fixed:  lowThreshold / highThreshold as given.
+//  Median: the sigma rule on the median m of the smoothed gray image,
+//          low = (1 - sigma) * m and high = (1 + sigma) * m.
+//  Otsu:   high is Otsu's split of the gradient magnitudes of the edge
+//          candidates (the pixels left after non-maximum suppression),
+//          low = lowRatio * high.
+// The automatic modes build their histogram inside the detection pass and
+// pick thresholds on a 2-unit magnitude grid from kMinAutoThreshold (a
+// two-gray-level step; weaker gradients are sensor noise) to
+// kMaxAutoThreshold, see canny.hpp. The result equals a fixed-threshold run
+// with the reported pair.
+enum class ThresholdMode {
+    Fixed,
+    Median,
+    Otsu,
+};
+
+// Fixed by default; the automatic modes are opt-in.
+struct ThresholdParams {
+    ThresholdMode mode = ThresholdMode::Fixed;
+    double low = 50.0;      // Fixed
+    double high = 150.0;    // Fixed
+    double sigma = 0.33;    // Median
+    double lowRatio = 0.5;  // Otsu
+};
+
+inline ThresholdParams fixedThresholds(double low, double high) {
+    ThresholdParams thresholds;
+    thresholds.mode = ThresholdMode::Fixed;
+    thresholds.low = low;
+    thresholds.high = high;
+    return thresholds;
+}
+
+// Thresholds a detection ran with.
+struct EdgeThresholds {
+    double low = 0.0;
+    double high = 0.0;
+};
+
+constexpr int kMinAutoThreshold = 8;
+constexpr int kMaxAutoThreshold = 506;
+
+using Histogram = std::array<uint32_t, 256>;
+
+// Counts of 8-bit samples, built a row at a time. Consecutive samples update
+// four interleaved sub-histograms, so runs of equal values (flat image areas)
+// do not serialize on one counter; flush() sums them into `out` with a
+// vectorizable loop. Keep one per thread and merge with addHistogram.
+class HistogramAccumulator {
+public:
+    HistogramAccumulator() { clear(); }
+
+    void clear();
+    void addRow(const uint8_t* row, int width);
+    void flush(Histogram& out);
+
+private:
+    uint32_t counts_[4][256];
+};
+
+void addHistogram(const Histogram& src, Histogram& dst);
+
+// Smallest bin at which the cumulative count reaches half the total (0 for
+// an empty histogram).
+int histogramMedian(const Histogram& hist);
+
+// Otsu's threshold over bins [first, last]: the t maximizing the
+// between-class variance of {first..t} and {t+1..last}. With fewer than two
+// distinct values in the range, returns first - 1 (everything above it).
+int otsuThreshold(const Histogram& hist, int first, int last);
+
+} // namespace edgeviewer
@@ -0,0 +1,495 @@
+#include "canny.hpp"
+#include "pixel_expr.hpp"
+#include "sobel.hpp"
+#include "suppression.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace edgeviewer {
+
+namespace {
+    // Hysteresis map states, stored in the destination buffer until the final
+    // pass rewrites them as 0/255. With fixed thresholds a pixel is kNoEdge,
+    // kWeak or kStrong; with automatic ones non-maximum suppression stores
+    // each candidate's magnitude level (1..kMaxLevel) instead, and the
+    // candidates above the chosen low level count as weak.
+    constexpr uint8_t kNoEdge = 0;
+    constexpr uint8_t kWeak = 1;
+    constexpr uint8_t kMaxLevel = 254;
+    constexpr uint8_t kStrong = 255;
+
+    // Sobel and suppression look one row up and one row down.
+    constexpr int kRingRows = 3;
+
+    // Smallest band handed to a worker thread.
+    constexpr int kMinBandRows = 32;
+
+    struct Point {
+        int x;
+        int y;
+    };
+
+    class PlaneSource : public GrayRowSource {
+    public:
+        PlaneSource(const uint8_t* data, int stride) : data_(data), stride_(stride) {}
+        const uint8_t* row(int y, uint8_t* /*scratch*/) override {
+            return data_ + static_cast<size_t>(y) * static_cast<size_t>(stride_);
+        }
+    private:
+        const uint8_t* data_;
+        int stride_;
+    };
+}
+
+// Double threshold of one suppressed row (`maxima`: local maxima above low)
+// into hysteresis states. Strong pixels seed the hysteresis stack.
+static void thresholdRow(const uint8_t* maxima, const int* mag, int width, int y, int high,
+                         uint8_t* state, std::vector<Point>& stack) {
+    std::memset(state, kNoEdge, static_cast<size_t>(width));
+    forEachSetBit(maxima, width, [&](int x) {
+        if (mag[x] > high) {
+            state[x] = kStrong;
+            stack.push_back({x, y});
+        } else {
+            state[x] = kWeak;
+        }
+    });
+}
+
+// Automatic thresholds are 2 * level; candidates are above the lowest one.
+constexpr int kMinLevel = kMinAutoThreshold / 2;
+static_assert(kMaxAutoThreshold / 2 == kMaxLevel - 1, "every automatic threshold has a level below kMaxLevel");
+
+// Level of squared magnitude m2: ceil(sqrt(m2) / 2), capped at kMaxLevel, so
+// that m2 > (2 j)^2 exactly when level > j for every j < kMaxLevel. m2 is
+// below 2^22, where the float square root is accurate enough for that.
+static inline int magnitudeLevel(int m2) {
+    const int level = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(m2)) * 0.5f));
+    return std::min(level, static_cast<int>(kMaxLevel));
+}
+
+// The automatic modes' counterpart of thresholdRow (`maxima`: local maxima
+// above kMinLevel): every candidate gets its magnitude level, joins the level
+// histogram and is listed by its offset in the state map (stateOffset is
+// that of the row).
+static void levelRow(const uint8_t* maxima, const int* mag, int width, uint32_t stateOffset,
+                     uint8_t* state, std::vector<uint32_t>& candidates, Histogram& levels) {
+    std::memset(state, kNoEdge, static_cast<size_t>(width));
+    forEachSetBit(maxima, width, [&](int x) {
+        const int level = magnitudeLevel(mag[x]);
+        state[x] = static_cast<uint8_t>(level);
+        ++levels[level];
+        candidates.push_back(stateOffset + static_cast<uint32_t>(x));
+    });
+}
+
+namespace {
+    // Everything one band works with. The line buffers come from the
+    // workspace arena for each frame; the lists are cleared, not freed,
+    // between frames.
+    struct BandBuffers {
+        uint8_t* grayRing = nullptr;
+        uint8_t* blurRing = nullptr;
+        int16_t* dxRing = nullptr;
+        int16_t* dyRing = nullptr;
+        int* magRing = nullptr;
+        uint16_t* blurScratch = nullptr;
+        int16_t* sobelScratch = nullptr;
+        uint8_t* maxima = nullptr;
+        uint8_t* packed = nullptr;
+
+        // Suppression output: hysteresis seeds and, in the automatic modes,
+        // candidate offsets in the state map and the band's histogram.
+        std::vector<Point> seeds;
+        std::vector<uint32_t> candidates;
+        Histogram hist{};
+
+        SparseEdges sparse;
+
+        void carve(FrameArena& arena, int width, int radius) {
+            const size_t w = static_cast<size_t>(width);
+            grayRing = arena.allocate<uint8_t>(static_cast<size_t>(2 * radius + 1) * w);
+            blurRing = arena.allocate<uint8_t>(kRingRows * w);
+            dxRing = arena.allocate<int16_t>(kRingRows * w);
+            dyRing = arena.allocate<int16_t>(kRingRows * w);
+            magRing = arena.allocate<int>((kRingRows + 1) * (w + 2));
+            blurScratch = arena.allocate<uint16_t>(w + 2 * GaussianKernel::kMaxRadius);
+            sobelScratch = arena.allocate<int16_t>(2 * (w + 2));
+            maxima = arena.allocate<uint8_t>(packedMaskStride(width));
+            packed = arena.allocate<uint8_t>(packedMaskStride(width));
+        }
+    };
+}
+
+struct CannyWorkspace::Buffers {
+    std::vector<BandBuffers> bands;
+    FrameArena arena; // line buffers and state map, rewound after each frame
+};
+
+CannyWorkspace::CannyWorkspace() : buffers_(new Buffers) {}
+CannyWorkspace::~CannyWorkspace() = default;
+CannyWorkspace::CannyWorkspace(CannyWorkspace&&) noexcept = default;
+CannyWorkspace& CannyWorkspace::operator=(CannyWorkspace&&) noexcept = default;
+
+void CannyWorkspace::release() {
+    buffers_.reset(new Buffers);
+}
+
+FrameArena& CannyWorkspace::arena() {
+    return buffers_->arena;
+}
+
+const FrameArena& CannyWorkspace::arena() const {
+    return buffers_->arena;
+}
+
+// Runs the blur/Sobel/suppression stages for output rows [y0, y1). The band
+// streams from radius + 2 rows above to radius + 2 rows below its range (the
+// stencil halo, clipped at the image borders) so its states match a
+// whole-frame pass. In an automatic mode, `low` and `high` are unused and
+// the band collects candidates plus its histogram instead of seeds.
+static void suppressBand(GrayRowSource& source, int width, int height, const GaussianKernel& blur, int y0, int y1,
+                         ThresholdMode mode, int low, int high, uint8_t* dst, int dstStride, BandBuffers& band) {
+    // Rolling line buffers: 2 * radius + 1 gray rows feed the blur, the later
+    // stages keep kRingRows rows each. Magnitude rows carry a zero sample on
+    // both sides, and one extra all-zero row stands in for the rows above and
+    // below the image; arena memory starts out uninitialized, so those zeros
+    // are written here.
+    const int radius = blur.radius;
+    const int grayRingRows = 2 * radius + 1;
+    const size_t w = static_cast<size_t>(width);
+    const size_t magStride = w + 2;
+    std::fill(band.magRing, band.magRing + (kRingRows + 1) * magStride, 0);
+    band.seeds.clear();
+    band.candidates.clear();
+    band.hist.fill(0);
+    uint8_t* grayRing = band.grayRing;
+    uint8_t* blurRing = band.blurRing;
+    int16_t* dxRing = band.dxRing;
+    int16_t* dyRing = band.dyRing;
+    int* magRing = band.magRing;
+    const uint8_t* grayRows[2 * GaussianKernel::kMaxRadius + 1] = {};
+    const uint8_t* blurTaps[2 * GaussianKernel::kMaxRadius + 1];
+    const GaussianRowKernel gaussianRow = gaussianRowKernel();
+    const SobelRowKernel sobelRow = sobelRowKernel();
+    const LocalMaxRowKernel localMaxRow = localMaxRowKernel();
+    uint8_t* maxima = band.maxima;
+    const int floor = (mode == ThresholdMode::Fixed) ? low : (2 * kMinLevel) * (2 * kMinLevel);
+    HistogramAccumulator grayHist;
+    // A noisy frame has local maxima above the floor at about a quarter of
+    // its pixels; reserving that up front avoids regrowing the list.
+    if (mode != ThresholdMode::Fixed) band.candidates.reserve(static_cast<size_t>(y1 - y0) * w / 4);
+
+    auto blurRow = [&](int y) { return blurRing + (y % kRingRows) * w; };
+    auto magRow = [&](int y) -> const int* {
+        if (y < 0 || y >= height) return magRing + kRingRows * magStride + 1;
+        return magRing + (y % kRingRows) * magStride + 1;
+    };
+
+    const int blurBegin = std::max(y0 - 2, 0), blurEnd = std::min(y1 + 2, height);
+    const int sobelBegin = std::max(y0 - 1, 0), sobelEnd = std::min(y1 + 1, height);
+
+    // On iteration i the stages handle gray row i, blur row i - radius, Sobel
+    // row i - radius - 1 and suppression row i - radius - 2, so each stage
+    // only reads rows its predecessor has already produced and still holds.
+    for (int i = y0 - radius - 2; i < y1 + radius + 2; ++i) {
+        const int yGray = i;
+        if (yGray >= 0 && yGray < height) {
+            const int slot = yGray % grayRingRows;
+            grayRows[slot] = source.row(yGray, grayRing + static_cast<size_t>(slot) * w);
+        }
+        const int yBlur = i - radius;
+        if (yBlur >= blurBegin && yBlur < blurEnd) {
+            for (int k = 0; k < grayRingRows; ++k) {
+                blurTaps[k] = grayRows[borderReflect101(yBlur - radius + k, height) % grayRingRows];
+            }
+            gaussianRow(blur, blurTaps, width, band.blurScratch, blurRow(yBlur));
+            // Each band counts only its own rows, not the halo.
+            if (mode == ThresholdMode::Median && yBlur >= y0 && yBlur < y1) grayHist.addRow(blurRow(yBlur), width);
+        }
+        const int ySobel = yBlur - 1;
+        if (ySobel >= sobelBegin && ySobel < sobelEnd) {
+            const size_t slot = static_cast<size_t>(ySobel % kRingRows);
+            sobelRow(blurRow(std::max(ySobel - 1, 0)), blurRow(ySobel), blurRow(std::min(ySobel + 1, height - 1)),
+                     width, band.sobelScratch, dxRing + slot * w, dyRing + slot * w,
+                     magRing + slot * magStride + 1, SobelMagnitude::L2Squared);
+        }
+        const int yNms = ySobel - 1;
+        if (yNms >= y0 && yNms < y1) {
+            const size_t slot = static_cast<size_t>(yNms % kRingRows);
+            uint8_t* state = dst + static_cast<size_t>(yNms) * dstStride;
+            localMaxRow(magRow(yNms - 1), magRow(yNms), magRow(yNms + 1),
+                        dxRing + slot * w, dyRing + slot * w, width, floor, maxima);
+            if (mode == ThresholdMode::Fixed) {
+                thresholdRow(maxima, magRow(yNms), width, yNms, high, state, band.seeds);
+            } else {
+                const uint32_t stateOffset = static_cast<uint32_t>(yNms) * static_cast<uint32_t>(dstStride);
+                levelRow(maxima, magRow(yNms), width, stateOffset, state, band.candidates, band.hist);
+            }
+        }
+    }
+    if (mode == ThresholdMode::Median) grayHist.flush(band.hist);
+}
+
+// Horizontal bands a frame is split into: two per thread for load balance,
+// but never so thin that the halo rows each band recomputes dominate.
+static int bandCount(int height, WorkerPool* pool) {
+    const int threads = pool ? pool->threadCount() : 1;
+    return std::max(1, std::min(threads * 2, height / kMinBandRows));
+}
+
+static inline int bandBegin(int height, int bands, int b) {
+    return static_cast<int>(static_cast<int64_t>(height) * b / bands);
+}
+
+template <typename Body>
+static void forEachBand(int bands, WorkerPool* pool, const Body& body) {
+    if (pool && bands > 1) {
+        // By reference: std::function never allocates for a reference_wrapper.
+        pool->parallelFor(bands, std::cref(body));
+    } else {
+        for (int b = 0; b < bands; ++b) body(b);
+    }
+}
+
+// Automatic thresholds as levels from the merged band histograms.
+static void chooseLevels(const ThresholdParams& thresholds, const Histogram& hist, int& lowLevel, int& highLevel) {
+    auto toLevel = [](double threshold) {
+        const int level = static_cast<int>(std::lround(threshold / 2.0));
+        return std::max(kMinLevel, std::min(level, kMaxLevel - 1));
+    };
+    if (thresholds.mode == ThresholdMode::Median) {
+        const double median = histogramMedian(hist);
+        lowLevel = toLevel((1.0 - thresholds.sigma) * median);
+        highLevel = toLevel((1.0 + thresholds.sigma) * median);
+    } else {
+        highLevel = otsuThreshold(hist, kMinLevel + 1, kMaxLevel);
+        lowLevel = toLevel(thresholds.lowRatio * 2.0 * highLevel);
+    }
+    if (lowLevel > highLevel) std::swap(lowLevel, highLevel);
+}
+
+// Every stage up to and including hysteresis: leaves kStrong for edge pixels
+// in `states` (width x height, row stride stateStride) and something lower
+// everywhere else.
+static void detectEdges(GrayRowSource& source, int width, int height, const GaussianKernel& blur,
+                        const ThresholdParams& thresholds, EdgeThresholds& chosen, uint8_t* states, int stateStride,
+                        int bands, WorkerPool* pool, std::vector<BandBuffers>& results) {
+    double lowThreshold = thresholds.low;
+    double highThreshold = thresholds.high;
+    if (lowThreshold > highThreshold) std::swap(lowThreshold, highThreshold);
+    // L2 magnitudes are compared squared, exactly like cv::Canny.
+    lowThreshold = std::min(32767.0, lowThreshold);
+    highThreshold = std::min(32767.0, highThreshold);
+    const int low = static_cast<int>(std::floor(lowThreshold > 0 ? lowThreshold * lowThreshold : lowThreshold));
+    const int high = static_cast<int>(std::floor(highThreshold > 0 ? highThreshold * highThreshold : highThreshold));
+
+    forEachBand(bands, pool, [&](int b) {
+        suppressBand(source, width, height, blur, bandBegin(height, bands, b), bandBegin(height, bands, b + 1),
+                     thresholds.mode, low, high, states, stateStride, results[b]);
+    });
+
+    // Levels at or below weakFloor are no edge.
+    int weakFloor = kNoEdge;
+    if (thresholds.mode == ThresholdMode::Fixed) {
+        chosen.low = lowThreshold;
+        chosen.high = highThreshold;
+    } else {
+        Histogram hist{};
+        for (int b = 0; b < bands; ++b) addHistogram(results[b].hist, hist);
+        int highLevel = 0;
+        chooseLevels(thresholds, hist, weakFloor, highLevel);
+        chosen.low = 2.0 * weakFloor;
+        chosen.high = 2.0 * highLevel;
+
+        // Candidates above the high level become the seeds.
+        forEachBand(bands, pool, [&](int b) {
+            for (const uint32_t offset : results[b].candidates) {
+                if (states[offset] > highLevel) {
+                    states[offset] = kStrong;
+                    results[b].seeds.push_back({static_cast<int>(offset % stateStride), static_cast<int>(offset / stateStride)});
+                }
+            }
+        });
+    }
+
+    // Hysteresis: grow strong edges through 8-connected weak pixels using an
+    // explicit stack, so long contours cannot overflow the call stack. Edges
+    // cross band borders freely, so this step runs once over all seeds; the
+    // final state does not depend on the order they are visited in.
+    std::vector<Point>& stack = results[0].seeds;
+    for (int b = 1; b < bands; ++b) {
+        stack.insert(stack.end(), results[b].seeds.begin(), results[b].seeds.end());
+    }
+    while (!stack.empty()) {
+        const Point p = stack.back();
+        stack.pop_back();
+        const int y0 = std::max(p.y - 1, 0), y1 = std::min(p.y + 1, height - 1);
+        const int x0 = std::max(p.x - 1, 0), x1 = std::min(p.x + 1, width - 1);
+        for (int y = y0; y <= y1; ++y) {
+            uint8_t* state = states + static_cast<size_t>(y) * stateStride;
+            for (int x = x0; x <= x1; ++x) {
+                if (state[x] > weakFloor && state[x] != kStrong) {
+                    state[x] = kStrong;
+                    stack.push_back({x, y});
+                }
+            }
+        }
+    }
+}
+
+// Gives the first `bands` slots their line buffers for this frame. Runs on
+// the calling thread, before the bands fan out.
+static void carveBands(CannyWorkspace::Buffers& buffers, int width, int radius, int bands) {
+    if (buffers.bands.size() < static_cast<size_t>(bands)) buffers.bands.resize(static_cast<size_t>(bands));
+    for (int b = 0; b < bands; ++b) {
+        buffers.bands[static_cast<size_t>(b)].carve(buffers.arena, width, radius);
+    }
+}
+
+void CannyWorkspace::reserve(int width, int height, const GaussianKernel& blur, const ThresholdParams& thresholds,
+                             EdgeMaskFormat format, WorkerPool* pool) {
+    // Carving a frame's worth of buffers and rewinding leaves the arena's
+    // high-water mark at what a frame takes.
+    FrameArena::Scope scope(buffers_->arena);
+    const int bands = bandCount(height, pool);
+    carveBands(*buffers_, width, blur.radius, bands);
+    if (format != EdgeMaskFormat::Bytes) buffers_->arena.allocate<uint8_t>(static_cast<size_t>(width) * static_cast<size_t>(height));
+    const size_t bandRows = static_cast<size_t>(height / bands + 1);
+    for (int b = 0; b < bands && thresholds.mode != ThresholdMode::Fixed; ++b) {
+        buffers_->bands[static_cast<size_t>(b)].candidates.reserve(bandRows * width / 4);
+    }
+}
+
+void cannyStream(GrayRowSource& source,
+                 int width,
+                 int height,
+                 const GaussianKernel& blur,
+                 const ThresholdParams& thresholds,
+                 EdgeThresholds& chosen,
+                 uint8_t* dst,
+                 int dstStride,
+                 WorkerPool* pool,
+                 EdgeMaskFormat format,
+                 CannyWorkspace* workspace) {
+    CannyWorkspace::Buffers temporary;
+    CannyWorkspace::Buffers& buffers = workspace ? workspace->buffers() : temporary;
+    FrameArena::Scope scope(buffers.arena);
+    const int bands = bandCount(height, pool);
+    carveBands(buffers, width, blur.radius, bands);
+
+    // A packed mask has no room for the hysteresis states, so they go to a
+    // byte-per-pixel scratch map instead of dst.
+    uint8_t* states = dst;
+    int stateStride = dstStride;
+    if (format == EdgeMaskFormat::Packed) {
+        states = buffers.arena.allocate<uint8_t>(static_cast<size_t>(width) * static_cast<size_t>(height));
+        stateStride = width;
+    }
+
+    detectEdges(source, width, height, blur, thresholds, chosen, states, stateStride, bands, pool, buffers.bands);
+
+    const MaskPackRowKernel packRow = maskPackRowKernel();
+    // kStrong is the largest state, so "above kStrong - 1" keeps exactly the
+    // strong pixels; the byte mask is rewritten in place.
+    const auto strongOnly = px::threshold(px::plane<uint8_t>(dst, width, height, static_cast<size_t>(dstStride)),
+                                          static_cast<uint8_t>(kStrong - 1));
+    forEachBand(bands, pool, [&](int b) {
+        const int y0 = bandBegin(height, bands, b);
+        const int y1 = bandBegin(height, bands, b + 1);
+        if (format == EdgeMaskFormat::Packed) {
+            for (int y = y0; y < y1; ++y) {
+                packRow(states + static_cast<size_t>(y) * stateStride, width, kStrong - 1,
+                        dst + static_cast<size_t>(y) * dstStride);
+            }
+            return;
+        }
+        px::evaluateRows(strongOnly, y0, y1, dst, static_cast<size_t>(dstStride));
+    });
+}
+
+void cannyStream(GrayRowSource& source,
+                 int width,
+                 int height,
+                 const GaussianKernel& blur,
+                 double lowThreshold,
+                 double highThreshold,
+                 uint8_t* dst,
+                 int dstStride,
+                 WorkerPool* pool,
+                 EdgeMaskFormat format) {
+    EdgeThresholds chosen;
+    cannyStream(source, width, height, blur, fixedThresholds(lowThreshold, highThreshold), chosen, dst, dstStride, pool, format);
+}
+
+void cannyStreamSparse(GrayRowSource& source,
+                       int width,
+                       int height,
+                       const GaussianKernel& blur,
+                       const ThresholdParams& thresholds,
+                       EdgeThresholds& chosen,
+                       EdgeMaskFormat format,
+                       SparseEdges& edges,
+                       WorkerPool* pool,
+                       CannyWorkspace* workspace) {
+    CannyWorkspace::Buffers temporary;
+    CannyWorkspace::Buffers& buffers = workspace ? workspace->buffers() : temporary;
+    FrameArena::Scope scope(buffers.arena);
+    const int bands = bandCount(height, pool);
+    carveBands(buffers, width, blur.radius, bands);
+    uint8_t* states = buffers.arena.allocate<uint8_t>(static_cast<size_t>(width) * static_cast<size_t>(height));
+    detectEdges(source, width, height, blur, thresholds, chosen, states, width, bands, pool, buffers.bands);
+
+    // Each band packs its rows (SIMD compare-and-pack), then compacts the set
+    // bits into its own list; the lists are joined in row order.
+    const MaskPackRowKernel packRow = maskPackRowKernel();
+    forEachBand(bands, pool, [&](int b) {
+        BandBuffers& band = buffers.bands[b];
+        band.sparse.clear(format);
+        for (int y = bandBegin(height, bands, b); y < bandBegin(height, bands, b + 1); ++y) {
+            packRow(states + static_cast<size_t>(y) * width, width, kStrong - 1, band.packed);
+            appendSparseRow(band.packed, width, y, format, band.sparse);
+        }
+    });
+
+    edges.clear(format);
+    for (int b = 0; b < bands; ++b) {
+        edges.append(buffers.bands[b].sparse, format);
+    }
+}
+
+void cannyStreamSparse(GrayRowSource& source,
+                       int width,
+                       int height,
+                       const GaussianKernel& blur,
+                       double lowThreshold,
+                       double highThreshold,
+                       EdgeMaskFormat format,
+                       SparseEdges& edges,
+                       WorkerPool* pool) {
+    EdgeThresholds chosen;
+    cannyStreamSparse(source, width, height, blur, fixedThresholds(lowThreshold, highThreshold), chosen, format, edges, pool);
+}
+
+void cannyGray(const uint8_t* gray,
+               int width,
+               int height,
+               int grayStride,
+               const GaussianKernel& blur,
+               double lowThreshold,
+               double highThreshold,
+               uint8_t* dst,
+               int dstStride,
+               WorkerPool* pool,
+               EdgeMaskFormat format) {
+    PlaneSource source(gray, grayStride);
+    cannyStream(source, width, height, blur, lowThreshold, highThreshold, dst, dstStride, pool, format);
+}
+
+} // namespace edgeviewer
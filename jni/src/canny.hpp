@@ -0,0 +1,141 @@
+#pragma once
+
+#include "auto_threshold.hpp"
+#include "edge_mask.hpp"
+#include "frame_arena.hpp"
+#include "gaussian.hpp"
+#include "gray_row_source.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace edgeviewer {
+
+class WorkerPool;
+
+// Memory for cannyStream / cannyStreamSparse. Each band's line buffers and
+// the state map Packed and sparse results need are carved from arena() for
+// every frame and handed back before the call returns; callers may put their
+// own per-frame buffers in the arena ahead of them. The per-band seed and
+// candidate lists and sparse rows are kept between frames. reserve() sizes
+// the arena and lists for a frame size up front, so a workspace reused frame
+// after frame stops allocating once the content-dependent lists (hysteresis
+// seeds, sparse edges) have seen the busiest frame. One workspace per
+// detection in flight.
+class CannyWorkspace {
+public:
+    CannyWorkspace();
+    ~CannyWorkspace();
+    CannyWorkspace(CannyWorkspace&&) noexcept;
+    CannyWorkspace& operator=(CannyWorkspace&&) noexcept;
+
+    // Sizes the buffers for width x height frames run with these settings.
+    void reserve(int width, int height, const GaussianKernel& blur, const ThresholdParams& thresholds,
+                 EdgeMaskFormat format, WorkerPool* pool);
+
+    // Frees everything.
+    void release();
+
+    FrameArena& arena();
+    const FrameArena& arena() const;
+
+    struct Buffers; // defined in canny.cpp
+    Buffers& buffers() { return *buffers_; }
+
+private:
+    std::unique_ptr<Buffers> buffers_;
+};
+
+// Native Canny: Gaussian smoothing with `blur` (see gaussian.hpp), 3x3 Sobel,
+// L2 gradient magnitude, non-maximum suppression along the quantized gradient
+// direction and double-threshold hysteresis. Thresholds use the same units as
+// cv::Canny(..., apertureSize = 3, L2gradient = true), and the result follows
+// OpenCV's conventions (strict comparisons, replicated borders for the
+// gradient), so callers can swap one for the other.
+//
+// All stages run in a single top-to-bottom pass over rolling line buffers
+// (2 * radius + 1 gray rows, 3 rows for each later stage), so no blurred or
+// gradient frame is ever stored. For a Bytes mask the only frame-sized
+// storage is `dst` itself, which holds the hysteresis state until the final
+// width x height 0/255 mask (row stride `dstStride`) is written over it. A
+// Packed mask (dstStride >= packedMaskStride(width)) needs a byte-per-pixel
+// state map on the side, packed into dst by the final pass.
+//
+// With a pool, the frame is split into horizontal bands that stream
+// independently, each re-reading radius + 2 rows above and below it, so the
+// result is identical to a single-threaded run.
+//
+// With an automatic ThresholdParams mode the suppression stage keeps every
+// local maximum above kMinAutoThreshold, storing its magnitude level
+// (ceil(magnitude / 2), capped at 254) in the state map and its position in a
+// per-band candidate list, while the band builds its histogram (levels for
+// Otsu, smoothed gray rows for Median). Once all bands are done the merged
+// histogram gives the thresholds, snapped to the level grid, and hysteresis
+// seeds from the candidate list, so choosing them costs no extra pass over
+// the frame. The pair used is returned in `chosen`.
+//
+// Scratch memory comes from `workspace`, or from a temporary one when it is
+// null.
+void cannyStream(GrayRowSource& source,
+                 int width,
+                 int height,
+                 const GaussianKernel& blur,
+                 const ThresholdParams& thresholds,
+                 EdgeThresholds& chosen,
+                 uint8_t* dst,
+                 int dstStride,
+                 WorkerPool* pool = nullptr,
+                 EdgeMaskFormat format = EdgeMaskFormat::Bytes,
+                 CannyWorkspace* workspace = nullptr);
+
+// Fixed thresholds.
+void cannyStream(GrayRowSource& source,
+                 int width,
+                 int height,
+                 const GaussianKernel& blur,
+                 double lowThreshold,
+                 double highThreshold,
+                 uint8_t* dst,
+                 int dstStride,
+                 WorkerPool* pool = nullptr,
+                 EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+// Same detection, producing the edge pixels as a Points or Runs list in
+// `edges` instead of a mask (see edge_mask.hpp). The threshold stage packs
+// each row and compacts its set bits directly; the hysteresis states need a
+// width x height byte map on the side.
+void cannyStreamSparse(GrayRowSource& source,
+                       int width,
+                       int height,
+                       const GaussianKernel& blur,
+                       double lowThreshold,
+                       double highThreshold,
+                       EdgeMaskFormat format,
+                       SparseEdges& edges,
+                       WorkerPool* pool = nullptr);
+
+void cannyStreamSparse(GrayRowSource& source,
+                       int width,
+                       int height,
+                       const GaussianKernel& blur,
+                       const ThresholdParams& thresholds,
+                       EdgeThresholds& chosen,
+                       EdgeMaskFormat format,
+                       SparseEdges& edges,
+                       WorkerPool* pool = nullptr,
+                       CannyWorkspace* workspace = nullptr);
+
+// Convenience wrapper for an 8-bit gray plane.
+void cannyGray(const uint8_t* gray,
+               int width,
+               int height,
+               int grayStride,
+               const GaussianKernel& blur,
+               double lowThreshold,
+               double highThreshold,
+               uint8_t* dst,
+               int dstStride,
+               WorkerPool* pool = nullptr,
+               EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+} // namespace edgeviewer
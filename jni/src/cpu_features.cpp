@@ -0,0 +1,25 @@
+#include "cpu_features.hpp"
+
+namespace edgeviewer {
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures f;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    // arm64 always has NEON; the NDK builds armeabi-v7a with NEON enabled,
+    // so reaching this code already implies the unit is present.
+    f.neon = true;
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    f.sse41 = __builtin_cpu_supports("sse4.1") != 0;
+    f.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return f;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace edgeviewer {
+
+// SIMD capabilities of the running CPU. Detected once on first use; kernels
+// use this to pick the widest implementation the device actually supports.
+struct CpuFeatures {
+    bool neon = false;
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+const CpuFeatures& cpuFeatures();
+
+// One compiled variant of a kernel and the instruction set it needs. Tests
+// and benchmarks use lists of these to reach every variant the CPU can run,
+// not only the one dispatch picks.
+template <typename Kernel>
+struct IsaKernel {
+    const char* isa;
+    Kernel kernel;
+};
+
+} // namespace edgeviewer
@@ -0,0 +1,214 @@
+#include "edge_mask.hpp"
+
+#include "cpu_features.hpp"
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+namespace edgeviewer {
+
+// Packs pixels [x0, width) of a row, x0 a multiple of 8, and clears the rest
+// of the row's padding.
+static void packTail(const uint8_t* src, int x0, int width, uint8_t threshold, uint8_t* dst) {
+    size_t byte = static_cast<size_t>(x0) / 8;
+    for (int x = x0; x < width; x += 8) {
+        const int count = (width - x < 8) ? width - x : 8;
+        uint8_t bits = 0;
+        for (int b = 0; b < count; ++b) {
+            bits |= static_cast<uint8_t>((src[x + b] > threshold) << b);
+        }
+        dst[byte++] = bits;
+    }
+    std::memset(dst + byte, 0, packedMaskStride(width) - byte);
+}
+
+void packMaskRowScalar(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst) {
+    packTail(src, 0, width, threshold, dst);
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static void packMaskRowNeon(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst) {
+    // Each compare lane is ANDed with its bit weight; three pairwise adds
+    // then fold 16 lanes into two mask bytes.
+    static const uint8_t kWeights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x8_t weights = vld1_u8(kWeights);
+    const uint8x16_t limit = vdupq_n_u8(threshold);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t on = vcgtq_u8(vld1q_u8(src + x), limit);
+        const uint8x8_t lo = vand_u8(vget_low_u8(on), weights);
+        const uint8x8_t hi = vand_u8(vget_high_u8(on), weights);
+        uint8x8_t sum = vpadd_u8(lo, hi);
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        const uint16_t bits = vget_lane_u16(vreinterpret_u16_u8(sum), 0);
+        std::memcpy(dst + x / 8, &bits, sizeof(bits));
+    }
+    packTail(src, x, width, threshold, dst);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// Unsigned byte compares are done as signed ones with the sign bit flipped;
+// pmovmskb then yields the mask bits already in pixel order.
+
+// Packs 16 pixels at a time from x0 on; returns where it stopped.
+__attribute__((target("sse4.1")))
+static int packSse16(const uint8_t* src, int x0, int width, uint8_t threshold, uint8_t* dst) {
+    const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold ^ 0x80));
+    int x = x0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)), flip);
+        const uint16_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit)));
+        std::memcpy(dst + x / 8, &bits, sizeof(bits));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static void packMaskRowSse41(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst) {
+    packTail(src, packSse16(src, 0, width, threshold, dst), width, threshold, dst);
+}
+
+__attribute__((target("avx2")))
+static void packMaskRowAvx2(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst) {
+    const __m256i flip = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold ^ 0x80));
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x)), flip);
+        const uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)));
+        std::memcpy(dst + x / 8, &bits, sizeof(bits));
+    }
+    _mm256_zeroupper(); // avoid an AVX-SSE transition in the SSE tail
+    packTail(src, packSse16(src, x, width, threshold, dst), width, threshold, dst);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static MaskPackRowKernel selectMaskPackRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return packMaskRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return packMaskRowAvx2;
+    if (cpu.sse41) return packMaskRowSse41;
+#endif
+    (void)cpu;
+    return packMaskRowScalar;
+}
+
+MaskPackRowKernel maskPackRowKernel() {
+    static const MaskPackRowKernel kernel = selectMaskPackRowKernel();
+    return kernel;
+}
+
+void SparseEdges::clear(EdgeMaskFormat format) {
+    points.clear();
+    runs.clear();
+    rowStart.clear();
+    if (format == EdgeMaskFormat::Runs) rowStart.push_back(0);
+}
+
+void SparseEdges::append(const SparseEdges& other, EdgeMaskFormat format) {
+    if (format == EdgeMaskFormat::Points) {
+        points.insert(points.end(), other.points.begin(), other.points.end());
+        return;
+    }
+    const uint32_t offset = static_cast<uint32_t>(runs.size());
+    for (size_t r = 1; r < other.rowStart.size(); ++r) {
+        rowStart.push_back(offset + other.rowStart[r]);
+    }
+    runs.insert(runs.end(), other.runs.begin(), other.runs.end());
+}
+
+void appendSparseRow(const uint8_t* packed, int width, int y, EdgeMaskFormat format, SparseEdges& edges) {
+    if (format == EdgeMaskFormat::Points) {
+        forEachSetBit(packed, width, [&](int x) {
+            edges.points.push_back({static_cast<uint16_t>(x), static_cast<uint16_t>(y)});
+        });
+        return;
+    }
+
+    // Runs: every set bit of bits ^ (bits << 1 | carry) is a transition,
+    // the start of a run if the pixel is set and its end otherwise.
+    const int words = static_cast<int>(packedMaskStride(width) / 8);
+    uint64_t carry = 0;
+    int runStart = -1;
+    for (int i = 0; i < words; ++i) {
+        const uint64_t bits = packedMaskWord(packed, i, width);
+        for (uint64_t transitions = bits ^ ((bits << 1) | carry); transitions != 0; transitions &= transitions - 1) {
+            const int x = i * 64 + __builtin_ctzll(transitions);
+            if (runStart < 0) {
+                runStart = x;
+            } else {
+                edges.runs.push_back({static_cast<uint16_t>(runStart), static_cast<uint16_t>(x - runStart)});
+                runStart = -1;
+            }
+        }
+        carry = bits >> 63;
+    }
+    // Padding bits read as zero, so only a run touching a word-aligned right
+    // border is still open here.
+    if (runStart >= 0) {
+        edges.runs.push_back({static_cast<uint16_t>(runStart), static_cast<uint16_t>(width - runStart)});
+    }
+    edges.rowStart.push_back(static_cast<uint32_t>(edges.runs.size()));
+}
+
+size_t sparseEdgeBytes(const SparseEdges& edges, EdgeMaskFormat format) {
+    if (format == EdgeMaskFormat::Points) return edges.points.size() * sizeof(EdgePoint);
+    return edges.rowStart.size() * sizeof(uint32_t) + edges.runs.size() * sizeof(EdgeRun);
+}
+
+size_t maxSparseEdgeBytes(int width, int height, EdgeMaskFormat format) {
+    const size_t w = static_cast<size_t>(width);
+    const size_t h = static_cast<size_t>(height);
+    if (format == EdgeMaskFormat::Points) return w * h * sizeof(EdgePoint);
+    return (h + 1) * sizeof(uint32_t) + h * ((w + 1) / 2) * sizeof(EdgeRun);
+}
+
+void writeSparseEdges(const SparseEdges& edges, EdgeMaskFormat format, uint8_t* out) {
+    if (format == EdgeMaskFormat::Points) {
+        if (!edges.points.empty()) std::memcpy(out, edges.points.data(), edges.points.size() * sizeof(EdgePoint));
+        return;
+    }
+    const size_t headerBytes = edges.rowStart.size() * sizeof(uint32_t);
+    std::memcpy(out, edges.rowStart.data(), headerBytes);
+    if (!edges.runs.empty()) std::memcpy(out + headerBytes, edges.runs.data(), edges.runs.size() * sizeof(EdgeRun));
+}
+
+void unpackMaskRow(const uint8_t* packed, int width, uint8_t on, uint8_t* dst) {
+    // Masks are mostly empty: clear the row, then visit only the set bits.
+    std::memset(dst, 0, static_cast<size_t>(width));
+    forEachSetBit(packed, width, [&](int x) { dst[x] = on; });
+}
+
+void copyPackedPixels(const uint8_t* src, int srcX, int count, uint8_t* dst, int dstX) {
+    for (int i = 0; i < count; ++i) {
+        const int sx = srcX + i;
+        const int dx = dstX + i;
+        const uint8_t bit = static_cast<uint8_t>(1u << (dx & 7));
+        if ((src[sx >> 3] >> (sx & 7)) & 1) {
+            dst[dx >> 3] = static_cast<uint8_t>(dst[dx >> 3] | bit);
+        } else {
+            dst[dx >> 3] = static_cast<uint8_t>(dst[dx >> 3] & ~bit);
+        }
+    }
+}
+
+} // namespace edgeviewer
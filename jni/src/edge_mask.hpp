@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace edgeviewer {
+
+// Layout of an edge result.
+//  Bytes:  one byte per pixel, 0 or 255, rows of `width` bytes.
+//  Packed: one bit per pixel, least significant bit first (pixel x of a row
+//          is bit x & 7 of byte x >> 3). Rows are padded with zero bits to a
+//          whole number of 64-bit words, packedMaskStride(width) bytes each,
+//          so consumers can scan a row a word at a time.
+//  Points: EdgePoint per edge pixel, in row-major order.
+//  Runs:   uint32 rowStart[height + 1], then EdgeRun[rowStart[height]]; the
+//          runs of row y are [rowStart[y], rowStart[y + 1]), left to right.
+// Points and Runs sizes depend on the image content (see sparseEdgeBytes);
+// their coordinates are 16-bit, so images are at most kMaxSparseEdgeSide
+// pixels a side.
+enum class EdgeMaskFormat {
+    Bytes,
+    Packed,
+    Points,
+    Runs,
+};
+
+constexpr int kMaxSparseEdgeSide = 65535;
+
+struct EdgePoint {
+    uint16_t x;
+    uint16_t y;
+};
+
+// `length` consecutive edge pixels starting at column x.
+struct EdgeRun {
+    uint16_t x;
+    uint16_t length;
+};
+
+// Sparse edges of a range of rows, as built by the threshold stage.
+struct SparseEdges {
+    std::vector<EdgePoint> points;  // Points
+    std::vector<EdgeRun> runs;      // Runs
+    std::vector<uint32_t> rowStart; // Runs: one entry per row plus the end, starting at 0
+
+    void clear(EdgeMaskFormat format);
+
+    // Appends the rows of `other`, which follow the rows already held.
+    void append(const SparseEdges& other, EdgeMaskFormat format);
+};
+
+inline size_t packedMaskStride(int width) {
+    return (static_cast<size_t>(width) + 63) / 64 * 8;
+}
+
+// Word `word` of a packed row (bit b is pixel word * 64 + b), with the bits
+// of pixels at or past `width` cleared, so a row whose padding bits are set
+// reads like one whose are not.
+inline uint64_t packedMaskWord(const uint8_t* packed, int word, int width) {
+    uint64_t bits;
+    std::memcpy(&bits, packed + static_cast<size_t>(word) * 8, sizeof(bits));
+    const int valid = width - word * 64;
+    return (valid >= 64) ? bits : bits & (~0ull >> (64 - valid));
+}
+
+// Calls visit(x) for every set pixel x in [begin, end) of a packed row, left
+// to right. Works a 64-bit word at a time (count-trailing-zeros over the
+// set bits), so edge-free stretches cost one test per 64 pixels.
+template <typename Visit>
+inline void forEachSetBit(const uint8_t* packed, int begin, int end, const Visit& visit) {
+    for (int word = begin / 64; word * 64 < end; ++word) {
+        uint64_t bits = packedMaskWord(packed, word, end);
+        if (word * 64 < begin) bits &= ~0ull << (begin - word * 64);
+        for (; bits != 0; bits &= bits - 1) visit(word * 64 + __builtin_ctzll(bits));
+    }
+}
+
+// Every set pixel of a packed row of `width` pixels; padding bits are
+// ignored.
+template <typename Visit>
+inline void forEachSetBit(const uint8_t* packed, int width, const Visit& visit) {
+    forEachSetBit(packed, 0, width, visit);
+}
+
+// Packs one row: bit x is set where src[x] > threshold, and the padding bits
+// up to packedMaskStride(width) bytes are cleared.
+using MaskPackRowKernel = void (*)(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void packMaskRowScalar(const uint8_t* src, int width, uint8_t threshold, uint8_t* dst);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+MaskPackRowKernel maskPackRowKernel();
+
+// Appends packed row y to a Points or Runs result. Set bits are found a
+// 64-bit word at a time, like forEachSetBit.
+void appendSparseRow(const uint8_t* packed, int width, int y, EdgeMaskFormat format, SparseEdges& edges);
+
+// Serialized size of `edges` in `format`.
+size_t sparseEdgeBytes(const SparseEdges& edges, EdgeMaskFormat format);
+
+// Largest possible sparse result for a width x height image: every pixel an
+// edge (Points) or every other pixel a one-pixel run (Runs).
+size_t maxSparseEdgeBytes(int width, int height, EdgeMaskFormat format);
+
+// Writes `edges` in the Points or Runs layout; `out` holds
+// sparseEdgeBytes(edges, format) bytes.
+void writeSparseEdges(const SparseEdges& edges, EdgeMaskFormat format, uint8_t* out);
+
+// Expands one packed row into bytes: `on` where the bit is set, 0 elsewhere.
+// Writes exactly `width` bytes; padding bits are ignored, set or not.
+void unpackMaskRow(const uint8_t* packed, int width, uint8_t on, uint8_t* dst);
+
+// Overwrites pixels [dstX, dstX + count) of packed row `dst` with pixels
+// [srcX, srcX + count) of packed row `src`.
+void copyPackedPixels(const uint8_t* src, int srcX, int count, uint8_t* dst, int dstX);
+
+} // namespace edgeviewer
@@ -0,0 +1,251 @@
+#include "edge_worker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace edgeviewer {
+
+// Copies `luma` into `frame`, packed; `frame` holds the largest accepted size.
+static void copyLuma(const PlaneView& luma, LumaFrame& frame) {
+    const int pixelStride = (luma.pixelStride > 0) ? luma.pixelStride : 1;
+    const int rowStride = (luma.rowStride > 0) ? luma.rowStride : luma.width * pixelStride;
+    for (int y = 0; y < luma.height; ++y) {
+        const uint8_t* src = luma.data + static_cast<size_t>(y) * static_cast<size_t>(rowStride);
+        uint8_t* dst = frame.pixels.data() + static_cast<size_t>(y) * static_cast<size_t>(luma.width);
+        if (pixelStride == 1) {
+            std::memcpy(dst, src, static_cast<size_t>(luma.width));
+            continue;
+        }
+        for (int x = 0; x < luma.width; ++x) {
+            dst[x] = src[static_cast<size_t>(x) * static_cast<size_t>(pixelStride)];
+        }
+    }
+    frame.width = luma.width;
+    frame.height = luma.height;
+}
+
+// Runs `frame` through `pipeline` into `result`; false when the pipeline
+// rejects it.
+static bool detectFrame(EdgePipeline& pipeline, const LumaFrame& frame, EdgeFrame& result) {
+    const PlaneView view{frame.pixels.data(), frame.width, frame.height, frame.width, 1};
+    size_t written = 0;
+    if (!pipeline.process(view, result.mask.data(), result.mask.size(), written)) return false;
+    result.bytes = written;
+    result.width = frame.width;
+    result.height = frame.height;
+    result.timestampNs = frame.timestampNs;
+    result.sequence = frame.sequence;
+    result.thresholds = pipeline.lastThresholds();
+    return true;
+}
+
+bool EdgeWorker::start(const EdgePipelineConfig& config, FramePolicy policy, size_t queueSlots) {
+    stop();
+    const size_t frameBytes = static_cast<size_t>(config.maxWidth) * static_cast<size_t>(config.maxHeight);
+    config_ = config;
+    if (policy == FramePolicy::Parallel) {
+        pool_ = sharedWorkerPool();
+        if (pool_->threadCount() < 2) {
+            pool_.reset();
+            policy = FramePolicy::Queue;
+        }
+    }
+    policy_ = policy;
+    size_t maskBytes = 0;
+    if (policy == FramePolicy::Parallel) {
+        // Each lane runs its frame alone; the cores go to other frames.
+        config_.parallelBands = false;
+        for (size_t i = 0; i < std::max<size_t>(queueSlots, 1); ++i) {
+            std::unique_ptr<Lane> lane(new Lane());
+            if (!lane->pipeline.configure(config_)) {
+                lanes_.clear();
+                pool_.reset();
+                return false;
+            }
+            lane->input.pixels.resize(frameBytes);
+            lane->result.mask.resize(lane->pipeline.maxOutputBytes());
+            lane->task = LaneTask{this, lane.get()};
+            maskBytes = lane->pipeline.maxOutputBytes();
+            lanes_.push_back(std::move(lane));
+        }
+    } else {
+        if (!pipeline_.configure(config_)) return false;
+        maskBytes = pipeline_.maxOutputBytes();
+    }
+
+    if (policy == FramePolicy::Latest) {
+        latestInput_.reset(new FrameMailbox<LumaFrame>());
+        for (size_t i = 0; i < latestInput_->capacity(); ++i) latestInput_->slot(i).pixels.resize(frameBytes);
+    } else if (policy == FramePolicy::Queue) {
+        queuedInput_.reset(new FrameRing<LumaFrame>(queueSlots));
+        for (size_t i = 0; i < queuedInput_->capacity(); ++i) queuedInput_->slot(i).pixels.resize(frameBytes);
+    }
+    output_.reset(new FrameMailbox<EdgeFrame>());
+    for (size_t i = 0; i < output_->capacity(); ++i) output_->slot(i).mask.resize(maskBytes);
+
+    nextSequence_ = 0;
+    nextLane_ = 0;
+    nextPublish_ = 0;
+    for (std::atomic<uint64_t>* counter : {&received_, &dropped_, &failed_, &processed_, &superseded_, &displayed_}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    stop_.store(false);
+    if (policy == FramePolicy::Parallel) {
+        laneTasks_.reset(new TaskGroup(*pool_));
+    } else {
+        thread_ = std::thread([this] { run(); });
+    }
+    return true;
+}
+
+void EdgeWorker::stop() {
+    if (!isRunning()) return;
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        stop_.store(true);
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    // Waits for the lane tasks; those not yet started see stop_ and skip
+    // their frame.
+    laneTasks_.reset();
+    pool_.reset();
+    lanes_.clear();
+    latestInput_.reset();
+    queuedInput_.reset();
+    output_.reset();
+}
+
+bool EdgeWorker::submit(const PlaneView& luma, int64_t timestampNs) {
+    const EdgePipelineConfig& config = config_;
+    if (!isRunning() || luma.data == nullptr || luma.width <= 0 || luma.height <= 0 ||
+        luma.width > config.maxWidth || luma.height > config.maxHeight) {
+        return false;
+    }
+    received_.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t sequence = nextSequence_++;
+
+    LumaFrame* frame = nullptr;
+    Lane* lane = nullptr;
+    if (policy_ == FramePolicy::Parallel) {
+        // Frames go round the lanes, so the next lane holds the oldest frame
+        // in flight: if it is not free, every lane is busy.
+        lane = lanes_[static_cast<size_t>(nextLane_ % lanes_.size())].get();
+        if (lane->state.load(std::memory_order_acquire) == Lane::kFree) frame = &lane->input;
+    } else {
+        frame = latestInput_ ? latestInput_->beginWrite() : queuedInput_->beginWrite();
+    }
+    if (frame == nullptr) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    copyLuma(luma, *frame);
+    frame->timestampNs = timestampNs;
+    frame->sequence = sequence;
+    if (lane) {
+        ++nextLane_;
+        lane->state.store(Lane::kQueued, std::memory_order_release);
+        laneTasks_->run(lane->task);
+        return true;
+    }
+    if (latestInput_) {
+        // The frame still waiting, if any, is the one that loses.
+        if (latestInput_->commitWrite()) dropped_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        queuedInput_->commitWrite();
+    }
+
+    // Pairs with the fence in park(): either the worker sees the new frame
+    // before it sleeps, or this sees it parked and wakes it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_relaxed) != 0) {
+        { std::lock_guard<std::mutex> lock(parkMutex_); }
+        wake_.notify_one();
+    }
+    return true;
+}
+
+const EdgeFrame* EdgeWorker::takeLatest() {
+    if (!output_) return nullptr;
+    const EdgeFrame* frame = output_->beginRead();
+    if (frame) displayed_.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+EdgeWorkerStats EdgeWorker::stats() const {
+    EdgeWorkerStats stats;
+    stats.received = received_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.processed = processed_.load(std::memory_order_relaxed);
+    stats.superseded = superseded_.load(std::memory_order_relaxed);
+    stats.displayed = displayed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Whether a frame waits for the worker thread.
+bool EdgeWorker::inputWaiting() const {
+    return latestInput_ ? latestInput_->fresh() : queuedInput_->published() != 0;
+}
+
+// Sleeps until a frame is queued or stop() is called; false on stop.
+bool EdgeWorker::park() {
+    std::unique_lock<std::mutex> lock(parkMutex_);
+    parked_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_.wait(lock, [&] { return stop_.load() || inputWaiting(); });
+    parked_.fetch_sub(1, std::memory_order_relaxed);
+    return !stop_.load();
+}
+
+void EdgeWorker::run() {
+    for (;;) {
+        if (stop_.load(std::memory_order_relaxed)) return;
+        const LumaFrame* frame = latestInput_ ? latestInput_->beginRead() : queuedInput_->beginRead();
+        if (frame == nullptr) {
+            if (!park()) return;
+            continue;
+        }
+
+        if (detectFrame(pipeline_, *frame, *output_->beginWrite())) {
+            processed_.fetch_add(1, std::memory_order_relaxed);
+            if (output_->commitWrite()) superseded_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (queuedInput_) queuedInput_->endRead();
+    }
+}
+
+// A lane's pool task: one frame, then the reorder step.
+void EdgeWorker::runLane(Lane& lane) {
+    if (stop_.load(std::memory_order_relaxed)) return;
+    lane.succeeded = detectFrame(lane.pipeline, lane.input, lane.result);
+    lane.state.store(Lane::kDone, std::memory_order_release);
+    publishInOrder();
+}
+
+// The reorder step: publishes finished lane frames from the oldest on and
+// stops at the first one still running, so masks come out in capture
+// order. Every lane task calls it after its frame, so the last to finish a
+// run of frames publishes them all. A published mask is swapped into the
+// output mailbox rather than copied, and its lane is free again.
+void EdgeWorker::publishInOrder() {
+    std::lock_guard<std::mutex> lock(publishMutex_);
+    for (;;) {
+        Lane& lane = *lanes_[static_cast<size_t>(nextPublish_ % lanes_.size())];
+        if (lane.state.load(std::memory_order_acquire) != Lane::kDone) return;
+        if (lane.succeeded) {
+            std::swap(*output_->beginWrite(), lane.result);
+            processed_.fetch_add(1, std::memory_order_relaxed);
+            if (output_->commitWrite()) superseded_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        ++nextPublish_;
+        lane.state.store(Lane::kFree, std::memory_order_release);
+    }
+}
+
+} // namespace edgeviewer
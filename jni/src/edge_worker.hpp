@@ -0,0 +1,187 @@
+#pragma once
+
+#include "frame_mailbox.hpp"
+#include "frame_ring.hpp"
+#include "opencv_pipeline.hpp"
+#include "worker_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace edgeviewer {
+
+// A captured luma frame waiting in an EdgeWorker, packed (stride = width).
+struct LumaFrame {
+    std::vector<uint8_t> pixels; // capacity for the largest accepted frame
+    int width = 0;
+    int height = 0;
+    int64_t timestampNs = 0;
+    uint64_t sequence = 0; // submit() order, from 0
+};
+
+// An edge mask an EdgeWorker finished, in the worker's EdgeMaskFormat.
+struct EdgeFrame {
+    std::vector<uint8_t> mask; // EdgePipeline::maxOutputBytes()
+    size_t bytes = 0;          // bytes of `mask` holding this frame
+    int width = 0;
+    int height = 0;
+    int64_t timestampNs = 0;
+    uint64_t sequence = 0;
+    EdgeThresholds thresholds;
+};
+
+// Which frames an EdgeWorker processes when they arrive faster than it
+// finishes them.
+enum class FramePolicy {
+    Latest,   // mailbox: a new frame replaces the one waiting, if any
+    Queue,    // FIFO of `slots` frames: a new frame is dropped while it is full
+    Parallel, // up to `slots` frames in flight as tasks on the shared pool;
+              // a new frame is dropped while all are busy
+};
+
+// Frame counts since start(), to see where frames are lost. Once the
+// worker has caught up (and with Parallel, finished every frame in flight),
+//   received  == dropped + failed + processed
+//   processed == superseded + displayed (+ 1 if a mask is waiting)
+struct EdgeWorkerStats {
+    uint64_t received = 0;   // submit() calls with an acceptable frame
+    uint64_t dropped = 0;    // replaced or turned away before processing
+    uint64_t failed = 0;     // the pipeline rejected the frame
+    uint64_t processed = 0;  // a mask was published
+    uint64_t superseded = 0; // a newer mask replaced it before display
+    uint64_t displayed = 0;  // handed out by takeLatest()
+};
+
+// Runs an EdgePipeline on its own thread, so the thread that captures frames
+// only copies them. Frames go in through a FrameMailbox (FramePolicy::Latest)
+// or a FrameRing (Queue), and masks come out through a FrameMailbox, since
+// the display only wants the newest one. Every slot is preallocated for the
+// configured size, so neither side takes a lock or allocates per frame and
+// a slow frame never blocks capture.
+//
+// FramePolicy::Parallel is for frames too small to split well across cores
+// (around 640x480, where band synchronization costs more than it saves):
+// each frame runs whole, on one of `slots` pipelines without bands, as a
+// task on sharedWorkerPool(), so frames N, N+1, ... are processed side by
+// side on the pool's threads instead of threads of their own. Frame i goes
+// to pipeline i % slots, and a reorder step publishes finished frames
+// strictly in capture order, whichever finishes first. More slots mean more
+// throughput and as many frames more latency. A pool of one thread has no
+// thread to run frames beside capture, so there Parallel runs as Queue.
+//
+// Exactly one thread may call submit() and exactly one (possibly another)
+// may call takeLatest(); start() and stop() must not race with either. The
+// worker thread sleeps on a condition variable while no frame is waiting,
+// and submit() only takes that lock to wake it.
+class EdgeWorker {
+public:
+    static constexpr size_t kDefaultQueueSlots = 3;
+
+    EdgeWorker() = default;
+    ~EdgeWorker() { stop(); }
+
+    EdgeWorker(const EdgeWorker&) = delete;
+    EdgeWorker& operator=(const EdgeWorker&) = delete;
+
+    // Stops a running worker, configures the pipeline for `config`, sizes
+    // every slot for frames up to its maximum (`queueSlots` input slots for
+    // Queue, frames in flight for Parallel) and starts the thread (Latest,
+    // Queue).
+    // Returns false, leaving the worker stopped, when the pipeline rejects
+    // the configuration.
+    bool start(const EdgePipelineConfig& config, FramePolicy policy = FramePolicy::Latest,
+               size_t queueSlots = kDefaultQueueSlots);
+
+    // Wakes the thread, lets it finish its current frame and joins it (with
+    // Parallel, waits for the frames already running). Frames still waiting
+    // are discarded.
+    void stop();
+
+    bool isRunning() const { return thread_.joinable() || !lanes_.empty(); }
+    const EdgePipelineConfig& config() const { return config_; }
+    // The policy frames run with; Queue for a Parallel start() on a pool of
+    // one thread.
+    FramePolicy policy() const { return policy_; }
+
+    // Copies `luma` into a free input slot and queues it. Returns false when
+    // the worker is stopped or the frame is larger than configured, and with
+    // Queue or Parallel when every slot is taken (the frame is counted
+    // dropped).
+    bool submit(const PlaneView& luma, int64_t timestampNs);
+
+    // The newest finished mask, or nullptr when none finished since the last
+    // call. The frame stays valid until the next call or stop().
+    const EdgeFrame* takeLatest();
+
+    // A snapshot; counts may be a frame apart from each other.
+    EdgeWorkerStats stats() const;
+
+private:
+    struct Lane;
+
+    // The pool task that runs a lane's frame; a Lane member, so the group
+    // can borrow it.
+    struct LaneTask {
+        EdgeWorker* worker;
+        Lane* lane;
+        void operator()() const { worker->runLane(*lane); }
+    };
+
+    // One frame in flight with FramePolicy::Parallel: kFree (submit() may
+    // fill it) -> kQueued (its task is on the pool) -> kDone (waiting to be
+    // published in order) -> kFree.
+    struct Lane {
+        enum State { kFree, kQueued, kDone };
+
+        EdgePipeline pipeline;
+        LumaFrame input;
+        EdgeFrame result;
+        bool succeeded = false;
+        std::atomic<int> state{kFree};
+        LaneTask task{nullptr, nullptr};
+    };
+
+    void run();
+    void runLane(Lane& lane);
+    void publishInOrder();
+    bool park();
+    bool inputWaiting() const;
+
+    EdgePipelineConfig config_;
+    EdgePipeline pipeline_; // Latest, Queue
+    FramePolicy policy_ = FramePolicy::Latest;
+    std::unique_ptr<FrameMailbox<LumaFrame>> latestInput_; // Latest
+    std::unique_ptr<FrameRing<LumaFrame>> queuedInput_;     // Queue
+    std::vector<std::unique_ptr<Lane>> lanes_;             // Parallel
+    std::shared_ptr<WorkerPool> pool_;                     // Parallel
+    std::unique_ptr<TaskGroup> laneTasks_;                 // Parallel, on pool_
+    std::unique_ptr<FrameMailbox<EdgeFrame>> output_;
+    std::thread thread_;
+
+    uint64_t nextSequence_ = 0; // submit() side
+    uint64_t nextLane_ = 0;     // submit() side: frames handed to lanes
+
+    // Parallel: serializes publishing, the output mailbox's producer side.
+    std::mutex publishMutex_;
+    uint64_t nextPublish_ = 0; // the lane frame to publish next
+
+    std::mutex parkMutex_;
+    std::condition_variable wake_;
+    std::atomic<int> parked_{0};
+    std::atomic<bool> stop_{false};
+
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> superseded_{0};
+    std::atomic<uint64_t> displayed_{0};
+};
+
+} // namespace edgeviewer
@@ -0,0 +1,96 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace edgeviewer {
+
+// posix_memalign rather than aligned operator new: it exists on every
+// Android API level the app supports.
+static uint8_t* allocateAligned(size_t bytes) {
+    void* data = nullptr;
+    if (posix_memalign(&data, FrameArena::kAlignment, std::max<size_t>(bytes, 1)) != 0) throw std::bad_alloc();
+    return static_cast<uint8_t*>(data);
+}
+
+FrameArena::~FrameArena() {
+    release();
+}
+
+FrameArena::FrameArena(FrameArena&& other) noexcept
+    : block_(std::exchange(other.block_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      offset_(std::exchange(other.offset_, 0)),
+      overflow_(std::move(other.overflow_)),
+      overflowBytes_(std::exchange(other.overflowBytes_, 0)),
+      highWater_(std::exchange(other.highWater_, 0)) {
+    other.overflow_.clear();
+}
+
+FrameArena& FrameArena::operator=(FrameArena&& other) noexcept {
+    if (this != &other) {
+        release();
+        block_ = std::exchange(other.block_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        offset_ = std::exchange(other.offset_, 0);
+        overflow_ = std::move(other.overflow_);
+        other.overflow_.clear();
+        overflowBytes_ = std::exchange(other.overflowBytes_, 0);
+        highWater_ = std::exchange(other.highWater_, 0);
+    }
+    return *this;
+}
+
+void* FrameArena::allocateBytes(size_t bytes) {
+    const size_t size = footprint(bytes);
+    void* result;
+    if (size <= capacity_ - offset_) {
+        result = block_ + offset_;
+        offset_ += size;
+    } else {
+        Block spill{allocateAligned(size), size};
+        overflow_.push_back(spill);
+        overflowBytes_ += size;
+        result = spill.data;
+    }
+    highWater_ = std::max(highWater_, used());
+    return result;
+}
+
+void FrameArena::rewind(const Mark& mark) {
+    while (overflow_.size() > mark.overflowBlocks) {
+        overflowBytes_ -= overflow_.back().size;
+        std::free(overflow_.back().data);
+        overflow_.pop_back();
+    }
+    offset_ = mark.offset;
+    if (offset_ == 0 && overflow_.empty() && highWater_ > capacity_) growBlock(highWater_);
+}
+
+void FrameArena::reserve(size_t bytes) {
+    highWater_ = std::max(highWater_, footprint(bytes));
+    if (used() == 0 && highWater_ > capacity_) growBlock(highWater_);
+}
+
+void FrameArena::release() {
+    highWater_ = 0;
+    rewind(Mark());
+    std::free(block_);
+    block_ = nullptr;
+    capacity_ = 0;
+}
+
+// Only called while the arena is empty.
+void FrameArena::growBlock(size_t bytes) {
+    uint8_t* data = allocateAligned(bytes);
+    std::free(block_);
+    // Fault the pages in now rather than in the first frame that uses them.
+    std::memset(data, 0, bytes);
+    block_ = data;
+    capacity_ = bytes;
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace edgeviewer {
+
+// Bump allocator for the intermediates of one frame. Allocations are
+// uninitialized and kAlignment (one cache line) aligned, so SIMD loads never
+// straddle a line at a row start and nothing is zeroed that the next stage
+// overwrites anyway. reset() releases them all at once by rewinding an
+// offset.
+//
+// A request that does not fit the block is served from a separate overflow
+// block. The next time the arena is rewound to empty, block and overflow are
+// replaced by a single block the size of the high-water mark, so a stream of
+// similar frames settles on one block and stops allocating. New blocks are
+// written once when they are created, which takes their page faults outside
+// the frames that use them.
+//
+// Not thread-safe: carve out every buffer before fanning out to workers.
+class FrameArena {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    // Position to rewind to; see rewind().
+    struct Mark {
+        size_t offset = 0;
+        size_t overflowBlocks = 0;
+    };
+
+    // Rewinds the arena to where it was on construction.
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) : arena_(arena), mark_(arena.mark()) {}
+        ~Scope() { arena_.rewind(mark_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameArena& arena_;
+        Mark mark_;
+    };
+
+    FrameArena() = default;
+    ~FrameArena();
+    FrameArena(FrameArena&& other) noexcept;
+    FrameArena& operator=(FrameArena&& other) noexcept;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Room for `count` T's, valid until the arena is rewound past it. Never
+    // null, even for count 0.
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        static_assert(alignof(T) <= kAlignment, "arena alignment is one cache line");
+        return static_cast<T*>(allocateBytes(count * sizeof(T)));
+    }
+
+    void* allocateBytes(size_t bytes);
+
+    // Bytes an allocation of `bytes` takes from the arena.
+    static constexpr size_t footprint(size_t bytes) {
+        return (bytes + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    Mark mark() const { return Mark{offset_, overflow_.size()}; }
+
+    // Releases everything allocated after `mark` in O(1). Rewinding to an
+    // empty arena also trades any overflow for a block that fits the
+    // high-water mark.
+    void rewind(const Mark& mark);
+
+    // Releases every allocation; called at frame start.
+    void reset() { rewind(Mark()); }
+
+    // Makes the block hold at least `bytes` once the arena is next empty
+    // (immediately if it is empty now).
+    void reserve(size_t bytes);
+
+    // Frees all memory and forgets the high-water mark.
+    void release();
+
+    // Bytes currently allocated, the block size, and the most ever
+    // allocated at once (alignment padding included).
+    size_t used() const { return offset_ + overflowBytes_; }
+    size_t capacity() const { return capacity_; }
+    size_t highWater() const { return highWater_; }
+
+private:
+    struct Block {
+        uint8_t* data;
+        size_t size;
+    };
+
+    void growBlock(size_t bytes);
+
+    uint8_t* block_ = nullptr;
+    size_t capacity_ = 0;
+    size_t offset_ = 0;
+    std::vector<Block> overflow_;
+    size_t overflowBytes_ = 0;
+    size_t highWater_ = 0;
+};
+
+} // namespace edgeviewer
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace edgeviewer {
+
+// Latest-wins handoff of slots from one producer thread to one consumer
+// thread: a lock-free triple buffer. The producer always has a slot to fill
+// and publishing it replaces whatever the consumer has not taken yet, so the
+// consumer only ever sees the newest frame and the producer never waits or
+// drops what it has just written; the frame it replaces is the one lost.
+//
+// Of the three slots, one belongs to the producer (back), one to the
+// consumer (front) and one is the mailbox (pending). Publishing swaps back
+// and pending, taking swaps front and pending, each with a single atomic
+// exchange of the pending index plus a "fresh" bit the producer sets and
+// the consumer clears. The exchanges are acquire-release, so a slot's
+// contents travel with it and neither side touches a slot the other owns.
+//
+// Same calls as FrameRing, so either can sit between two threads. Prepare
+// slots through slot() before the threads start.
+template <typename Slot>
+class FrameMailbox {
+public:
+    FrameMailbox() = default;
+
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    static constexpr size_t capacity() { return 3; }
+    Slot& slot(size_t index) { return slots_[index]; }
+
+    // Producer: the slot to fill; never nullptr.
+    Slot* beginWrite() { return &slots_[back_]; }
+
+    // Producer: publishes the slot from beginWrite(). Returns true when it
+    // replaced a slot the consumer never took.
+    bool commitWrite() {
+        const unsigned previous = pending_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = previous & kIndex;
+        return (previous & kFresh) != 0;
+    }
+
+    // Consumer: the newest published slot, or nullptr when nothing was
+    // published since the last call. Takes over from the slot returned
+    // before, which stays valid until then.
+    Slot* beginRead() {
+        if (!fresh()) return nullptr;
+        const unsigned previous = pending_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & kIndex;
+        return &slots_[front_];
+    }
+
+    // Consumer: nothing to hand back, the slot is released by the next
+    // beginRead(); kept for symmetry with FrameRing.
+    void endRead() {}
+
+    // Whether a slot was published and not yet taken.
+    bool fresh() const { return (pending_.load(std::memory_order_acquire) & kFresh) != 0; }
+
+private:
+    static constexpr unsigned kIndex = 3;
+    static constexpr unsigned kFresh = 4;
+    static constexpr size_t kCacheLine = 64;
+
+    Slot slots_[3];
+    alignas(kCacheLine) unsigned back_ = 0;  // producer only
+    alignas(kCacheLine) unsigned front_ = 1; // consumer only
+    alignas(kCacheLine) std::atomic<unsigned> pending_{2};
+};
+
+} // namespace edgeviewer
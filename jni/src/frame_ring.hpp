@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Lock-free ring of preallocated slots between exactly one producer thread
+// and one consumer thread. Slots are used in place, never copied: the
+// producer fills the slot beginWrite() hands out and publishes it with
+// commitWrite(); the consumer reads the slot beginRead() hands out and gives
+// it back with endRead(). Neither side ever blocks or allocates; a full ring
+// is reported to the producer, which decides what to drop.
+//
+// head_ counts published slots and is written only by the producer, tail_
+// counts released slots and is written only by the consumer. Each side
+// publishes with a release store after it is done with the slot and reads
+// the other's counter with an acquire load, so the slot contents written
+// before commitWrite() are visible after beginRead(), and the consumer's
+// reads finish before the producer reuses the slot. The counters sit on
+// their own cache lines, and each side keeps a private copy of the other's
+// counter that it refreshes only when the ring looks full (or empty), so the
+// steady state does not bounce lines between the two cores.
+//
+// Prepare slots (e.g. reserve their buffers) through slot() before the two
+// threads start; after that, only the side holding a slot may touch it.
+template <typename Slot>
+class FrameRing {
+public:
+    static constexpr size_t kCacheLine = 64;
+
+    // `slots` >= 1.
+    explicit FrameRing(size_t slots) : slots_(slots < 1 ? 1 : slots) {}
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+    Slot& slot(size_t index) { return slots_[index]; }
+
+    // Producer: the next free slot, or nullptr when every slot is published
+    // or being read. Repeated calls before commitWrite() return the same one.
+    Slot* beginWrite() {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - producerTail_ == slots_.size()) {
+            producerTail_ = tail_.load(std::memory_order_acquire);
+            if (head - producerTail_ == slots_.size()) return nullptr;
+        }
+        return &slots_[head % slots_.size()];
+    }
+
+    // Producer: publishes the slot from beginWrite().
+    void commitWrite() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: the oldest published slot, or nullptr when there is none.
+    Slot* beginRead() {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == consumerHead_) {
+            consumerHead_ = head_.load(std::memory_order_acquire);
+            if (tail == consumerHead_) return nullptr;
+        }
+        return &slots_[tail % slots_.size()];
+    }
+
+    // Consumer: hands the slot from beginRead() back to the producer.
+    void endRead() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: published slots not yet handed back, counting the one
+    // being read. Exact on the consumer thread; a hint anywhere else.
+    size_t published() const {
+        return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::vector<Slot> slots_;
+    alignas(kCacheLine) std::atomic<uint64_t> head_{0};
+    uint64_t producerTail_ = 0; // producer's copy of tail_
+    alignas(kCacheLine) std::atomic<uint64_t> tail_{0};
+    uint64_t consumerHead_ = 0; // consumer's copy of head_
+};
+
+} // namespace edgeviewer
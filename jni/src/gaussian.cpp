@@ -0,0 +1,327 @@
+#include "gaussian.hpp"
+
+#include "cpu_features.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+// Every path blurs columns first: taps * 8-bit samples summed into uint16
+// (at most 255 * 256), then rows: taps * those sums into uint32 with a
+// rounding shift of 16. No intermediate is rounded, so the order of the two
+// passes does not change the result and the SIMD kernels match the scalar loop.
+
+namespace edgeviewer {
+
+namespace {
+    constexpr int kMaxTaps = 2 * GaussianKernel::kMaxRadius + 1;
+    constexpr int kOne = 1 << GaussianKernel::kBits;
+    constexpr int kShift = 2 * GaussianKernel::kBits;
+    constexpr uint32_t kRound = 1u << (kShift - 1);
+}
+
+bool makeGaussianKernel(int size, double sigma, GaussianKernel& kernel) {
+    if (size < 1 || size > kMaxTaps || (size & 1) == 0) return false;
+    const int radius = size / 2;
+
+    // Fixed tables cv::getGaussianKernel uses when sigma is not given.
+    static const double kDefaultTaps[GaussianKernel::kMaxRadius + 1][kMaxTaps] = {
+        {1.0},
+        {0.25, 0.5, 0.25},
+        {0.0625, 0.25, 0.375, 0.25, 0.0625},
+        {0.03125, 0.109375, 0.21875, 0.28125, 0.21875, 0.109375, 0.03125},
+    };
+    double values[kMaxTaps];
+    if (sigma <= 0) {
+        std::copy(kDefaultTaps[radius], kDefaultTaps[radius] + size, values);
+    } else {
+        const double scale = -0.5 / (sigma * sigma);
+        double sum = 1.0;
+        for (int i = 0; i < radius; ++i) {
+            values[i] = std::exp(scale * (i - radius) * (i - radius));
+            sum += 2.0 * values[i];
+        }
+        const double norm = 1.0 / sum;
+        for (int i = 0; i < radius; ++i) {
+            values[i] *= norm;
+            values[size - 1 - i] = values[i];
+        }
+        values[radius] = norm;
+    }
+
+    // Outer taps are rounded with error diffusion towards the centre, which
+    // takes whatever is left so the taps sum to exactly 2^kBits.
+    kernel.radius = radius;
+    double err = 0.0;
+    int sideSum = 0;
+    for (int i = 0; i < radius; ++i) {
+        const double adjusted = values[i] * kOne + err;
+        const int tap = static_cast<int>(std::nearbyint(adjusted));
+        err = adjusted - tap;
+        kernel.taps[i] = static_cast<uint16_t>(tap);
+        kernel.taps[size - 1 - i] = static_cast<uint16_t>(tap);
+        sideSum += tap;
+    }
+    kernel.taps[radius] = static_cast<uint16_t>(kOne - 2 * sideSum);
+    return true;
+}
+
+// Column pass for x in [x0, x1): col[x] = sum_k taps[k] * rows[k][x].
+static void verticalScalar(const GaussianKernel& kernel, const uint8_t* const* rows, int x0, int x1, uint16_t* col) {
+    const int taps = 2 * kernel.radius + 1;
+    for (int x = x0; x < x1; ++x) {
+        uint32_t sum = 0;
+        for (int k = 0; k < taps; ++k) {
+            sum += kernel.taps[k] * rows[k][x];
+        }
+        col[x] = static_cast<uint16_t>(sum);
+    }
+}
+
+// Fills the `radius` samples on each side of the column sums by reflection.
+static void padColumns(uint16_t* col, int width, int radius) {
+    for (int k = 1; k <= radius; ++k) {
+        col[-k] = col[borderReflect101(-k, width)];
+        col[width - 1 + k] = col[borderReflect101(width - 1 + k, width)];
+    }
+}
+
+// Row pass for x in [x0, x1) over padded column sums.
+static void horizontalScalar(const GaussianKernel& kernel, const uint16_t* col, int x0, int x1, uint8_t* out) {
+    const int taps = 2 * kernel.radius + 1;
+    for (int x = x0; x < x1; ++x) {
+        const uint16_t* c = col + x - kernel.radius;
+        uint32_t sum = kRound;
+        for (int k = 0; k < taps; ++k) {
+            sum += static_cast<uint32_t>(kernel.taps[k]) * c[k];
+        }
+        out[x] = static_cast<uint8_t>(sum >> kShift);
+    }
+}
+
+void gaussianRowScalar(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                       uint16_t* scratch, uint8_t* out) {
+    uint16_t* col = scratch + GaussianKernel::kMaxRadius;
+    verticalScalar(kernel, rows, 0, width, col);
+    padColumns(col, width, kernel.radius);
+    horizontalScalar(kernel, col, 0, width, out);
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static void gaussianRowNeon(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                            uint16_t* scratch, uint8_t* out) {
+    const int taps = 2 * kernel.radius + 1;
+    uint16_t* col = scratch + GaussianKernel::kMaxRadius;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t lo = vdupq_n_u16(0);
+        uint16x8_t hi = vdupq_n_u16(0);
+        for (int k = 0; k < taps; ++k) {
+            const uint8x16_t px = vld1q_u8(rows[k] + x);
+            lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(px)), kernel.taps[k]);
+            hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(px)), kernel.taps[k]);
+        }
+        vst1q_u16(col + x, lo);
+        vst1q_u16(col + x + 8, hi);
+    }
+    verticalScalar(kernel, rows, x, width, col);
+    padColumns(col, width, kernel.radius);
+
+    x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t half[2];
+        for (int h = 0; h < 2; ++h) {
+            const uint16_t* c = col + x + 8 * h - kernel.radius;
+            uint32x4_t accLo = vdupq_n_u32(0);
+            uint32x4_t accHi = vdupq_n_u32(0);
+            for (int k = 0; k < taps; ++k) {
+                const uint16x8_t v = vld1q_u16(c + k);
+                accLo = vmlal_n_u16(accLo, vget_low_u16(v), kernel.taps[k]);
+                accHi = vmlal_n_u16(accHi, vget_high_u16(v), kernel.taps[k]);
+            }
+            half[h] = vcombine_u16(vrshrn_n_u32(accLo, kShift), vrshrn_n_u32(accHi, kShift));
+        }
+        vst1q_u8(out + x, vcombine_u8(vmovn_u16(half[0]), vmovn_u16(half[1])));
+    }
+    horizontalScalar(kernel, col, x, width, out);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// Eight outputs of the row pass as uint16. x86 has no widening 16x16
+// multiply-accumulate, so products are rebuilt from their low and high halves.
+__attribute__((target("sse4.1")))
+static inline __m128i horizontalSse8(const GaussianKernel& kernel, const uint16_t* c, int taps) {
+    __m128i accLo = _mm_set1_epi32(kRound);
+    __m128i accHi = accLo;
+    for (int k = 0; k < taps; ++k) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + k));
+        const __m128i tap = _mm_set1_epi16(static_cast<short>(kernel.taps[k]));
+        const __m128i lo = _mm_mullo_epi16(v, tap);
+        const __m128i hi = _mm_mulhi_epu16(v, tap);
+        accLo = _mm_add_epi32(accLo, _mm_unpacklo_epi16(lo, hi));
+        accHi = _mm_add_epi32(accHi, _mm_unpackhi_epi16(lo, hi));
+    }
+    return _mm_packus_epi32(_mm_srli_epi32(accLo, kShift), _mm_srli_epi32(accHi, kShift));
+}
+
+__attribute__((target("sse4.1")))
+static void gaussianRowSse41(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                             uint16_t* scratch, uint8_t* out) {
+    const int taps = 2 * kernel.radius + 1;
+    uint16_t* col = scratch + GaussianKernel::kMaxRadius;
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i lo = zero;
+        __m128i hi = zero;
+        for (int k = 0; k < taps; ++k) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+            const __m128i tap = _mm_set1_epi16(static_cast<short>(kernel.taps[k]));
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), tap));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), tap));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(col + x), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(col + x + 8), hi);
+    }
+    verticalScalar(kernel, rows, x, width, col);
+    padColumns(col, width, kernel.radius);
+
+    x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint16_t* c = col + x - kernel.radius;
+        const __m128i packed = _mm_packus_epi16(horizontalSse8(kernel, c, taps), horizontalSse8(kernel, c + 8, taps));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), packed);
+    }
+    horizontalScalar(kernel, col, x, width, out);
+}
+
+// Sixteen outputs of the row pass as uint16, in pixel order (the in-lane
+// unpack and pack undo each other).
+__attribute__((target("avx2")))
+static inline __m256i horizontalAvx16(const GaussianKernel& kernel, const uint16_t* c, int taps) {
+    __m256i accLo = _mm256_set1_epi32(kRound);
+    __m256i accHi = accLo;
+    for (int k = 0; k < taps; ++k) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + k));
+        const __m256i tap = _mm256_set1_epi16(static_cast<short>(kernel.taps[k]));
+        const __m256i lo = _mm256_mullo_epi16(v, tap);
+        const __m256i hi = _mm256_mulhi_epu16(v, tap);
+        accLo = _mm256_add_epi32(accLo, _mm256_unpacklo_epi16(lo, hi));
+        accHi = _mm256_add_epi32(accHi, _mm256_unpackhi_epi16(lo, hi));
+    }
+    return _mm256_packus_epi32(_mm256_srli_epi32(accLo, kShift), _mm256_srli_epi32(accHi, kShift));
+}
+
+__attribute__((target("avx2")))
+static void gaussianRowAvx2(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                            uint16_t* scratch, uint8_t* out) {
+    const int taps = 2 * kernel.radius + 1;
+    uint16_t* col = scratch + GaussianKernel::kMaxRadius;
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+        for (int k = 0; k < taps; ++k) {
+            const __m128i* p = reinterpret_cast<const __m128i*>(rows[k] + x);
+            const __m256i tap = _mm256_set1_epi16(static_cast<short>(kernel.taps[k]));
+            lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(p)), tap));
+            hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(p + 1)), tap));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(col + x), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(col + x + 16), hi);
+    }
+    verticalScalar(kernel, rows, x, width, col);
+    padColumns(col, width, kernel.radius);
+
+    x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const uint16_t* c = col + x - kernel.radius;
+        const __m256i packed = _mm256_packus_epi16(horizontalAvx16(kernel, c, taps), horizontalAvx16(kernel, c + 16, taps));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    horizontalScalar(kernel, col, x, width, out);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static GaussianRowKernel selectGaussianRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return gaussianRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return gaussianRowAvx2;
+    if (cpu.sse41) return gaussianRowSse41;
+#endif
+    (void)cpu;
+    return gaussianRowScalar;
+}
+
+GaussianRowKernel gaussianRowKernel() {
+    static const GaussianRowKernel kernel = selectGaussianRowKernel();
+    return kernel;
+}
+
+std::vector<IsaKernel<GaussianRowKernel>> gaussianRowKernels() {
+    std::vector<IsaKernel<GaussianRowKernel>> kernels{{"scalar", gaussianRowScalar}};
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) kernels.push_back({"sse4.1", gaussianRowSse41});
+    if (cpu.avx2) kernels.push_back({"avx2", gaussianRowAvx2});
+#endif
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) kernels.push_back({"neon", gaussianRowNeon});
+#endif
+    (void)cpu;
+    return kernels;
+}
+
+void gaussianBlurRows(GrayRowSource& source,
+                      int width,
+                      int height,
+                      const GaussianKernel& kernel,
+                      int y0,
+                      int y1,
+                      uint8_t* dst,
+                      int dstStride) {
+    const int radius = kernel.radius;
+    const int ringRows = 2 * radius + 1;
+    const size_t w = static_cast<size_t>(width);
+    std::vector<uint8_t> ring(static_cast<size_t>(ringRows) * w);
+    std::vector<uint16_t> scratch(w + 2 * GaussianKernel::kMaxRadius);
+    const uint8_t* ringRowPtrs[kMaxTaps] = {};
+    const uint8_t* rows[kMaxTaps];
+    const GaussianRowKernel blurRow = gaussianRowKernel();
+
+    // Reflected neighbours always lie within the last ringRows rows fetched.
+    int next = std::max(y0 - radius, 0);
+    for (int y = y0; y < y1; ++y) {
+        for (const int last = std::min(y + radius, height - 1); next <= last; ++next) {
+            const int slot = next % ringRows;
+            ringRowPtrs[slot] = source.row(next, ring.data() + static_cast<size_t>(slot) * w);
+        }
+        for (int k = 0; k < ringRows; ++k) {
+            rows[k] = ringRowPtrs[borderReflect101(y - radius + k, height) % ringRows];
+        }
+        blurRow(kernel, rows, width, scratch.data(), dst + static_cast<size_t>(y) * static_cast<size_t>(dstStride));
+    }
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "cpu_features.hpp"
+#include "gray_row_source.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Separable integer Gaussian. Each 1-D kernel has Q8 taps summing to exactly
+// 256, so the vertical pass over 8-bit rows is exact in 16 bits and the 2-D
+// result is (sum + 2^15) >> 16 -- the fixed-point scheme cv::GaussianBlur
+// uses for CV_8U, which keeps the two bit-identical.
+struct GaussianKernel {
+    static constexpr int kMaxRadius = 3; // kernel sizes 1, 3, 5 and 7
+    static constexpr int kBits = 8;
+
+    int radius = 0;
+    uint16_t taps[2 * kMaxRadius + 1] = {256};
+};
+
+// Builds the kernel for an odd `size` in [1, 7]. sigma <= 0 derives sigma
+// from the size like cv::getGaussianKernel (for 3/5/7 that is the binomial
+// [1 2 1]/4, [1 4 6 4 1]/16, ...); taps are quantized with the same error
+// diffusion as OpenCV. Returns false for unsupported sizes.
+bool makeGaussianKernel(int size, double sigma, GaussianKernel& kernel);
+
+// Mirrors a coordinate into [0, n) without repeating the border sample
+// (OpenCV BORDER_REFLECT_101), reflecting repeatedly if n is tiny.
+inline int borderReflect101(int i, int n) {
+    if (n == 1) return 0;
+    while (i < 0 || i >= n) {
+        i = (i < 0) ? -i : 2 * n - 2 - i;
+    }
+    return i;
+}
+
+// Blurs one row. rows[k] is source row y - radius + k, already reflected at
+// the top and bottom of the image; left and right borders are reflected
+// here. `scratch` holds width + 2 * GaussianKernel::kMaxRadius 16-bit values.
+using GaussianRowKernel = void (*)(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                                   uint16_t* scratch, uint8_t* out);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void gaussianRowScalar(const GaussianKernel& kernel, const uint8_t* const* rows, int width,
+                       uint16_t* scratch, uint8_t* out);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+GaussianRowKernel gaussianRowKernel();
+
+// Every kernel the running CPU supports, scalar first and the one
+// gaussianRowKernel() returns last.
+std::vector<IsaKernel<GaussianRowKernel>> gaussianRowKernels();
+
+// Blurs output rows [y0, y1) of a width x height image, streaming source rows
+// through a (2 * radius + 1)-row line buffer. Row y is written to
+// dst + y * dstStride.
+void gaussianBlurRows(GrayRowSource& source,
+                      int width,
+                      int height,
+                      const GaussianKernel& kernel,
+                      int y0,
+                      int y1,
+                      uint8_t* dst,
+                      int dstStride);
+
+} // namespace edgeviewer
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace edgeviewer {
+
+// Supplies gray rows to the streaming stages (Gaussian blur, Canny). A frame
+// is processed in horizontal bands; each band requests its rows (plus the
+// stencil halo rows) in increasing order, and different bands may call row()
+// concurrently from worker threads.
+class GrayRowSource {
+public:
+    virtual ~GrayRowSource() = default;
+
+    // Returns `width` gray bytes for source row y. Implementations either
+    // point straight into their own storage or convert into `scratch`
+    // (width bytes, left untouched by the caller for as long as it keeps
+    // the row in its line buffer) and return it.
+    virtual const uint8_t* row(int y, uint8_t* scratch) = 0;
+};
+
+} // namespace edgeviewer
@@ -0,0 +1,49 @@
+#include "image_stages.hpp"
+#include "pixel_expr.hpp"
+
+#include <algorithm>
+
+namespace edgeviewer {
+
+void LumaStage::processRow(const uint8_t* const* rows, int width, int /*y*/, uint8_t* out, void* /*scratch*/) const {
+    toGray_(rows[0], out, width);
+}
+
+size_t GaussianStage::scratchBytes(int width) const {
+    return (static_cast<size_t>(width) + 2 * GaussianKernel::kMaxRadius) * sizeof(uint16_t);
+}
+
+void GaussianStage::processRow(const uint8_t* const* rows, int width, int /*y*/, uint8_t* out, void* scratch) const {
+    blurRow_(kernel_, rows, width, static_cast<uint16_t*>(scratch), out);
+}
+
+// Kernel scratch (2 * (width + 2) values), then dx and dy.
+size_t SobelMagnitudeStage::scratchBytes(int width) const {
+    return (2 * (static_cast<size_t>(width) + 2) + 2 * static_cast<size_t>(width)) * sizeof(int16_t);
+}
+
+void SobelMagnitudeStage::processRow(const uint8_t* const* rows, int width, int /*y*/, uint8_t* out, void* scratch) const {
+    int16_t* kernelScratch = static_cast<int16_t*>(scratch);
+    int16_t* dx = kernelScratch + 2 * (static_cast<size_t>(width) + 2);
+    int16_t* dy = dx + width;
+    sobelRow_(rows[0], rows[1], rows[2], width, kernelScratch, dx, dy, reinterpret_cast<int*>(out), magnitude_);
+}
+
+void MagnitudeThresholdStage::processRow(const uint8_t* const* rows, int width, int /*y*/, uint8_t* out, void* /*scratch*/) const {
+    const int* mag = reinterpret_cast<const int*>(rows[0]);
+    px::evaluateRows(px::threshold(px::plane(mag, width, 1, 0), threshold_), 0, 1, out, 0);
+}
+
+void DilateStage::processRow(const uint8_t* const* rows, int width, int /*y*/, uint8_t* out, void* /*scratch*/) const {
+    auto column = [&](int x) { return std::max(std::max(rows[0][x], rows[1][x]), rows[2][x]); };
+    uint8_t left = column(0);
+    uint8_t centre = left;
+    for (int x = 0; x < width; ++x) {
+        const uint8_t right = column(std::min(x + 1, width - 1));
+        out[x] = std::max(std::max(left, centre), right);
+        left = centre;
+        centre = right;
+    }
+}
+
+} // namespace edgeviewer
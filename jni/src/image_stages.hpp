@@ -0,0 +1,91 @@
+#pragma once
+
+#include "gaussian.hpp"
+#include "luma_kernels.hpp"
+#include "sobel.hpp"
+#include "stage_graph.hpp"
+
+#include <cstdint>
+
+namespace edgeviewer {
+
+// Ready-made StageGraph stages built on the row kernels of the other
+// modules, so a graph runs the same SIMD code (and gives the same bits) as
+// the dedicated entry points.
+
+// Interleaved pixels in `format` -> 8-bit luma (luma_kernels.hpp).
+class LumaStage : public RowStage {
+public:
+    explicit LumaStage(PixelFormat format) : toGray_(lumaRowKernel(format)) {}
+
+    StageFootprint footprint() const override { return StageFootprint(); }
+    int outputPixelBytes() const override { return 1; }
+    void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const override;
+
+private:
+    LumaRowKernel toGray_;
+};
+
+// 8-bit Gaussian blur, bit-identical to processGaussianBlur.
+class GaussianStage : public RowStage {
+public:
+    explicit GaussianStage(const GaussianKernel& kernel) : kernel_(kernel), blurRow_(gaussianRowKernel()) {}
+
+    StageFootprint footprint() const override {
+        return StageFootprint{StageShape::Stencil, kernel_.radius, StageBorder::Reflect101};
+    }
+    int outputPixelBytes() const override { return 1; }
+    size_t scratchBytes(int width) const override;
+    void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const override;
+
+private:
+    GaussianKernel kernel_;
+    GaussianRowKernel blurRow_;
+};
+
+// 8-bit -> int32 3x3 Sobel magnitude (L1 or squared L2), replicated borders
+// as in sobelRows. The gradients themselves stay in scratch.
+class SobelMagnitudeStage : public RowStage {
+public:
+    explicit SobelMagnitudeStage(SobelMagnitude magnitude) : magnitude_(magnitude), sobelRow_(sobelRowKernel()) {}
+
+    StageFootprint footprint() const override {
+        return StageFootprint{StageShape::Stencil, 1, StageBorder::Replicate};
+    }
+    int outputPixelBytes() const override { return static_cast<int>(sizeof(int)); }
+    size_t scratchBytes(int width) const override;
+    void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const override;
+
+private:
+    SobelMagnitude magnitude_;
+    SobelRowKernel sobelRow_;
+};
+
+// int32 magnitude -> 0/255: 255 where the magnitude is above `threshold`.
+// The threshold can change between frames.
+class MagnitudeThresholdStage : public RowStage {
+public:
+    explicit MagnitudeThresholdStage(int threshold) : threshold_(threshold) {}
+
+    void setThreshold(int threshold) { threshold_ = threshold; }
+
+    StageFootprint footprint() const override { return StageFootprint(); }
+    int outputPixelBytes() const override { return 1; }
+    void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const override;
+
+private:
+    int threshold_;
+};
+
+// 8-bit 3x3 dilation (maximum), replicated borders: thickens a 0/255 mask
+// by one pixel on every side.
+class DilateStage : public RowStage {
+public:
+    StageFootprint footprint() const override {
+        return StageFootprint{StageShape::Stencil, 1, StageBorder::Replicate};
+    }
+    int outputPixelBytes() const override { return 1; }
+    void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const override;
+};
+
+} // namespace edgeviewer
@@ -0,0 +1,358 @@
+#include "incremental_edges.hpp"
+
+#include "cpu_features.hpp"
+#include "edge_mask.hpp"
+#include "gaussian.hpp"
+#include "luma_kernels.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+namespace edgeviewer {
+
+uint32_t tileDiffRowScalar(const uint8_t* a, const uint8_t* b, int width, uint8_t noise) {
+    uint32_t sum = 0;
+    for (int x = 0; x < width; ++x) {
+        const int diff = (a[x] > b[x]) ? a[x] - b[x] : b[x] - a[x];
+        sum += static_cast<uint32_t>(std::max(diff - noise, 0));
+    }
+    return sum;
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static uint32_t tileDiffRowNeon(const uint8_t* a, const uint8_t* b, int width, uint8_t noise) {
+    // |a - b| (vabd), minus the noise with unsigned saturation, widened by
+    // pairwise adds into four 32-bit lanes.
+    const uint8x16_t floor = vdupq_n_u8(noise);
+    uint32x4_t acc = vdupq_n_u32(0);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t excess = vqsubq_u8(vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x)), floor);
+        acc = vpadalq_u16(acc, vpaddlq_u8(excess));
+    }
+    const uint64x2_t halves = vpaddlq_u32(acc);
+    const uint32_t sum = static_cast<uint32_t>(vgetq_lane_u64(halves, 0) + vgetq_lane_u64(halves, 1));
+    return sum + tileDiffRowScalar(a + x, b + x, width - x, noise);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// |a - b| is the OR of the two saturating differences; psadbw against zero
+// then sums the excess over the noise floor into 64-bit lanes.
+
+__attribute__((target("sse4.1")))
+static uint32_t tileDiffRowSse41(const uint8_t* a, const uint8_t* b, int width, uint8_t noise) {
+    const __m128i floor = _mm_set1_epi8(static_cast<char>(noise));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_subs_epu8(diff, floor), zero));
+    }
+    const uint32_t sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_extract_epi32(acc, 2));
+    return sum + tileDiffRowScalar(a + x, b + x, width - x, noise);
+}
+
+__attribute__((target("avx2")))
+static uint32_t tileDiffRowAvx2(const uint8_t* a, const uint8_t* b, int width, uint8_t noise) {
+    const __m256i floor = _mm256_set1_epi8(static_cast<char>(noise));
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x));
+        const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_subs_epu8(diff, floor), zero));
+    }
+    const __m128i folded = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    const uint32_t sum = static_cast<uint32_t>(_mm_cvtsi128_si32(folded) + _mm_extract_epi32(folded, 2));
+    // The SSE tail is legacy-encoded: clear the upper halves first, or every
+    // call pays an AVX-SSE transition (it made 64-pixel calls ~15x slower).
+    _mm256_zeroupper();
+    return sum + tileDiffRowSse41(a + x, b + x, width - x, noise);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static TileDiffRowKernel selectTileDiffRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return tileDiffRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return tileDiffRowAvx2;
+    if (cpu.sse41) return tileDiffRowSse41;
+#endif
+    (void)cpu;
+    return tileDiffRowScalar;
+}
+
+TileDiffRowKernel tileDiffRowKernel() {
+    static const TileDiffRowKernel kernel = selectTileDiffRowKernel();
+    return kernel;
+}
+
+// `rect` grown by `halo` on every side, clamped to a width x height frame.
+static RoiRect growRect(const RoiRect& rect, int halo, int width, int height) {
+    const int x0 = std::max(0, rect.x - halo);
+    const int y0 = std::max(0, rect.y - halo);
+    const int x1 = std::min(width, rect.x + rect.width + halo);
+    const int y1 = std::min(height, rect.y + rect.height + halo);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+IncrementalEdgeDetector::IncrementalEdgeDetector(const IncrementalParams& params) : params_(params) {}
+
+void IncrementalEdgeDetector::reset() {
+    valid_ = false;
+}
+
+bool IncrementalEdgeDetector::processLuma(const PlaneView& luma,
+                                          double lowThreshold,
+                                          double highThreshold,
+                                          uint8_t* outBuffer,
+                                          size_t outBufferSize,
+                                          size_t& outBytesWritten,
+                                          const BlurParams& blur,
+                                          EdgeMaskFormat format) {
+    if (luma.data == nullptr) {
+        outBytesWritten = 0;
+        return false;
+    }
+    const int pixelStride = (luma.pixelStride > 0) ? luma.pixelStride : 1;
+    const int rowStride = (luma.rowStride > 0) ? luma.rowStride : luma.width * pixelStride;
+    auto loadRow = [&](int y, uint8_t* dst) {
+        const uint8_t* src = luma.data + static_cast<size_t>(y) * static_cast<size_t>(rowStride);
+        if (pixelStride == 1) {
+            std::memcpy(dst, src, static_cast<size_t>(luma.width));
+            return;
+        }
+        for (int x = 0; x < luma.width; ++x) {
+            dst[x] = src[static_cast<size_t>(x) * static_cast<size_t>(pixelStride)];
+        }
+    };
+    return process(luma.width, luma.height, loadRow, lowThreshold, highThreshold,
+                   outBuffer, outBufferSize, outBytesWritten, blur, format);
+}
+
+bool IncrementalEdgeDetector::processRgba(const ImageView& inputRgba,
+                                          double lowThreshold,
+                                          double highThreshold,
+                                          uint8_t* outBuffer,
+                                          size_t outBufferSize,
+                                          size_t& outBytesWritten,
+                                          const BlurParams& blur,
+                                          EdgeMaskFormat format) {
+    if (inputRgba.data == nullptr || bytesPerPixel(inputRgba.format) == 0) {
+        outBytesWritten = 0;
+        return false;
+    }
+    const LumaRowKernel toGray = lumaRowKernel(inputRgba.format);
+    const int srcStride = (inputRgba.stride > 0) ? inputRgba.stride : inputRgba.width * bytesPerPixel(inputRgba.format);
+    auto loadRow = [&](int y, uint8_t* dst) {
+        toGray(inputRgba.data + static_cast<size_t>(y) * static_cast<size_t>(srcStride), dst, inputRgba.width);
+    };
+    return process(inputRgba.width, inputRgba.height, loadRow, lowThreshold, highThreshold,
+                   outBuffer, outBufferSize, outBytesWritten, blur, format);
+}
+
+template <typename LoadRow>
+bool IncrementalEdgeDetector::process(int width,
+                                      int height,
+                                      LoadRow loadRow,
+                                      double lowThreshold,
+                                      double highThreshold,
+                                      uint8_t* outBuffer,
+                                      size_t outBufferSize,
+                                      size_t& outBytesWritten,
+                                      const BlurParams& blur,
+                                      EdgeMaskFormat format) {
+    const bool sparse = format == EdgeMaskFormat::Points || format == EdgeMaskFormat::Runs;
+    GaussianKernel kernel;
+    if (width <= 0 || height <= 0 || params_.tileSize <= 0 || !makeGaussianKernel(blur.kernelSize, blur.sigma, kernel) ||
+        (sparse && (width > kMaxSparseEdgeSide || height > kMaxSparseEdgeSide))) {
+        outBytesWritten = 0;
+        return false;
+    }
+    if (!sparse) {
+        const size_t need = requiredEdgeMaskBytes(width, height, format);
+        if (outBuffer == nullptr || outBufferSize < need) {
+            outBytesWritten = need;
+            return false;
+        }
+    }
+
+    const bool cached = valid_ && width == width_ && height == height_ && lowThreshold == lowThreshold_ &&
+                        highThreshold == highThreshold_ && blur.kernelSize == blur_.kernelSize && blur.sigma == blur_.sigma;
+    const int tile = params_.tileSize;
+    if (!cached) {
+        width_ = width;
+        height_ = height;
+        tilesX_ = (width + tile - 1) / tile;
+        tilesY_ = (height + tile - 1) / tile;
+        lowThreshold_ = lowThreshold;
+        highThreshold_ = highThreshold;
+        blur_ = blur;
+        const size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+        reference_.resize(pixels);
+        current_.resize(pixels);
+        cache_.resize(packedMaskStride(width) * static_cast<size_t>(height));
+        dirty_.resize(static_cast<size_t>(tilesX_) * static_cast<size_t>(tilesY_));
+    }
+
+    // Gather the frame and test its tiles, one row of tiles per task. A
+    // tile stops comparing as soon as it is known to be dirty.
+    const TileDiffRowKernel diffRow = tileDiffRowKernel();
+    const uint8_t noise = static_cast<uint8_t>(std::min(std::max(params_.noiseLevel, 0), 255));
+    const uint32_t limit = static_cast<uint32_t>(std::max(params_.tileThreshold, 0));
+    const std::shared_ptr<WorkerPool> pool = sharedWorkerPool();
+    pool->parallelFor(tilesY_, [&](int ty) {
+        const int y0 = ty * tile;
+        const int y1 = std::min(height, y0 + tile);
+        for (int y = y0; y < y1; ++y) {
+            loadRow(y, current_.data() + static_cast<size_t>(y) * static_cast<size_t>(width));
+        }
+        for (int tx = 0; tx < tilesX_; ++tx) {
+            const int x0 = tx * tile;
+            const int x1 = std::min(width, x0 + tile);
+            bool changed = !cached;
+            uint32_t sum = 0;
+            for (int y = y0; y < y1 && !changed; ++y) {
+                const size_t offset = static_cast<size_t>(y) * static_cast<size_t>(width) + static_cast<size_t>(x0);
+                sum += diffRow(current_.data() + offset, reference_.data() + offset, x1 - x0, noise);
+                changed = sum > limit;
+            }
+            dirty_[static_cast<size_t>(ty) * static_cast<size_t>(tilesX_) + static_cast<size_t>(tx)] = changed ? 1 : 0;
+        }
+    });
+    dirtyTiles_ = static_cast<int>(std::count(dirty_.begin(), dirty_.end(), 1));
+
+    // Past half the frame, the overlapping halos of separate regions cost
+    // more than one full pass.
+    bool ok = true;
+    if (!cached || dirtyTiles_ * 2 > tileCount()) {
+        ok = recomputeAll(lowThreshold, highThreshold, blur);
+    } else if (dirtyTiles_ > 0) {
+        ok = recomputeDirty(lowThreshold, highThreshold, blur, kernel.radius + 2);
+    }
+    valid_ = ok;
+    if (!ok) {
+        outBytesWritten = 0;
+        return false;
+    }
+    return writeOutput(format, outBuffer, outBufferSize, outBytesWritten);
+}
+
+bool IncrementalEdgeDetector::recomputeAll(double lowThreshold, double highThreshold, const BlurParams& blur) {
+    reference_.swap(current_);
+    dirtyTiles_ = tileCount();
+    size_t written = 0;
+    return processLumaEdges(PlaneView{reference_.data(), width_, height_, width_, 1}, lowThreshold, highThreshold,
+                            cache_.data(), cache_.size(), written, blur, EdgeMaskFormat::Packed);
+}
+
+bool IncrementalEdgeDetector::recomputeDirty(double lowThreshold, double highThreshold, const BlurParams& blur, int halo) {
+    // Horizontal runs of dirty tiles become one region each; their new
+    // pixels replace the reference.
+    const int tile = params_.tileSize;
+    const size_t width = static_cast<size_t>(width_);
+    regions_.clear();
+    for (int ty = 0; ty < tilesY_; ++ty) {
+        const uint8_t* flags = dirty_.data() + static_cast<size_t>(ty) * static_cast<size_t>(tilesX_);
+        for (int tx = 0; tx < tilesX_;) {
+            if (!flags[tx]) {
+                ++tx;
+                continue;
+            }
+            const int first = tx;
+            while (tx < tilesX_ && flags[tx]) ++tx;
+            const RoiRect region = growRect({first * tile, ty * tile, tx * tile - first * tile, tile}, 0, width_, height_);
+            for (int y = region.y; y < region.y + region.height; ++y) {
+                const size_t offset = static_cast<size_t>(y) * width + static_cast<size_t>(region.x);
+                std::memcpy(reference_.data() + offset, current_.data() + offset, static_cast<size_t>(region.width));
+            }
+            regions_.push_back(region);
+        }
+    }
+
+    // A region's edges change up to `halo` pixels outside it, and computing
+    // those needs another `halo` of input. Regions are detected in parallel
+    // into their own buffers, then merged in order.
+    const int count = static_cast<int>(regions_.size());
+    if (results_.size() < regions_.size()) results_.resize(regions_.size());
+    std::atomic<bool> failed(false);
+    sharedWorkerPool()->parallelFor(count, [&](int i) {
+        const RoiRect input = growRect(regions_[i], 2 * halo, width_, height_);
+        std::vector<uint8_t>& result = results_[static_cast<size_t>(i)];
+        result.resize(packedMaskStride(input.width) * static_cast<size_t>(input.height));
+        const PlaneView crop{reference_.data() + static_cast<size_t>(input.y) * width + static_cast<size_t>(input.x),
+                             input.width, input.height, width_, 1};
+        size_t written = 0;
+        if (!processLumaEdges(crop, lowThreshold, highThreshold, result.data(), result.size(), written, blur,
+                              EdgeMaskFormat::Packed)) {
+            failed = true;
+        }
+    });
+    if (failed) return false;
+
+    const size_t cacheStride = packedMaskStride(width_);
+    for (int i = 0; i < count; ++i) {
+        const RoiRect input = growRect(regions_[i], 2 * halo, width_, height_);
+        const RoiRect output = growRect(regions_[i], halo, width_, height_);
+        const size_t resultStride = packedMaskStride(input.width);
+        for (int y = output.y; y < output.y + output.height; ++y) {
+            copyPackedPixels(results_[static_cast<size_t>(i)].data() + static_cast<size_t>(y - input.y) * resultStride,
+                             output.x - input.x, output.width,
+                             cache_.data() + static_cast<size_t>(y) * cacheStride, output.x);
+        }
+    }
+    return true;
+}
+
+bool IncrementalEdgeDetector::writeOutput(EdgeMaskFormat format,
+                                          uint8_t* outBuffer,
+                                          size_t outBufferSize,
+                                          size_t& outBytesWritten) {
+    const size_t stride = packedMaskStride(width_);
+    if (format == EdgeMaskFormat::Packed) {
+        std::memcpy(outBuffer, cache_.data(), cache_.size());
+        outBytesWritten = cache_.size();
+        return true;
+    }
+    if (format == EdgeMaskFormat::Bytes) {
+        return unpackEdgeMask(cache_.data(), width_, height_, outBuffer, outBufferSize, outBytesWritten);
+    }
+
+    SparseEdges edges;
+    edges.clear(format);
+    for (int y = 0; y < height_; ++y) {
+        appendSparseRow(cache_.data() + static_cast<size_t>(y) * stride, width_, y, format, edges);
+    }
+    const size_t need = sparseEdgeBytes(edges, format);
+    outBytesWritten = need;
+    if (need > 0 && (outBuffer == nullptr || outBufferSize < need)) return false;
+    writeSparseEdges(edges, format, outBuffer);
+    return true;
+}
+
+} // namespace edgeviewer
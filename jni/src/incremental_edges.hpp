@@ -0,0 +1,114 @@
+#pragma once
+
+#include "opencv_pipeline.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Sum over a row segment of max(|a - b| - noise, 0): the absolute difference
+// with per-pixel sensor noise discounted.
+using TileDiffRowKernel = uint32_t (*)(const uint8_t* a, const uint8_t* b, int width, uint8_t noise);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+uint32_t tileDiffRowScalar(const uint8_t* a, const uint8_t* b, int width, uint8_t noise);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+TileDiffRowKernel tileDiffRowKernel();
+
+// Change detection for IncrementalEdgeDetector.
+struct IncrementalParams {
+    int tileSize = 64;        // tile side in pixels
+    int noiseLevel = 4;       // per-pixel differences up to this are ignored
+    int tileThreshold = 256;  // a tile is dirty once its summed excess difference exceeds this
+};
+
+// Canny for a mostly static camera. Keeps the gray frame its cached edges
+// were computed from, split into tiles. Each call compares the new frame
+// against it tile by tile (SIMD difference test), copies in only the tiles
+// that changed, and recomputes the edges of those tiles plus the blur
+// radius + 2 pixels around them that they influence. Everything else is
+// served from the cache, so frame time follows scene motion; the full-frame
+// passes left are the gather, the comparison and writing the output.
+//
+// Recomputed regions see their neighbourhood up to one more halo, so
+// hysteresis there cannot follow an edge further than that (as for ROIs).
+// Changes below the test's threshold accumulate against the cached frame
+// until they trip it, so slow drift is picked up eventually. The first
+// frame, a new size or new thresholds/blur, or more than half the tiles
+// changing recompute the whole frame.
+//
+// Not thread-safe: one detector per stream of frames.
+class IncrementalEdgeDetector {
+public:
+    explicit IncrementalEdgeDetector(const IncrementalParams& params = IncrementalParams());
+
+    // Same contract as processLumaEdges. A short buffer is reported before
+    // any state changes (for sparse formats, after: the cache is updated and
+    // only the result is dropped).
+    bool processLuma(const PlaneView& luma,
+                     double lowThreshold,
+                     double highThreshold,
+                     uint8_t* outBuffer,
+                     size_t outBufferSize,
+                     size_t& outBytesWritten,
+                     const BlurParams& blur = BlurParams(),
+                     EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+    // Same as processLuma on the gray conversion of an RGB(A) frame.
+    bool processRgba(const ImageView& inputRgba,
+                     double lowThreshold,
+                     double highThreshold,
+                     uint8_t* outBuffer,
+                     size_t outBufferSize,
+                     size_t& outBytesWritten,
+                     const BlurParams& blur = BlurParams(),
+                     EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+    // Drops the cached frame; the next call recomputes everything.
+    void reset();
+
+    // Tiles per frame, and how many of them the last call recomputed.
+    int tileCount() const { return tilesX_ * tilesY_; }
+    int dirtyTileCount() const { return dirtyTiles_; }
+
+private:
+    template <typename LoadRow>
+    bool process(int width,
+                 int height,
+                 LoadRow loadRow,
+                 double lowThreshold,
+                 double highThreshold,
+                 uint8_t* outBuffer,
+                 size_t outBufferSize,
+                 size_t& outBytesWritten,
+                 const BlurParams& blur,
+                 EdgeMaskFormat format);
+
+    bool recomputeAll(double lowThreshold, double highThreshold, const BlurParams& blur);
+    bool recomputeDirty(double lowThreshold, double highThreshold, const BlurParams& blur, int halo);
+    bool writeOutput(EdgeMaskFormat format, uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten);
+
+    IncrementalParams params_;
+    int width_ = 0;
+    int height_ = 0;
+    int tilesX_ = 0;
+    int tilesY_ = 0;
+    int dirtyTiles_ = 0;
+    bool valid_ = false;
+    double lowThreshold_ = 0.0;
+    double highThreshold_ = 0.0;
+    BlurParams blur_;
+
+    std::vector<uint8_t> reference_; // gray frame the cache was computed from
+    std::vector<uint8_t> current_;   // incoming gray frame
+    std::vector<uint8_t> cache_;     // packed edges of reference_
+    std::vector<uint8_t> dirty_;     // one flag per tile
+    std::vector<RoiRect> regions_;   // runs of dirty tiles, row by row
+    std::vector<std::vector<uint8_t>> results_;
+};
+
+} // namespace edgeviewer
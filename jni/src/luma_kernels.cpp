@@ -0,0 +1,244 @@
+#include "luma_kernels.hpp"
+
+#include "cpu_features.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+namespace edgeviewer {
+
+template <PixelFormat F>
+static void lumaRowScalarT(const uint8_t* src, uint8_t* dst, int width) {
+    using L = PixelLayout<F>;
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* px = src + x * L::kBytes;
+        dst[x] = lumaPixel(px[L::kR], px[L::kG], px[L::kB]);
+    }
+}
+
+void lumaRowScalar(const uint8_t* src, uint8_t* dst, int width, PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA: lumaRowScalarT<PixelFormat::RGBA>(src, dst, width); break;
+    case PixelFormat::BGRA: lumaRowScalarT<PixelFormat::BGRA>(src, dst, width); break;
+    case PixelFormat::ARGB: lumaRowScalarT<PixelFormat::ARGB>(src, dst, width); break;
+    case PixelFormat::RGB:  lumaRowScalarT<PixelFormat::RGB>(src, dst, width); break;
+    case PixelFormat::BGR:  lumaRowScalarT<PixelFormat::BGR>(src, dst, width); break;
+    case PixelFormat::RGBX: lumaRowScalarT<PixelFormat::RGBX>(src, dst, width); break;
+    }
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static_assert(Luma::kShift == 8, "NEON kernel narrows with an 8-bit rounding shift");
+
+// Eight pixels in 16-bit lanes: (77 R + 150 G + 29 B + 128) >> 8.
+static inline uint8x8_t lumaNeon8(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t acc = vmull_u8(r, vdup_n_u8(Luma::kR));
+    acc = vmlal_u8(acc, g, vdup_n_u8(Luma::kG));
+    acc = vmlal_u8(acc, b, vdup_n_u8(Luma::kB));
+    return vrshrn_n_u16(acc, Luma::kShift);
+}
+
+static inline uint8x16_t lumaNeon16(uint8x16_t r, uint8x16_t g, uint8x16_t b) {
+    return vcombine_u8(lumaNeon8(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)),
+                       lumaNeon8(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b)));
+}
+
+template <PixelFormat F>
+static void lumaRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+    using L = PixelLayout<F>;
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        if (L::kBytes == 4) {
+            const uint8x16x4_t px = vld4q_u8(src + x * 4);
+            vst1q_u8(dst + x, lumaNeon16(px.val[L::kR], px.val[L::kG], px.val[L::kB]));
+        } else {
+            const uint8x16x3_t px = vld3q_u8(src + x * 3);
+            vst1q_u8(dst + x, lumaNeon16(px.val[L::kR], px.val[L::kG], px.val[L::kB]));
+        }
+    }
+    lumaRowScalarT<F>(src + x * L::kBytes, dst + x, width - x);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// x86 kernels shuffle each pixel into int16 pairs (R,B) and (G,0), then let
+// pmaddwd form R*wr + B*wb and G*wg as one int32 per pixel.
+
+// Byte shuffles for four pixels of layout F: 16 bytes for 4-byte layouts,
+// the first 12 of 16 loaded bytes for 3-byte ones.
+struct LumaShuffle {
+    int8_t rb[16];
+    int8_t g0[16];
+};
+
+template <PixelFormat F>
+constexpr LumaShuffle lumaShuffle() {
+    using L = PixelLayout<F>;
+    LumaShuffle s{};
+    for (int i = 0; i < 4; ++i) {
+        const int base = i * L::kBytes;
+        s.rb[4 * i + 0] = static_cast<int8_t>(base + L::kR);
+        s.rb[4 * i + 1] = -1;
+        s.rb[4 * i + 2] = static_cast<int8_t>(base + L::kB);
+        s.rb[4 * i + 3] = -1;
+        s.g0[4 * i + 0] = static_cast<int8_t>(base + L::kG);
+        s.g0[4 * i + 1] = -1;
+        s.g0[4 * i + 2] = -1;
+        s.g0[4 * i + 3] = -1;
+    }
+    return s;
+}
+
+template <PixelFormat F>
+constexpr LumaShuffle kLumaShuffle = lumaShuffle<F>();
+
+// A 3-byte block's last 16-byte load ends 4 bytes past its last pixel, so
+// those blocks need two pixels of slack before the row ends.
+template <PixelFormat F>
+constexpr int kLoadSlack = (PixelLayout<F>::kBytes == 3) ? 2 : 0;
+
+__attribute__((target("sse4.1")))
+static inline __m128i lumaSse4(__m128i v, __m128i rbIdx, __m128i g0Idx) {
+    const __m128i rb = _mm_madd_epi16(_mm_shuffle_epi8(v, rbIdx), _mm_set1_epi32((Luma::kB << 16) | Luma::kR));
+    const __m128i g = _mm_madd_epi16(_mm_shuffle_epi8(v, g0Idx), _mm_set1_epi32(Luma::kG));
+    const __m128i sum = _mm_add_epi32(_mm_add_epi32(rb, g), _mm_set1_epi32(Luma::kRound));
+    return _mm_srli_epi32(sum, Luma::kShift);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i loadSse(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+template <PixelFormat F>
+__attribute__((target("sse4.1")))
+static void lumaRowSse41(const uint8_t* src, uint8_t* dst, int width) {
+    constexpr int kStep = 4 * PixelLayout<F>::kBytes; // bytes per four pixels
+    const __m128i rbIdx = loadSse(reinterpret_cast<const uint8_t*>(kLumaShuffle<F>.rb));
+    const __m128i g0Idx = loadSse(reinterpret_cast<const uint8_t*>(kLumaShuffle<F>.g0));
+    int x = 0;
+    for (; x + 16 + kLoadSlack<F> <= width; x += 16) {
+        const uint8_t* p = src + x * PixelLayout<F>::kBytes;
+        const __m128i lo = _mm_packus_epi32(lumaSse4(loadSse(p), rbIdx, g0Idx),
+                                            lumaSse4(loadSse(p + kStep), rbIdx, g0Idx));
+        const __m128i hi = _mm_packus_epi32(lumaSse4(loadSse(p + 2 * kStep), rbIdx, g0Idx),
+                                            lumaSse4(loadSse(p + 3 * kStep), rbIdx, g0Idx));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    lumaRowScalarT<F>(src + x * PixelLayout<F>::kBytes, dst + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lumaAvx8(__m256i v, __m256i rbIdx, __m256i g0Idx) {
+    const __m256i rb = _mm256_madd_epi16(_mm256_shuffle_epi8(v, rbIdx), _mm256_set1_epi32((Luma::kB << 16) | Luma::kR));
+    const __m256i g = _mm256_madd_epi16(_mm256_shuffle_epi8(v, g0Idx), _mm256_set1_epi32(Luma::kG));
+    const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(rb, g), _mm256_set1_epi32(Luma::kRound));
+    return _mm256_srli_epi32(sum, Luma::kShift);
+}
+
+// Eight pixels as two groups of four, one per 128-bit lane.
+__attribute__((target("avx2")))
+static inline __m256i loadAvx(const uint8_t* lo, const uint8_t* hi) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+// Packs four vectors of eight int32 gray values into 32 bytes in pixel order.
+__attribute__((target("avx2")))
+static inline void storeAvx32(uint8_t* dst, __m256i a, __m256i b, __m256i c, __m256i d) {
+    const __m256i ab = _mm256_packus_epi32(a, b);
+    const __m256i cd = _mm256_packus_epi32(c, d);
+    const __m256i packed = _mm256_packus_epi16(ab, cd);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(packed, order));
+}
+
+template <PixelFormat F>
+__attribute__((target("avx2")))
+static void lumaRowAvx2(const uint8_t* src, uint8_t* dst, int width) {
+    constexpr int kStep = 4 * PixelLayout<F>::kBytes;
+    const __m128i rb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kLumaShuffle<F>.rb));
+    const __m128i g0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kLumaShuffle<F>.g0));
+    const __m256i rbIdx = _mm256_broadcastsi128_si256(rb);
+    const __m256i g0Idx = _mm256_broadcastsi128_si256(g0);
+    int x = 0;
+    for (; x + 32 + kLoadSlack<F> <= width; x += 32) {
+        const uint8_t* p = src + x * PixelLayout<F>::kBytes;
+        storeAvx32(dst + x,
+                   lumaAvx8(loadAvx(p, p + kStep), rbIdx, g0Idx),
+                   lumaAvx8(loadAvx(p + 2 * kStep, p + 3 * kStep), rbIdx, g0Idx),
+                   lumaAvx8(loadAvx(p + 4 * kStep, p + 5 * kStep), rbIdx, g0Idx),
+                   lumaAvx8(loadAvx(p + 6 * kStep, p + 7 * kStep), rbIdx, g0Idx));
+    }
+    _mm256_zeroupper(); // avoid an AVX-SSE transition in the SSE tail
+    lumaRowSse41<F>(src + x * PixelLayout<F>::kBytes, dst + x, width - x);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+template <PixelFormat F>
+static LumaRowKernel selectLumaRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return lumaRowNeon<F>;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return lumaRowAvx2<F>;
+    if (cpu.sse41) return lumaRowSse41<F>;
+#endif
+    (void)cpu;
+    return lumaRowScalarT<F>;
+}
+
+LumaRowKernel lumaRowKernel(PixelFormat format) {
+    // In PixelFormat order.
+    static const LumaRowKernel kernels[] = {
+        selectLumaRowKernel<PixelFormat::RGBA>(),
+        selectLumaRowKernel<PixelFormat::BGRA>(),
+        selectLumaRowKernel<PixelFormat::ARGB>(),
+        selectLumaRowKernel<PixelFormat::RGB>(),
+        selectLumaRowKernel<PixelFormat::BGR>(),
+        selectLumaRowKernel<PixelFormat::RGBX>(),
+    };
+    return kernels[static_cast<int>(format)];
+}
+
+template <PixelFormat F>
+static std::vector<IsaKernel<LumaRowKernel>> supportedLumaRowKernels() {
+    std::vector<IsaKernel<LumaRowKernel>> kernels{{"scalar", lumaRowScalarT<F>}};
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) kernels.push_back({"sse4.1", lumaRowSse41<F>});
+    if (cpu.avx2) kernels.push_back({"avx2", lumaRowAvx2<F>});
+#endif
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) kernels.push_back({"neon", lumaRowNeon<F>});
+#endif
+    (void)cpu;
+    return kernels;
+}
+
+std::vector<IsaKernel<LumaRowKernel>> lumaRowKernels(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA: return supportedLumaRowKernels<PixelFormat::RGBA>();
+    case PixelFormat::BGRA: return supportedLumaRowKernels<PixelFormat::BGRA>();
+    case PixelFormat::ARGB: return supportedLumaRowKernels<PixelFormat::ARGB>();
+    case PixelFormat::RGB:  return supportedLumaRowKernels<PixelFormat::RGB>();
+    case PixelFormat::BGR:  return supportedLumaRowKernels<PixelFormat::BGR>();
+    case PixelFormat::RGBX: return supportedLumaRowKernels<PixelFormat::RGBX>();
+    }
+    return {};
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cpu_features.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Fixed-point luma weights (0.299 R + 0.587 G + 0.114 B) scaled by 2^Bits and
+// rounded at compile time. B takes the rounding residue so the weights always
+// sum to exactly 2^Bits and white maps to 255 without clamping.
+template <int Bits>
+struct LumaWeights {
+    static_assert(Bits >= 1 && Bits <= 15, "weights must fit in int16 lanes");
+    static constexpr int kShift = Bits;
+    static constexpr int kR = static_cast<int>(0.299 * (1 << Bits) + 0.5);
+    static constexpr int kG = static_cast<int>(0.587 * (1 << Bits) + 0.5);
+    static constexpr int kB = (1 << Bits) - kR - kG;
+    static constexpr int kRound = 1 << (Bits - 1);
+};
+
+// Precision used by every RGB-to-gray conversion in the pipeline. With 2^8
+// weights (77/150/29) a weighted sum fits in 16 bits, so NEON and SSE work on
+// 8-16 pixels per instruction. Exhaustively checked against the float formula
+// over all 2^24 RGB triples: never off by more than 1 gray level.
+using Luma = LumaWeights<8>;
+
+inline uint8_t lumaPixel(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint8_t>((Luma::kR * r + Luma::kG * g + Luma::kB * b + Luma::kRound) >> Luma::kShift);
+}
+
+// Byte order of an interleaved color pixel. X is a byte the conversions
+// ignore (alpha or padding).
+enum class PixelFormat {
+    RGBA,
+    BGRA,
+    ARGB,
+    RGB,
+    BGR,
+    RGBX,
+};
+
+// Size and R, G, B byte offsets of a layout, for kernels specialized on it.
+template <PixelFormat F>
+struct PixelLayout;
+
+template <> struct PixelLayout<PixelFormat::RGBA> { static constexpr int kBytes = 4, kR = 0, kG = 1, kB = 2; };
+template <> struct PixelLayout<PixelFormat::BGRA> { static constexpr int kBytes = 4, kR = 2, kG = 1, kB = 0; };
+template <> struct PixelLayout<PixelFormat::ARGB> { static constexpr int kBytes = 4, kR = 1, kG = 2, kB = 3; };
+template <> struct PixelLayout<PixelFormat::RGB>  { static constexpr int kBytes = 3, kR = 0, kG = 1, kB = 2; };
+template <> struct PixelLayout<PixelFormat::BGR>  { static constexpr int kBytes = 3, kR = 2, kG = 1, kB = 0; };
+template <> struct PixelLayout<PixelFormat::RGBX> { static constexpr int kBytes = 4, kR = 0, kG = 1, kB = 2; };
+
+// Bytes per pixel of `format`; 0 for a value outside the enum (e.g. a bad
+// integer from Java), which entry points reject.
+constexpr int bytesPerPixel(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA:
+    case PixelFormat::BGRA:
+    case PixelFormat::ARGB:
+    case PixelFormat::RGBX:
+        return 4;
+    case PixelFormat::RGB:
+    case PixelFormat::BGR:
+        return 3;
+    }
+    return 0;
+}
+
+// Converts one row of `width` interleaved pixels to 8-bit gray. Kernels are
+// compiled once per PixelFormat, so the channel order costs nothing at run
+// time and callers never reorder pixels first.
+using LumaRowKernel = void (*)(const uint8_t* src, uint8_t* dst, int width);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void lumaRowScalar(const uint8_t* src, uint8_t* dst, int width, PixelFormat format);
+
+// Fastest kernel for `format` on the running CPU (NEON, AVX2 or SSE4.1),
+// falling back to the scalar reference. Resolved once; safe to call from any
+// thread. `format` must be valid (bytesPerPixel(format) != 0).
+LumaRowKernel lumaRowKernel(PixelFormat format);
+
+// Every `format` kernel the running CPU supports, scalar first and the one
+// lumaRowKernel(format) returns last.
+std::vector<IsaKernel<LumaRowKernel>> lumaRowKernels(PixelFormat format);
+
+} // namespace edgeviewer
@@ -1,6 +1,17 @@
 #include "opencv_pipeline.hpp"
+#include "canny.hpp"
+#include "gaussian.hpp"
+#include "image_stages.hpp"
+#include "luma_kernels.hpp"
+#include "pixel_expr.hpp"
+#include "pyramid.hpp"
+#include "worker_pool.hpp"
+#include "yuv_convert.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <vector>
 
 // Enable OpenCV Canny when OpenCV is available and this macro is defined via build flags
@@ -11,15 +22,249 @@
 
 namespace edgeviewer {
 
+// Smallest band of rows worth handing to another thread for gray conversion.
+static constexpr int kMinGrayBandRows = 64;
+
 static inline size_t requiredGrayBytes(int width, int height) {
     return static_cast<size_t>(width) * static_cast<size_t>(height);
 }
 
+static inline bool isSparseFormat(EdgeMaskFormat format) {
+    return format == EdgeMaskFormat::Points || format == EdgeMaskFormat::Runs;
+}
+
+static inline bool fitsFormat(int width, int height, EdgeMaskFormat format) {
+    return !isSparseFormat(format) || (width <= kMaxSparseEdgeSide && height <= kMaxSparseEdgeSide);
+}
+
+size_t requiredEdgeMaskBytes(int width, int height, EdgeMaskFormat format) {
+    return (format == EdgeMaskFormat::Packed) ? packedMaskStride(width) * static_cast<size_t>(height)
+                                              : requiredGrayBytes(width, height);
+}
+
+// Sparse results are only sized once detection has run, so a short buffer
+// still reports the size this frame needed (and drops the result). An empty
+// Points result needs no buffer at all.
+static bool storeSparseEdges(const SparseEdges& edges,
+                             EdgeMaskFormat format,
+                             uint8_t* outBuffer,
+                             size_t outBufferSize,
+                             size_t& outBytesWritten) {
+    const size_t need = sparseEdgeBytes(edges, format);
+    outBytesWritten = need;
+    if (need > 0 && (outBuffer == nullptr || outBufferSize < need)) return false;
+    writeSparseEdges(edges, format, outBuffer);
+    return true;
+}
+
+static inline bool isValidScale(const ScaleParams& scale) {
+    return scale.factor == 1 || scale.factor == 2 || scale.factor == 4;
+}
+
+// Width or height of the edge result for an input side of `size`.
+static inline int maskSide(int size, const ScaleParams& scale) {
+    return scale.upsampleMask ? size : scaledSize(size, scale.factor);
+}
+
+// Expands a packed mask detected at 1/factor scale to a width x height result
+// in `format`. Dense formats require outBuffer to hold requiredEdgeMaskBytes.
+// Sparse formats build the list in `edges`, upsampling each row into
+// `rowScratch` (packedMaskStride(width) bytes). Dense masks are expanded in
+// bands on `pool`, or on the calling thread when it is null.
+static bool storeUpsampled(const uint8_t* reduced,
+                           int width,
+                           int height,
+                           int factor,
+                           EdgeMaskFormat format,
+                           uint8_t* rowScratch,
+                           SparseEdges& edges,
+                           WorkerPool* pool,
+                           uint8_t* outBuffer,
+                           size_t outBufferSize,
+                           size_t& outBytesWritten) {
+    const size_t reducedStride = packedMaskStride(scaledSize(width, factor));
+    const int reducedHeight = scaledSize(height, factor);
+    if (isSparseFormat(format)) {
+        edges.clear(format);
+        for (int r = 0; r < reducedHeight; ++r) {
+            upsamplePackedRow(reduced + static_cast<size_t>(r) * reducedStride, width, factor, rowScratch);
+            for (int y = r * factor; y < std::min((r + 1) * factor, height); ++y) {
+                appendSparseRow(rowScratch, width, y, format, edges);
+            }
+        }
+        return storeSparseEdges(edges, format, outBuffer, outBufferSize, outBytesWritten);
+    }
+
+    // Each reduced row is expanded once and copied to the factor - 1 rows
+    // below it, in bands of reduced rows.
+    const size_t stride = (format == EdgeMaskFormat::Packed) ? packedMaskStride(width) : static_cast<size_t>(width);
+    const int bands = pool ? std::max(1, std::min(pool->threadCount(), reducedHeight / kMinGrayBandRows)) : 1;
+    const auto upsampleBand = [&](int b) {
+        const int r0 = static_cast<int>(static_cast<int64_t>(reducedHeight) * b / bands);
+        const int r1 = static_cast<int>(static_cast<int64_t>(reducedHeight) * (b + 1) / bands);
+        for (int r = r0; r < r1; ++r) {
+            const uint8_t* src = reduced + static_cast<size_t>(r) * reducedStride;
+            uint8_t* first = outBuffer + static_cast<size_t>(r) * static_cast<size_t>(factor) * stride;
+            if (format == EdgeMaskFormat::Packed) {
+                upsamplePackedRow(src, width, factor, first);
+            } else {
+                upsampleByteRow(src, width, factor, 255, first);
+            }
+            for (int y = r * factor + 1; y < std::min((r + 1) * factor, height); ++y) {
+                std::memcpy(outBuffer + static_cast<size_t>(y) * stride, first, stride);
+            }
+        }
+    };
+    if (bands == 1) {
+        upsampleBand(0);
+    } else {
+        // By reference: std::function never allocates for a reference_wrapper.
+        pool->parallelFor(bands, std::cref(upsampleBand));
+    }
+
+    outBytesWritten = requiredEdgeMaskBytes(width, height, format);
+    return true;
+}
+
+#ifdef EDGEVIEWER_USE_OPENCV
+// Stores a 0/255 cv::Canny result in any format; the dense ones require
+// outBuffer to hold requiredEdgeMaskBytes.
+static bool storeEdges(const cv::Mat& edges,
+                       EdgeMaskFormat format,
+                       FrameArena& arena,
+                       SparseEdges& sparse,
+                       uint8_t* outBuffer,
+                       size_t outBufferSize,
+                       size_t& outBytesWritten) {
+    const MaskPackRowKernel packRow = maskPackRowKernel();
+    if (isSparseFormat(format)) {
+        sparse.clear(format);
+        uint8_t* packed = arena.allocate<uint8_t>(packedMaskStride(edges.cols));
+        for (int y = 0; y < edges.rows; ++y) {
+            packRow(edges.ptr<uint8_t>(y), edges.cols, 0, packed);
+            appendSparseRow(packed, edges.cols, y, format, sparse);
+        }
+        return storeSparseEdges(sparse, format, outBuffer, outBufferSize, outBytesWritten);
+    }
+
+    const size_t packedStride = packedMaskStride(edges.cols);
+    for (int y = 0; y < edges.rows; ++y) {
+        if (format == EdgeMaskFormat::Packed) {
+            packRow(edges.ptr<uint8_t>(y), edges.cols, 0, outBuffer + static_cast<size_t>(y) * packedStride);
+        } else {
+            std::memcpy(outBuffer + static_cast<size_t>(y) * static_cast<size_t>(edges.cols), edges.ptr<uint8_t>(y), static_cast<size_t>(edges.cols));
+        }
+    }
+    outBytesWritten = requiredEdgeMaskBytes(edges.cols, edges.rows, format);
+    return true;
+}
+
+// Blur, Canny and output for an OpenCV build; `gray` is full resolution and
+// may wrap the caller's plane, so it is never written. Packing buffers come
+// from `arena`.
+static bool detectOpenCv(const cv::Mat& gray,
+                         const BlurParams& blur,
+                         const GaussianKernel& kernel,
+                         double lowThreshold,
+                         double highThreshold,
+                         EdgeMaskFormat format,
+                         const ScaleParams& scale,
+                         FrameArena& arena,
+                         SparseEdges& sparse,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten) {
+    const int width = gray.cols;
+    const int height = gray.rows;
+    cv::Mat reduced = gray;
+    if (scale.factor > 1) {
+        cv::resize(gray, reduced, cv::Size(scaledSize(width, scale.factor), scaledSize(height, scale.factor)), 0, 0, cv::INTER_AREA);
+    }
+    cv::Mat smoothed = reduced;
+    if (kernel.radius > 0) {
+        cv::GaussianBlur(reduced, smoothed, cv::Size(blur.kernelSize, blur.kernelSize), blur.sigma, blur.sigma, cv::BORDER_REFLECT_101);
+    }
+
+    cv::Mat edges;
+    if (scale.factor > 1 && scale.upsampleMask) {
+        cv::Canny(smoothed, edges, lowThreshold, highThreshold, 3, true);
+        const MaskPackRowKernel packRow = maskPackRowKernel();
+        const size_t stride = packedMaskStride(edges.cols);
+        uint8_t* packed = arena.allocate<uint8_t>(stride * static_cast<size_t>(edges.rows));
+        for (int y = 0; y < edges.rows; ++y) {
+            packRow(edges.ptr<uint8_t>(y), edges.cols, 0, packed + static_cast<size_t>(y) * stride);
+        }
+        uint8_t* rowScratch = arena.allocate<uint8_t>(packedMaskStride(width));
+        return storeUpsampled(packed, width, height, scale.factor, format, rowScratch, sparse, sharedWorkerPool().get(),
+                              outBuffer, outBufferSize, outBytesWritten);
+    }
+    if (format == EdgeMaskFormat::Bytes) {
+        // Canny straight into the caller's buffer.
+        edges = cv::Mat(smoothed.rows, smoothed.cols, CV_8UC1, outBuffer);
+        cv::Canny(smoothed, edges, lowThreshold, highThreshold, 3, true);
+        outBytesWritten = requiredEdgeMaskBytes(edges.cols, edges.rows, format);
+        return true;
+    }
+    cv::Canny(smoothed, edges, lowThreshold, highThreshold, 3, true);
+    return storeEdges(edges, format, arena, sparse, outBuffer, outBufferSize, outBytesWritten);
+}
+#endif
+
+// Returns `count` packed samples of row y: a pointer into the plane when it
+// is already packed, otherwise the samples gathered into `scratch`.
+static const uint8_t* planeRow(const PlaneView& plane, int y, int count, uint8_t* scratch) {
+    const int pixelStride = (plane.pixelStride > 0) ? plane.pixelStride : 1;
+    const int rowStride = (plane.rowStride > 0) ? plane.rowStride : plane.width * pixelStride;
+    const uint8_t* src = plane.data + static_cast<size_t>(y) * static_cast<size_t>(rowStride);
+    if (pixelStride == 1) return src;
+    for (int x = 0; x < count; ++x) {
+        scratch[x] = src[static_cast<size_t>(x) * static_cast<size_t>(pixelStride)];
+    }
+    return scratch;
+}
+
+namespace {
+    // Feeds RGB(A) rows to the streaming Canny engine, converting each one to
+    // luma on demand.
+    class InterleavedRgbSource : public GrayRowSource {
+    public:
+        explicit InterleavedRgbSource(const ImageView& image)
+            : image_(image),
+              stride_((image.stride > 0) ? image.stride : image.width * bytesPerPixel(image.format)),
+              toGray_(lumaRowKernel(image.format)) {}
+
+        const uint8_t* row(int y, uint8_t* scratch) override {
+            toGray_(image_.data + static_cast<size_t>(y) * static_cast<size_t>(stride_), scratch, image_.width);
+            return scratch;
+        }
+
+    private:
+        const ImageView& image_;
+        int stride_;
+        LumaRowKernel toGray_;
+    };
+
+    // Feeds rows of a luma (or any 8-bit) plane to the streaming stages.
+    // Packed planes are read in place; interleaved ones (pixelStride > 1)
+    // are gathered.
+    class LumaPlaneSource : public GrayRowSource {
+    public:
+        explicit LumaPlaneSource(const PlaneView& plane) : plane_(plane) {}
+
+        const uint8_t* row(int y, uint8_t* scratch) override {
+            return planeRow(plane_, y, plane_.width, scratch);
+        }
+
+    private:
+        const PlaneView& plane_;
+    };
+}
+
 bool processGrayscale(const ImageView& inputRgba,
                       uint8_t* outBuffer,
                       size_t outBufferSize,
                       size_t& outBytesWritten) {
-    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || inputRgba.channels < 3) {
+    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || bytesPerPixel(inputRgba.format) == 0) {
         outBytesWritten = 0;
         return false;
     }
@@ -30,135 +275,687 @@ bool processGrayscale(const ImageView& inputRgba,
         return false;
     }
 
-    // Minimal CPU fallback (no OpenCV yet): convert RGBA to gray using luma approximation.
-    // Gray = 0.299 R + 0.587 G + 0.114 B
-    const uint8_t* srcRow = inputRgba.data;
-    uint8_t* dst = outBuffer;
-    const int srcStride = (inputRgba.stride > 0) ? inputRgba.stride : inputRgba.width * inputRgba.channels;
-    for (int y = 0; y < inputRgba.height; ++y) {
-        const uint8_t* src = srcRow;
-        for (int x = 0; x < inputRgba.width; ++x) {
-            const int idx = x * inputRgba.channels;
-            const uint8_t r = src[idx + 0];
-            const uint8_t g = src[idx + 1];
-            const uint8_t b = src[idx + 2];
-            const int gray = static_cast<int>(0.299f * r + 0.587f * g + 0.114f * b + 0.5f);
-            *dst++ = static_cast<uint8_t>(std::clamp(gray, 0, 255));
+    // Gray = (77 R + 150 G + 29 B + 128) >> 8: luma() of a source writes
+    // each row through the SIMD kernel selected for this CPU. Rows are
+    // independent, so bands of rows go to the shared worker pool.
+    const std::shared_ptr<WorkerPool> pool = sharedWorkerPool();
+    px::withPixelFormat(inputRgba.format, [&](auto format) {
+        px::evaluate(px::luma(px::pixels<decltype(format)::value>(inputRgba)), outBuffer,
+                     static_cast<size_t>(inputRgba.width), pool.get(), kMinGrayBandRows);
+    });
+
+    outBytesWritten = need;
+    return true;
+}
+
+bool convertYuv420ToRgba(const Yuv420View& input,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten) {
+    const int width = input.y.width;
+    const int height = input.y.height;
+    if (input.y.data == nullptr || input.u.data == nullptr || input.v.data == nullptr || width <= 0 || height <= 0) {
+        outBytesWritten = 0;
+        return false;
+    }
+
+    const size_t need = requiredGrayBytes(width, height) * 4;
+    if (outBuffer == nullptr || outBufferSize < need) {
+        outBytesWritten = need;
+        return false;
+    }
+
+    // Interleaved chroma (NV12/NV21) and strided luma are gathered into
+    // packed row scratch first (half-width for chroma), so one SIMD kernel
+    // serves every layout.
+    const YuvRowKernel toRgba = yuvRowKernel();
+    const int chromaWidth = (width + 1) / 2;
+    const std::shared_ptr<WorkerPool> pool = sharedWorkerPool();
+    const int chromaRows = (height + 1) / 2;
+    const int grain = std::max(kMinGrayBandRows / 2, chromaRows / (4 * pool->threadCount()));
+    // Ranges of chroma rows, so each covers whole pairs of luma rows.
+    const auto convertRows = [&](int c0, int c1) {
+        const int y0 = 2 * c0;
+        const int y1 = std::min(2 * c1, height);
+        FrameArena& arena = WorkerPool::threadScratch();
+        const FrameArena::Scope scope(arena);
+        uint8_t* yScratch = arena.allocate<uint8_t>(static_cast<size_t>(width) + 2 * static_cast<size_t>(chromaWidth));
+        uint8_t* uScratch = yScratch + width;
+        uint8_t* vScratch = uScratch + chromaWidth;
+        const uint8_t* uRow = nullptr;
+        const uint8_t* vRow = nullptr;
+        for (int y = y0; y < y1; ++y) {
+            if ((y & 1) == 0) {
+                uRow = planeRow(input.u, y / 2, chromaWidth, uScratch);
+                vRow = planeRow(input.v, y / 2, chromaWidth, vScratch);
+            }
+            toRgba(planeRow(input.y, y, width, yScratch), uRow, vRow,
+                   outBuffer + static_cast<size_t>(y) * static_cast<size_t>(width) * 4, width);
         }
-        srcRow += srcStride;
+    };
+    pool->parallelForRows(0, chromaRows, grain, std::cref(convertRows));
+
+    outBytesWritten = need;
+    return true;
+}
+
+bool processGaussianBlur(const PlaneView& gray,
+                         const BlurParams& blur,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten) {
+    GaussianKernel kernel;
+    if (gray.data == nullptr || gray.width <= 0 || gray.height <= 0 ||
+        !makeGaussianKernel(blur.kernelSize, blur.sigma, kernel)) {
+        outBytesWritten = 0;
+        return false;
+    }
+
+    const size_t need = requiredGrayBytes(gray.width, gray.height);
+    if (outBuffer == nullptr || outBufferSize < need) {
+        outBytesWritten = need;
+        return false;
+    }
+
+    // Each band streams its rows plus `radius` halo rows on either side
+    // through its own line buffer.
+    LumaPlaneSource source(gray);
+    const std::shared_ptr<WorkerPool> pool = sharedWorkerPool();
+    const int bands = std::max(1, std::min(pool->threadCount(), gray.height / kMinGrayBandRows));
+    pool->parallelFor(bands, [&](int b) {
+        const int y0 = static_cast<int>(static_cast<int64_t>(gray.height) * b / bands);
+        const int y1 = static_cast<int>(static_cast<int64_t>(gray.height) * (b + 1) / bands);
+        gaussianBlurRows(source, gray.width, gray.height, kernel, y0, y1, outBuffer, gray.width);
+    });
+
+    outBytesWritten = need;
+    return true;
+}
+
+bool processGradientEdges(const ImageView& inputRgba,
+                          double threshold,
+                          uint8_t* outBuffer,
+                          size_t outBufferSize,
+                          size_t& outBytesWritten,
+                          const BlurParams& blur,
+                          StageSchedule schedule) {
+    GaussianKernel kernel;
+    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || bytesPerPixel(inputRgba.format) == 0 ||
+        !makeGaussianKernel(blur.kernelSize, blur.sigma, kernel)) {
+        outBytesWritten = 0;
+        return false;
+    }
+
+    const size_t need = requiredGrayBytes(inputRgba.width, inputRgba.height);
+    if (outBuffer == nullptr || outBufferSize < need) {
+        outBytesWritten = need;
+        return false;
+    }
+
+    // Magnitudes are compared squared, like the Canny thresholds.
+    const double clamped = std::min(32767.0, threshold);
+    const int level = static_cast<int>(std::floor(clamped > 0 ? clamped * clamped : clamped));
+
+    // The graph for this thread, rebuilt only when the input format, size,
+    // blur or schedule changes; the threshold is updated in place.
+    struct GradientGraph {
+        StageGraph graph;
+        MagnitudeThresholdStage* threshold = nullptr;
+        PixelFormat format = PixelFormat::RGBA;
+        BlurParams blur;
+    };
+    thread_local GradientGraph cached;
+    const std::shared_ptr<WorkerPool> pool = sharedWorkerPool();
+    if (!cached.graph.isPlanned() || cached.format != inputRgba.format || cached.graph.width() != inputRgba.width ||
+        cached.graph.height() != inputRgba.height || cached.blur.kernelSize != blur.kernelSize ||
+        cached.blur.sigma != blur.sigma || cached.graph.schedule() != schedule) {
+        cached.graph = StageGraph();
+        cached.graph.setSchedule(schedule);
+        cached.graph.add<LumaStage>(inputRgba.format);
+        if (kernel.radius > 0) cached.graph.add<GaussianStage>(kernel);
+        cached.graph.add<SobelMagnitudeStage>(SobelMagnitude::L2Squared);
+        cached.threshold = &cached.graph.add<MagnitudeThresholdStage>(level);
+        cached.format = inputRgba.format;
+        cached.blur = blur;
+        cached.graph.plan(inputRgba.width, inputRgba.height, bytesPerPixel(inputRgba.format), pool.get());
+    }
+    cached.threshold->setThreshold(level);
+
+    const size_t srcStride = (inputRgba.stride > 0) ? static_cast<size_t>(inputRgba.stride)
+                                                    : static_cast<size_t>(inputRgba.width) * bytesPerPixel(inputRgba.format);
+    cached.graph.run(inputRgba.data, srcStride, outBuffer, static_cast<size_t>(inputRgba.width), pool.get());
+    outBytesWritten = need;
+    return true;
+}
+
+bool EdgePipeline::configure(const EdgePipelineConfig& config) {
+    configured_ = false;
+    chosen_ = EdgeThresholds();
+    GaussianKernel kernel;
+    if (config.maxWidth <= 0 || config.maxHeight <= 0 || !isValidScale(config.scale) ||
+        !makeGaussianKernel(config.blur.kernelSize, config.blur.sigma, kernel) ||
+        !fitsFormat(maskSide(config.maxWidth, config.scale), maskSide(config.maxHeight, config.scale), config.format)) {
+        return false;
     }
+    config_ = config;
+    kernel_ = kernel;
+
+    // Start from scratch so a smaller frame size also gives memory back.
+    workspace_.release();
+    sparse_ = SparseEdges();
+    reserveBuffers();
+    configured_ = true;
+    return true;
+}
+
+bool EdgePipeline::resize(int maxWidth, int maxHeight) {
+    EdgePipelineConfig config = config_;
+    config.maxWidth = maxWidth;
+    config.maxHeight = maxHeight;
+    return configure(config);
+}
+
+void EdgePipeline::setThresholds(const ThresholdParams& thresholds) {
+    const bool wasFixed = config_.thresholds.mode == ThresholdMode::Fixed;
+    config_.thresholds = thresholds;
+    if (configured_ && wasFixed && thresholds.mode != ThresholdMode::Fixed) reserveBuffers();
+}
+
+// Sizes every buffer for the configured maximum frame; buffers only grow.
+// The arena is sized by laying out one largest frame in it, in the order
+// detect() does, and rewinding.
+void EdgePipeline::reserveBuffers() {
+    const int w = scaledSize(config_.maxWidth, config_.scale.factor);
+    const int h = scaledSize(config_.maxHeight, config_.scale.factor);
+    const bool upsample = config_.scale.factor > 1 && config_.scale.upsampleMask;
+    // Reduced masks are detected packed and expanded afterwards.
+    const EdgeMaskFormat detectFormat = upsample ? EdgeMaskFormat::Packed : config_.format;
+    FrameArena& arena = workspace_.arena();
+    arena.reset();
+    if (upsample) {
+        arena.allocate<uint8_t>(packedMaskStride(w) * static_cast<size_t>(h));
+        arena.allocate<uint8_t>(packedMaskStride(config_.maxWidth));
+    }
+    const std::shared_ptr<WorkerPool> pool = config_.parallelBands ? sharedWorkerPool() : nullptr;
+    workspace_.reserve(w, h, kernel_, config_.thresholds, detectFormat, pool.get());
+    arena.reset();
+    if (config_.format == EdgeMaskFormat::Runs) sparse_.rowStart.reserve(static_cast<size_t>(config_.maxHeight) + 1);
+}
+
+size_t EdgePipeline::maxOutputBytes() const {
+    if (!configured_) return 0;
+    const int maskWidth = maskSide(config_.maxWidth, config_.scale);
+    const int maskHeight = maskSide(config_.maxHeight, config_.scale);
+    return isSparseFormat(config_.format) ? maxSparseEdgeBytes(maskWidth, maskHeight, config_.format)
+                                          : requiredEdgeMaskBytes(maskWidth, maskHeight, config_.format);
+}
+
+bool EdgePipeline::accepts(int width, int height) const {
+    return configured_ && width > 0 && height > 0 && width <= config_.maxWidth && height <= config_.maxHeight;
+}
 
+// Dense formats need the whole mask up front; reports the size on failure.
+static bool hasOutputRoom(int width, int height, const ScaleParams& scale, EdgeMaskFormat format,
+                          const uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten) {
+    if (isSparseFormat(format)) return true;
+    const size_t need = requiredEdgeMaskBytes(maskSide(width, scale), maskSide(height, scale), format);
+    if (outBuffer != nullptr && outBufferSize >= need) return true;
     outBytesWritten = need;
+    return false;
+}
+
+bool EdgePipeline::process(const ImageView& input, uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten) {
+    chosen_ = EdgeThresholds();
+    workspace_.arena().reset();
+    if (input.data == nullptr || bytesPerPixel(input.format) == 0 || !accepts(input.width, input.height)) {
+        outBytesWritten = 0;
+        return false;
+    }
+    if (!hasOutputRoom(input.width, input.height, config_.scale, config_.format, outBuffer, outBufferSize, outBytesWritten)) {
+        return false;
+    }
+
+#ifdef EDGEVIEWER_USE_OPENCV
+    if (config_.thresholds.mode == ThresholdMode::Fixed) {
+        chosen_.low = std::min(config_.thresholds.low, config_.thresholds.high);
+        chosen_.high = std::max(config_.thresholds.low, config_.thresholds.high);
+        // Gray conversion goes through the same fixed-point kernel as the CPU
+        // paths so both builds see identical luma.
+        const LumaRowKernel toGray = lumaRowKernel(input.format);
+        const int srcStride = (input.stride > 0) ? input.stride : input.width * bytesPerPixel(input.format);
+        cv::Mat gray(input.height, input.width, CV_8UC1);
+        for (int y = 0; y < input.height; ++y) {
+            toGray(input.data + static_cast<size_t>(y) * static_cast<size_t>(srcStride), gray.ptr<uint8_t>(y), input.width);
+        }
+        return detectOpenCv(gray, config_.blur, kernel_, chosen_.low, chosen_.high, config_.format, config_.scale,
+                            workspace_.arena(), sparse_, outBuffer, outBufferSize, outBytesWritten);
+    }
+#endif
+    InterleavedRgbSource source(input);
+    return detect(source, input.width, input.height, outBuffer, outBufferSize, outBytesWritten);
+}
+
+bool EdgePipeline::process(const PlaneView& luma, uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten) {
+    chosen_ = EdgeThresholds();
+    workspace_.arena().reset();
+    if (luma.data == nullptr || !accepts(luma.width, luma.height)) {
+        outBytesWritten = 0;
+        return false;
+    }
+    if (!hasOutputRoom(luma.width, luma.height, config_.scale, config_.format, outBuffer, outBufferSize, outBytesWritten)) {
+        return false;
+    }
+
+    LumaPlaneSource source(luma);
+#ifdef EDGEVIEWER_USE_OPENCV
+    if (config_.thresholds.mode == ThresholdMode::Fixed) {
+        chosen_.low = std::min(config_.thresholds.low, config_.thresholds.high);
+        chosen_.high = std::max(config_.thresholds.low, config_.thresholds.high);
+        // cv::Canny needs packed samples: wrap a packed plane in place, gather
+        // an interleaved one row by row.
+        cv::Mat gray;
+        if (luma.pixelStride <= 1) {
+            const size_t rowStride = (luma.rowStride > 0) ? static_cast<size_t>(luma.rowStride) : static_cast<size_t>(luma.width);
+            gray = cv::Mat(luma.height, luma.width, CV_8UC1, const_cast<uint8_t*>(luma.data), rowStride);
+        } else {
+            gray.create(luma.height, luma.width, CV_8UC1);
+            for (int y = 0; y < luma.height; ++y) {
+                source.row(y, gray.ptr<uint8_t>(y));
+            }
+        }
+        return detectOpenCv(gray, config_.blur, kernel_, chosen_.low, chosen_.high, config_.format, config_.scale,
+                            workspace_.arena(), sparse_, outBuffer, outBufferSize, outBytesWritten);
+    }
+#endif
+    return detect(source, luma.width, luma.height, outBuffer, outBufferSize, outBytesWritten);
+}
+
+// Native Canny (see canny.hpp) on `source`, at 1/scale.factor resolution when
+// configured. Gray conversion, downsampling, blur, gradient and suppression
+// stream through the workspace's line buffers; see cannyStream for the
+// frame-sized storage per format. OpenCV builds use it for the automatic
+// threshold modes, whose histograms cv::Canny cannot collect.
+bool EdgePipeline::detect(GrayRowSource& source,
+                          int width,
+                          int height,
+                          uint8_t* outBuffer,
+                          size_t outBufferSize,
+                          size_t& outBytesWritten) {
+    const ScaleParams& scale = config_.scale;
+    const EdgeMaskFormat format = config_.format;
+    AreaDownsampleSource downsampled(source, width, height, scale.factor);
+    GrayRowSource& input = (scale.factor > 1) ? static_cast<GrayRowSource&>(downsampled) : source;
+    const int w = scaledSize(width, scale.factor);
+    const int h = scaledSize(height, scale.factor);
+    const std::shared_ptr<WorkerPool> pool = config_.parallelBands ? sharedWorkerPool() : nullptr;
+
+    if (scale.factor > 1 && scale.upsampleMask) {
+        // The reduced mask is 1/factor^2 the size of a full packed one.
+        FrameArena& arena = workspace_.arena();
+        uint8_t* reduced = arena.allocate<uint8_t>(packedMaskStride(w) * static_cast<size_t>(h));
+        uint8_t* rowScratch = arena.allocate<uint8_t>(packedMaskStride(width));
+        cannyStream(input, w, h, kernel_, config_.thresholds, chosen_, reduced, static_cast<int>(packedMaskStride(w)),
+                    pool.get(), EdgeMaskFormat::Packed, &workspace_);
+        return storeUpsampled(reduced, width, height, scale.factor, format, rowScratch, sparse_, pool.get(),
+                              outBuffer, outBufferSize, outBytesWritten);
+    }
+    if (isSparseFormat(format)) {
+        cannyStreamSparse(input, w, h, kernel_, config_.thresholds, chosen_, format, sparse_, pool.get(), &workspace_);
+        return storeSparseEdges(sparse_, format, outBuffer, outBufferSize, outBytesWritten);
+    }
+    const int outStride = (format == EdgeMaskFormat::Packed) ? static_cast<int>(packedMaskStride(w)) : w;
+    cannyStream(input, w, h, kernel_, config_.thresholds, chosen_, outBuffer, outStride, pool.get(), format, &workspace_);
+
+    outBytesWritten = requiredEdgeMaskBytes(w, h, format);
     return true;
 }
 
+// The pipeline behind the free functions on this thread, configured for
+// this call: kept while the settings match and the frame fits, rebuilt
+// otherwise. Null for settings no pipeline accepts.
+static EdgePipeline* threadPipeline(int width,
+                                    int height,
+                                    const ThresholdParams& thresholds,
+                                    const BlurParams& blur,
+                                    EdgeMaskFormat format,
+                                    const ScaleParams& scale) {
+    thread_local EdgePipeline pipeline;
+    const EdgePipelineConfig& current = pipeline.config();
+    const bool sameSettings = pipeline.isConfigured() && current.format == format &&
+                              current.blur.kernelSize == blur.kernelSize && current.blur.sigma == blur.sigma &&
+                              current.scale.factor == scale.factor && current.scale.upsampleMask == scale.upsampleMask;
+    if (sameSettings && width <= current.maxWidth && height <= current.maxHeight) {
+        pipeline.setThresholds(thresholds);
+        return &pipeline;
+    }
+
+    // Same settings and a larger frame: grow, so alternating sizes settle.
+    EdgePipelineConfig config;
+    config.maxWidth = sameSettings ? std::max(width, current.maxWidth) : width;
+    config.maxHeight = sameSettings ? std::max(height, current.maxHeight) : height;
+    config.format = format;
+    config.thresholds = thresholds;
+    config.blur = blur;
+    config.scale = scale;
+    return pipeline.configure(config) ? &pipeline : nullptr;
+}
+
+bool processCannyEdges(const ImageView& inputRgba,
+                       const ThresholdParams& thresholds,
+                       EdgeThresholds& chosen,
+                       uint8_t* outBuffer,
+                       size_t outBufferSize,
+                       size_t& outBytesWritten,
+                       const BlurParams& blur,
+                       EdgeMaskFormat format,
+                       const ScaleParams& scale) {
+    chosen = EdgeThresholds();
+    EdgePipeline* pipeline = threadPipeline(inputRgba.width, inputRgba.height, thresholds, blur, format, scale);
+    if (pipeline == nullptr) {
+        outBytesWritten = 0;
+        return false;
+    }
+    const bool ok = pipeline->process(inputRgba, outBuffer, outBufferSize, outBytesWritten);
+    chosen = pipeline->lastThresholds();
+    return ok;
+}
+
 bool processCannyEdges(const ImageView& inputRgba,
                        double lowThreshold,
                        double highThreshold,
                        uint8_t* outBuffer,
                        size_t outBufferSize,
-                       size_t& outBytesWritten) {
-#ifdef EDGEVIEWER_USE_OPENCV
-    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || inputRgba.channels < 3) {
+                       size_t& outBytesWritten,
+                       const BlurParams& blur,
+                       EdgeMaskFormat format,
+                       const ScaleParams& scale) {
+    EdgeThresholds chosen;
+    return processCannyEdges(inputRgba, fixedThresholds(lowThreshold, highThreshold), chosen, outBuffer, outBufferSize,
+                             outBytesWritten, blur, format, scale);
+}
+
+bool processLumaEdges(const PlaneView& luma,
+                      const ThresholdParams& thresholds,
+                      EdgeThresholds& chosen,
+                      uint8_t* outBuffer,
+                      size_t outBufferSize,
+                      size_t& outBytesWritten,
+                      const BlurParams& blur,
+                      EdgeMaskFormat format,
+                      const ScaleParams& scale) {
+    chosen = EdgeThresholds();
+    EdgePipeline* pipeline = threadPipeline(luma.width, luma.height, thresholds, blur, format, scale);
+    if (pipeline == nullptr) {
         outBytesWritten = 0;
         return false;
     }
+    const bool ok = pipeline->process(luma, outBuffer, outBufferSize, outBytesWritten);
+    chosen = pipeline->lastThresholds();
+    return ok;
+}
 
-    const size_t need = requiredGrayBytes(inputRgba.width, inputRgba.height);
-    if (outBuffer == nullptr || outBufferSize < need) {
+bool processLumaEdges(const PlaneView& luma,
+                      double lowThreshold,
+                      double highThreshold,
+                      uint8_t* outBuffer,
+                      size_t outBufferSize,
+                      size_t& outBytesWritten,
+                      const BlurParams& blur,
+                      EdgeMaskFormat format,
+                      const ScaleParams& scale) {
+    EdgeThresholds chosen;
+    return processLumaEdges(luma, fixedThresholds(lowThreshold, highThreshold), chosen, outBuffer, outBufferSize,
+                            outBytesWritten, blur, format, scale);
+}
+
+static inline bool isInsideFrame(const RoiRect& roi, int width, int height) {
+    return roi.width > 0 && roi.height > 0 && roi.x >= 0 && roi.y >= 0 &&
+           roi.x <= width - roi.width && roi.y <= height - roi.height;
+}
+
+// `roi` grown by `halo` on every side, clamped to the frame.
+static RoiRect expandRoi(const RoiRect& roi, int halo, int width, int height) {
+    const int x0 = std::max(0, roi.x - halo);
+    const int y0 = std::max(0, roi.y - halo);
+    const int x1 = std::min(width, roi.x + roi.width + halo);
+    const int y1 = std::min(height, roi.y + roi.height + halo);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static ImageView cropImage(const ImageView& image, const RoiRect& area) {
+    const int stride = (image.stride > 0) ? image.stride : image.width * bytesPerPixel(image.format);
+    const uint8_t* origin = image.data + static_cast<size_t>(area.y) * static_cast<size_t>(stride) +
+                            static_cast<size_t>(area.x) * static_cast<size_t>(bytesPerPixel(image.format));
+    return {origin, area.width, area.height, stride, image.format};
+}
+
+static PlaneView cropPlane(const PlaneView& plane, const RoiRect& area) {
+    const int pixelStride = (plane.pixelStride > 0) ? plane.pixelStride : 1;
+    const int rowStride = (plane.rowStride > 0) ? plane.rowStride : plane.width * pixelStride;
+    const uint8_t* origin = plane.data + static_cast<size_t>(area.y) * static_cast<size_t>(rowStride) +
+                            static_cast<size_t>(area.x) * static_cast<size_t>(pixelStride);
+    return {origin, area.width, area.height, rowStride, pixelStride};
+}
+
+// Sets the edge pixels of packed row `src`, bits [srcX, srcX + count), in a
+// destination row starting at column dstX: bytes get 255, packed rows a bit.
+// Only set bits are visited (forEachSetBit).
+static void copyMaskBits(const uint8_t* src, int srcX, int count, EdgeMaskFormat format, uint8_t* dst, int dstX) {
+    forEachSetBit(src, srcX, srcX + count, [&](int x) {
+        const int ox = dstX + (x - srcX);
+        if (format == EdgeMaskFormat::Packed) {
+            dst[ox >> 3] = static_cast<uint8_t>(dst[ox >> 3] | (1u << (ox & 7)));
+        } else {
+            dst[ox] = 255;
+        }
+    });
+}
+
+// Shared body of the ROI entry points. `detect(area, packed, size)` runs
+// Canny on the frame region `area` into a packed mask of that size.
+template <typename Detect>
+static bool detectRois(int width,
+                       int height,
+                       const RoiRect* rois,
+                       size_t roiCount,
+                       RoiLayout layout,
+                       int halo,
+                       EdgeMaskFormat format,
+                       uint8_t* outBuffer,
+                       size_t outBufferSize,
+                       size_t& outBytesWritten,
+                       Detect detect) {
+    const bool sparse = isSparseFormat(format);
+    if (rois == nullptr || roiCount == 0 || (layout == RoiLayout::PerRoi && sparse) || !fitsFormat(width, height, format)) {
+        outBytesWritten = 0;
+        return false;
+    }
+    size_t need = 0;
+    for (size_t i = 0; i < roiCount; ++i) {
+        if (!isInsideFrame(rois[i], width, height)) {
+            outBytesWritten = 0;
+            return false;
+        }
+        if (layout == RoiLayout::PerRoi) need += requiredEdgeMaskBytes(rois[i].width, rois[i].height, format);
+    }
+    if (layout == RoiLayout::FullFrame) need = requiredEdgeMaskBytes(width, height, format);
+    if (!sparse && (outBuffer == nullptr || outBufferSize < need)) {
         outBytesWritten = need;
         return false;
     }
 
-    // Wrap input RGBA
-    const int type = (inputRgba.channels == 4) ? CV_8UC4 : CV_8UC3;
-    cv::Mat src(inputRgba.height, inputRgba.width, type, const_cast<uint8_t*>(inputRgba.data), inputRgba.stride);
-    cv::Mat gray, edges;
-    if (type == CV_8UC4) {
-        cv::cvtColor(src, gray, cv::COLOR_RGBA2GRAY);
-    } else {
-        cv::cvtColor(src, gray, cv::COLOR_RGB2GRAY);
+    // Sparse results are gathered in a packed frame map first, so
+    // overlapping ROIs merge and the lists come out in row-major order.
+    std::vector<uint8_t> frameMap;
+    uint8_t* frame = outBuffer;
+    const EdgeMaskFormat frameFormat = sparse ? EdgeMaskFormat::Packed : format;
+    if (layout == RoiLayout::FullFrame) {
+        if (sparse) {
+            frameMap.assign(requiredEdgeMaskBytes(width, height, EdgeMaskFormat::Packed), 0);
+            frame = frameMap.data();
+        } else {
+            std::memset(outBuffer, 0, need);
+        }
+    }
+
+    std::vector<uint8_t> packed;
+    size_t offset = 0;
+    for (size_t i = 0; i < roiCount; ++i) {
+        const RoiRect& roi = rois[i];
+        const RoiRect area = expandRoi(roi, halo, width, height);
+        const size_t areaStride = packedMaskStride(area.width);
+        packed.resize(areaStride * static_cast<size_t>(area.height));
+        if (!detect(area, packed.data(), packed.size())) {
+            outBytesWritten = 0;
+            return false;
+        }
+
+        uint8_t* dst = frame;
+        int dstWidth = width;
+        int dstX = roi.x;
+        int dstY = roi.y;
+        if (layout == RoiLayout::PerRoi) {
+            const size_t bytes = requiredEdgeMaskBytes(roi.width, roi.height, format);
+            dst = outBuffer + offset;
+            std::memset(dst, 0, bytes);
+            offset += bytes;
+            dstWidth = roi.width;
+            dstX = 0;
+            dstY = 0;
+        }
+        const size_t dstStride = (frameFormat == EdgeMaskFormat::Packed) ? packedMaskStride(dstWidth) : static_cast<size_t>(dstWidth);
+        for (int y = 0; y < roi.height; ++y) {
+            copyMaskBits(packed.data() + static_cast<size_t>(roi.y - area.y + y) * areaStride, roi.x - area.x, roi.width, frameFormat,
+                         dst + static_cast<size_t>(dstY + y) * dstStride, dstX);
+        }
+    }
+
+    if (sparse) {
+        SparseEdges edges;
+        edges.clear(format);
+        const size_t frameStride = packedMaskStride(width);
+        for (int y = 0; y < height; ++y) {
+            appendSparseRow(frame + static_cast<size_t>(y) * frameStride, width, y, format, edges);
+        }
+        return storeSparseEdges(edges, format, outBuffer, outBufferSize, outBytesWritten);
+    }
+    outBytesWritten = need;
+    return true;
+}
+
+bool processCannyEdgesRoi(const ImageView& inputRgba,
+                          const RoiRect* rois,
+                          size_t roiCount,
+                          RoiLayout layout,
+                          double lowThreshold,
+                          double highThreshold,
+                          uint8_t* outBuffer,
+                          size_t outBufferSize,
+                          size_t& outBytesWritten,
+                          const BlurParams& blur,
+                          EdgeMaskFormat format) {
+    GaussianKernel kernel;
+    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || bytesPerPixel(inputRgba.format) == 0 ||
+        !makeGaussianKernel(blur.kernelSize, blur.sigma, kernel)) {
+        outBytesWritten = 0;
+        return false;
     }
-    cv::Canny(gray, edges, lowThreshold, highThreshold, 3, true);
 
-    // Copy to output (single-channel)
-    if (static_cast<size_t>(edges.total()) != need) {
+    // Cropping is just an offset view, so only the grown ROIs are converted.
+    return detectRois(inputRgba.width, inputRgba.height, rois, roiCount, layout, kernel.radius + 2, format,
+                      outBuffer, outBufferSize, outBytesWritten,
+                      [&](const RoiRect& area, uint8_t* packed, size_t packedSize) {
+                          size_t written = 0;
+                          return processCannyEdges(cropImage(inputRgba, area), lowThreshold, highThreshold,
+                                                   packed, packedSize, written, blur, EdgeMaskFormat::Packed);
+                      });
+}
+
+bool processLumaEdgesRoi(const PlaneView& luma,
+                         const RoiRect* rois,
+                         size_t roiCount,
+                         RoiLayout layout,
+                         double lowThreshold,
+                         double highThreshold,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten,
+                         const BlurParams& blur,
+                         EdgeMaskFormat format) {
+    GaussianKernel kernel;
+    if (luma.data == nullptr || luma.width <= 0 || luma.height <= 0 ||
+        !makeGaussianKernel(blur.kernelSize, blur.sigma, kernel)) {
         outBytesWritten = 0;
         return false;
     }
-    std::memcpy(outBuffer, edges.data, need);
+
+    return detectRois(luma.width, luma.height, rois, roiCount, layout, kernel.radius + 2, format,
+                      outBuffer, outBufferSize, outBytesWritten,
+                      [&](const RoiRect& area, uint8_t* packed, size_t packedSize) {
+                          size_t written = 0;
+                          return processLumaEdges(cropPlane(luma, area), lowThreshold, highThreshold,
+                                                  packed, packedSize, written, blur, EdgeMaskFormat::Packed);
+                      });
+}
+
+bool packEdgeMask(const PlaneView& mask,
+                  uint8_t* outBuffer,
+                  size_t outBufferSize,
+                  size_t& outBytesWritten) {
+    if (mask.data == nullptr || mask.width <= 0 || mask.height <= 0) {
+        outBytesWritten = 0;
+        return false;
+    }
+
+    const size_t need = requiredEdgeMaskBytes(mask.width, mask.height, EdgeMaskFormat::Packed);
+    if (outBuffer == nullptr || outBufferSize < need) {
+        outBytesWritten = need;
+        return false;
+    }
+
+    const MaskPackRowKernel packRow = maskPackRowKernel();
+    const size_t stride = packedMaskStride(mask.width);
+    std::vector<uint8_t> scratch(mask.pixelStride > 1 ? static_cast<size_t>(mask.width) : 0);
+    for (int y = 0; y < mask.height; ++y) {
+        packRow(planeRow(mask, y, mask.width, scratch.data()), mask.width, 0, outBuffer + static_cast<size_t>(y) * stride);
+    }
+
     outBytesWritten = need;
     return true;
-#else
-    // Lightweight fallback: approximate edges via Sobel magnitude on a
-    // CPU grayscale conversion. No hysteresis; threshold uses highThreshold.
-    if (inputRgba.data == nullptr || inputRgba.width <= 0 || inputRgba.height <= 0 || inputRgba.channels < 3) {
+}
+
+bool unpackEdgeMask(const uint8_t* packed,
+                    int width,
+                    int height,
+                    uint8_t* outBuffer,
+                    size_t outBufferSize,
+                    size_t& outBytesWritten) {
+    if (packed == nullptr || width <= 0 || height <= 0) {
         outBytesWritten = 0;
         return false;
     }
 
-    const size_t need = requiredGrayBytes(inputRgba.width, inputRgba.height);
+    const size_t need = requiredGrayBytes(width, height);
     if (outBuffer == nullptr || outBufferSize < need) {
         outBytesWritten = need;
         return false;
     }
 
-    const int width = inputRgba.width;
-    const int height = inputRgba.height;
-    const int channels = inputRgba.channels;
-    const int srcStride = (inputRgba.stride > 0) ? inputRgba.stride : width * channels;
-
-    // 1) Convert to grayscale into a temporary buffer
-    std::vector<uint8_t> gray(need);
-    const uint8_t* srcRow = inputRgba.data;
+    const size_t stride = packedMaskStride(width);
     for (int y = 0; y < height; ++y) {
-        const uint8_t* src = srcRow;
-        uint8_t* dst = gray.data() + static_cast<size_t>(y) * static_cast<size_t>(width);
-        for (int x = 0; x < width; ++x) {
-            const int idx = x * channels;
-            const uint8_t r = src[idx + 0];
-            const uint8_t g = src[idx + 1];
-            const uint8_t b = src[idx + 2];
-            const int v = static_cast<int>(0.299f * r + 0.587f * g + 0.114f * b + 0.5f);
-            dst[x] = static_cast<uint8_t>(std::clamp(v, 0, 255));
-        }
-        srcRow += srcStride;
-    }
-
-    // 2) Simple Sobel filtering (3x3) to approximate edges
-    // Kernels:
-    // Gx = [[-1, 0, 1], [-2, 0, 2], [-1, 0, 1]]
-    // Gy = [[ 1, 2, 1], [ 0, 0, 0], [-1,-2,-1]]
-    // We'll use |Gx| + |Gy| as magnitude approximation
-    const int th = static_cast<int>(std::max(0.0, std::min(255.0, highThreshold))); // use highThreshold
-    auto idxAt = [width](int xx, int yy) -> size_t { return static_cast<size_t>(yy) * static_cast<size_t>(width) + static_cast<size_t>(xx); };
-
-    // Clear borders to 0
-    std::fill(outBuffer, outBuffer + need, 0);
-    for (int y = 1; y < height - 1; ++y) {
-        for (int x = 1; x < width - 1; ++x) {
-            const int g00 = gray[idxAt(x - 1, y - 1)];
-            const int g01 = gray[idxAt(x,     y - 1)];
-            const int g02 = gray[idxAt(x + 1, y - 1)];
-            const int g10 = gray[idxAt(x - 1, y    )];
-            const int g11 = gray[idxAt(x,     y    )];
-            const int g12 = gray[idxAt(x + 1, y    )];
-            const int g20 = gray[idxAt(x - 1, y + 1)];
-            const int g21 = gray[idxAt(x,     y + 1)];
-            const int g22 = gray[idxAt(x + 1, y + 1)];
-
-            // Sobel Gx, Gy
-            const int gx = (-g00 + g02) + (-2 * g10 + 2 * g12) + (-g20 + g22);
-            const int gy = ( g00 + 2 * g01 + g02) + (-g20 - 2 * g21 - g22);
-            const int mag = std::abs(gx) + std::abs(gy); // L1 magnitude
-            const int edge = (mag >> 3); // scale down to 0..~255 range
-            outBuffer[idxAt(x, y)] = static_cast<uint8_t>((edge >= th) ? 255 : 0);
-        }
+        unpackMaskRow(packed + static_cast<size_t>(y) * stride, width, 255, outBuffer + static_cast<size_t>(y) * static_cast<size_t>(width));
     }
 
     outBytesWritten = need;
     return true;
-#endif
+}
+
+void setWorkerThreadCount(int threads) {
+    setSharedWorkerThreads(threads);
+}
+
+int workerThreadCount() {
+    return sharedWorkerPool()->threadCount();
 }
 
 } // namespace edgeviewer
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "auto_threshold.hpp"
+#include "canny.hpp"
+#include "edge_mask.hpp"
+#include "luma_kernels.hpp"
+#include "stage_graph.hpp"
+
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 
 namespace edgeviewer {
 
@@ -9,8 +16,8 @@ struct ImageView {
     const uint8_t* data;
     int width;
     int height;
-    int stride; // bytes per row
-    int channels; // e.g. 4 for RGBA
+    int stride; // bytes per row (<= 0: width * bytesPerPixel(format))
+    PixelFormat format; // channel order, e.g. RGBA
 };
 
 struct MutableImageView {
@@ -21,6 +28,71 @@ struct MutableImageView {
     int channels;
 };
 
+// Single 8-bit plane, e.g. the Y plane of a YUV_420_888 camera image.
+struct PlaneView {
+    const uint8_t* data;
+    int width;
+    int height;
+    int rowStride;   // bytes per row (<= 0: width * pixelStride)
+    int pixelStride; // bytes between horizontally adjacent samples (<= 0: 1)
+};
+
+// A YUV_420_888 image as delivered by android.media.Image: full-resolution Y
+// and 2x2-subsampled U and V planes, each with its own row and pixel stride.
+// Covers planar I420/YV12 (pixelStride 1) and semi-planar NV12/NV21 (U and V
+// interleaved, pixelStride 2). Chroma planes hold (width+1)/2 x (height+1)/2
+// samples; their width/height fields are not consulted.
+struct Yuv420View {
+    PlaneView y;
+    PlaneView u;
+    PlaneView v;
+};
+
+// Gaussian smoothing applied ahead of the gradient in the edge paths, and by
+// processGaussianBlur. kernelSize is odd, 1..7 (1 disables smoothing); sigma
+// <= 0 derives it from the size like cv::getGaussianKernel. Borders follow
+// BORDER_REFLECT_101.
+struct BlurParams {
+    int kernelSize = 3;
+    double sigma = 0.0;
+};
+
+// Region of interest, in pixels of the frame it is applied to.
+struct RoiRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Where the ROI edge paths put their results.
+enum class RoiLayout {
+    FullFrame, // one frame-sized result; pixels outside every ROI are 0
+    PerRoi,    // each ROI's mask at its own size, back to back in list order
+};
+
+// Resolution the edge paths detect at. factor 2 or 4 area-averages the gray
+// image down by that much per side (rounding the size up) before the blur, so
+// detection costs about 1 / factor^2 of full resolution. With upsampleMask the
+// mask is returned at input size, each reduced edge pixel covering a
+// factor x factor block (edges come out factor pixels wide); otherwise it is
+// returned at the reduced size, scaledSize(width, factor) x
+// scaledSize(height, factor) (pyramid.hpp). Thresholds apply to the reduced
+// image's gradients: detail finer than ~2 * factor pixels is lost, and soft
+// edges, which get steeper per pixel, cross the thresholds sooner.
+struct ScaleParams {
+    int factor = 1; // 1, 2 or 4
+    bool upsampleMask = true;
+};
+
+// Convert YUV_420_888 to packed RGBA (width * 4 bytes per row, alpha = 255)
+// using the BT.601 fixed-point coefficients in yuv_convert.hpp. Same buffer
+// contract as processGrayscale.
+bool convertYuv420ToRgba(const Yuv420View& input,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten);
+
 // Convert input RGBA to grayscale output (1 channel, packed 8-bit)
 // If output buffer is null or too small, returns required size and false.
 // On success, writes into outBuffer and returns true.
@@ -29,14 +101,233 @@ bool processGrayscale(const ImageView& inputRgba,
                       size_t outBufferSize,
                       size_t& outBytesWritten);
 
+// Smooth an 8-bit plane with a separable integer Gaussian into a packed
+// width x height plane. Bit-identical to cv::GaussianBlur(..., BORDER_REFLECT_101)
+// on CV_8U. Same buffer contract as processGrayscale; an unsupported kernel
+// size returns false with outBytesWritten = 0.
+bool processGaussianBlur(const PlaneView& gray,
+                         const BlurParams& blur,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten);
+
+// Gradient-magnitude edges: 255 where the L2 Sobel magnitude of the gray
+// image, smoothed with `blur`, is above `threshold` (the units of the Canny
+// thresholds), 0 elsewhere; width * height bytes. Cheaper than Canny, with
+// thicker edges: no thinning and no hysteresis. Gray conversion, blur, Sobel
+// and the threshold run as one fused StageGraph pass (stage_graph.hpp), so
+// no intermediate frame is stored. `schedule` picks how the pass uses the
+// worker pool: bands of rows, or the stages side by side on their own
+// threads (same result). Same buffer contract as processGaussianBlur.
+bool processGradientEdges(const ImageView& inputRgba,
+                          double threshold,
+                          uint8_t* outBuffer,
+                          size_t outBufferSize,
+                          size_t& outBytesWritten,
+                          const BlurParams& blur = BlurParams(),
+                          StageSchedule schedule = StageSchedule::Bands);
+
 // Apply Canny edge detection on input RGBA and write a single-channel mask
-// into outBuffer.
+// into outBuffer. The gray image is smoothed with `blur` first; natively the
+// blur is fused into the row-streaming pass, so it costs no frame buffer.
+// `format` picks a 0/255 byte mask (width * height bytes), a 1-bit packed one
+// (packedMaskStride(width) * height bytes) or a sparse Points / Runs list
+// (see edge_mask.hpp). A sparse result's size is only known after detection:
+// a short buffer returns false with the size this frame needed, so callers
+// keep a buffer that grows to the largest size seen (maxSparseEdgeBytes is
+// the worst case). `scale` trades resolution for speed, see ScaleParams.
 bool processCannyEdges(const ImageView& inputRgba,
                        double lowThreshold,
                        double highThreshold,
                        uint8_t* outBuffer,
                        size_t outBufferSize,
-                       size_t& outBytesWritten);
+                       size_t& outBytesWritten,
+                       const BlurParams& blur = BlurParams(),
+                       EdgeMaskFormat format = EdgeMaskFormat::Bytes,
+                       const ScaleParams& scale = ScaleParams());
+
+// processCannyEdges with the thresholds fixed or picked per frame (see
+// ThresholdMode); `chosen` receives the pair used. A failed size query for a
+// dense format leaves it 0/0.
+bool processCannyEdges(const ImageView& inputRgba,
+                       const ThresholdParams& thresholds,
+                       EdgeThresholds& chosen,
+                       uint8_t* outBuffer,
+                       size_t outBufferSize,
+                       size_t& outBytesWritten,
+                       const BlurParams& blur = BlurParams(),
+                       EdgeMaskFormat format = EdgeMaskFormat::Bytes,
+                       const ScaleParams& scale = ScaleParams());
+
+// Canny edge detection directly on a luma plane, skipping RGBA entirely.
+// Same thresholds, blur, scale, output formats and buffer contract as
+// processCannyEdges.
+bool processLumaEdges(const PlaneView& luma,
+                      double lowThreshold,
+                      double highThreshold,
+                      uint8_t* outBuffer,
+                      size_t outBufferSize,
+                      size_t& outBytesWritten,
+                      const BlurParams& blur = BlurParams(),
+                      EdgeMaskFormat format = EdgeMaskFormat::Bytes,
+                      const ScaleParams& scale = ScaleParams());
+
+// processLumaEdges with fixed or per-frame thresholds, as for
+// processCannyEdges.
+bool processLumaEdges(const PlaneView& luma,
+                      const ThresholdParams& thresholds,
+                      EdgeThresholds& chosen,
+                      uint8_t* outBuffer,
+                      size_t outBufferSize,
+                      size_t& outBytesWritten,
+                      const BlurParams& blur = BlurParams(),
+                      EdgeMaskFormat format = EdgeMaskFormat::Bytes,
+                      const ScaleParams& scale = ScaleParams());
+
+// What an EdgePipeline is built for: the largest frame it accepts and the
+// settings every frame runs with.
+struct EdgePipelineConfig {
+    int maxWidth = 0;
+    int maxHeight = 0;
+    EdgeMaskFormat format = EdgeMaskFormat::Bytes;
+    ThresholdParams thresholds;
+    BlurParams blur;
+    ScaleParams scale;
+    // Split each frame into bands on the shared worker pool. Off, a frame
+    // runs start to finish on the calling thread, for callers that run
+    // whole frames in parallel instead.
+    bool parallelBands = true;
+};
+
+// processCannyEdges / processLumaEdges as a long-lived object for a stream
+// of frames. configure() validates the settings and allocates every
+// intermediate for frames up to maxWidth x maxHeight (line buffers, state
+// map, reduced mask, candidate lists), so frames after that allocate nothing
+// on the heap. The fixed-size ones share one cache-line aligned FrameArena
+// that each frame takes uninitialized and resets on entry; only lists that
+// follow the frame content (hysteresis seeds, sparse results) may still
+// grow, until they have seen the busiest frame. maxOutputBytes() sizes the
+// output buffer once, so there is no size query per frame. A frame larger
+// than the configured size is rejected; the caller changes resolution
+// explicitly with resize(). OpenCV builds hand Fixed thresholds to
+// cv::Canny, which allocates internally.
+//
+// Not thread-safe: one pipeline per stream of frames. The free functions
+// above run on a per-thread pipeline that is reconfigured whenever their
+// arguments outgrow it.
+class EdgePipeline {
+public:
+    EdgePipeline() = default;
+    explicit EdgePipeline(const EdgePipelineConfig& config) { configure(config); }
+
+    // Returns false, leaving the pipeline unconfigured, for a non-positive
+    // size, an unsupported blur or scale, or a sparse format on a frame over
+    // kMaxSparseEdgeSide.
+    bool configure(const EdgePipelineConfig& config);
+
+    // configure() with a new maximum size and the current settings.
+    bool resize(int maxWidth, int maxHeight);
+
+    // Thresholds for the following frames; no reallocation beyond reserving
+    // the candidate lists when switching to an automatic mode.
+    void setThresholds(const ThresholdParams& thresholds);
+
+    bool isConfigured() const { return configured_; }
+    const EdgePipelineConfig& config() const { return config_; }
+
+    // Output buffer that fits every accepted frame: requiredEdgeMaskBytes of
+    // the largest mask, or maxSparseEdgeBytes for Points / Runs.
+    size_t maxOutputBytes() const;
+
+    // Same buffer contract as processCannyEdges / processLumaEdges. A frame
+    // over the configured size, or an unconfigured pipeline, returns false
+    // with outBytesWritten = 0.
+    bool process(const ImageView& input, uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten);
+    bool process(const PlaneView& luma, uint8_t* outBuffer, size_t outBufferSize, size_t& outBytesWritten);
+
+    // Thresholds the last processed frame ran with.
+    const EdgeThresholds& lastThresholds() const { return chosen_; }
+
+    // Most bytes of per-frame intermediates any frame has needed so far, and
+    // the arena block holding them.
+    size_t scratchHighWater() const { return workspace_.arena().highWater(); }
+    size_t scratchCapacity() const { return workspace_.arena().capacity(); }
+
+private:
+    void reserveBuffers();
+    bool accepts(int width, int height) const;
+    bool detect(GrayRowSource& source, int width, int height, uint8_t* outBuffer, size_t outBufferSize,
+                size_t& outBytesWritten);
+
+    EdgePipelineConfig config_;
+    GaussianKernel kernel_;
+    bool configured_ = false;
+    EdgeThresholds chosen_;
+
+    // Its arena also holds the reduced mask and upsampled row of a scaled run.
+    CannyWorkspace workspace_;
+    SparseEdges sparse_;
+};
+
+// Canny edges inside `rois` only. Each ROI is converted and processed with a
+// halo of blur radius + 2 pixels (clamped to the frame), so gradients and
+// non-maximum suppression inside it match the whole-frame result; hysteresis
+// only follows edges within the ROI and its halo. Cost scales with ROI area,
+// apart from clearing a FullFrame output.
+// FullFrame takes every format (overlapping ROIs are merged). PerRoi takes
+// Bytes or Packed: ROI i's mask is requiredEdgeMaskBytes(roi width, height,
+// format) bytes, following those of ROIs 0..i-1. ROIs must lie inside the
+// frame. Same buffer contract as processCannyEdges.
+bool processCannyEdgesRoi(const ImageView& inputRgba,
+                          const RoiRect* rois,
+                          size_t roiCount,
+                          RoiLayout layout,
+                          double lowThreshold,
+                          double highThreshold,
+                          uint8_t* outBuffer,
+                          size_t outBufferSize,
+                          size_t& outBytesWritten,
+                          const BlurParams& blur = BlurParams(),
+                          EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+// processCannyEdgesRoi on a luma plane.
+bool processLumaEdgesRoi(const PlaneView& luma,
+                         const RoiRect* rois,
+                         size_t roiCount,
+                         RoiLayout layout,
+                         double lowThreshold,
+                         double highThreshold,
+                         uint8_t* outBuffer,
+                         size_t outBufferSize,
+                         size_t& outBytesWritten,
+                         const BlurParams& blur = BlurParams(),
+                         EdgeMaskFormat format = EdgeMaskFormat::Bytes);
+
+// Size of a dense (Bytes or Packed) width x height edge mask.
+size_t requiredEdgeMaskBytes(int width, int height, EdgeMaskFormat format);
+
+// Pack a byte mask (any nonzero sample counts as an edge) into the 1-bit
+// layout, packedMaskStride(width) * height bytes.
+bool packEdgeMask(const PlaneView& mask,
+                  uint8_t* outBuffer,
+                  size_t outBufferSize,
+                  size_t& outBytesWritten);
+
+// Expand a packed mask back into width * height bytes of 0/255. Padding bits
+// past `width` in each row are ignored.
+bool unpackEdgeMask(const uint8_t* packed,
+                    int width,
+                    int height,
+                    uint8_t* outBuffer,
+                    size_t outBufferSize,
+                    size_t& outBytesWritten);
+
+// Threads used by the conversion, blur and edge entry points. Frames are split
+// into horizontal bands (with stencil halo rows where needed) and the output
+// is identical for every thread count. 0 = one per hardware thread (default),
+// 1 = run on the calling thread only.
+void setWorkerThreadCount(int threads);
+int workerThreadCount();
 
 } // namespace edgeviewer
 
@@ -0,0 +1,479 @@
+#pragma once
+
+#include "luma_kernels.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// Lets the compiler vectorize a loop whose stores may only alias its loads
+// at the same index (in-place evaluation), without a runtime overlap check.
+#if defined(__clang__)
+#define EDGEVIEWER_VECTORIZE _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define EDGEVIEWER_VECTORIZE _Pragma("GCC ivdep")
+#else
+#define EDGEVIEWER_VECTORIZE
+#endif
+
+namespace edgeviewer {
+
+// Header-only image expressions: point-wise operators plus 3x3 stencils.
+// A chain such as
+//
+//     px::evaluate(px::threshold(px::luma(px::pixels<PixelFormat::RGBA>(view)), 100), out, width);
+//
+// is a nest of small value types; evaluate() walks the image once and every
+// operator inlines into a single loop, so no intermediate image (or row)
+// exists. Rows are processed in chunks of kChunk pixels with a constant trip
+// count the compiler vectorizes at -O2.
+//
+// A source of interleaved pixels does not vectorize well element by element
+// (the channels have to be deinterleaved), so luma() of a source fills each
+// chunk with the SIMD row kernel from luma_kernels.hpp, and the operators on
+// top of it run fused over that L1-resident chunk. Evaluated on its own, it
+// writes the destination row directly, exactly like processGrayscale.
+//
+// Expressions own no memory; sources point at the caller's pixels, which
+// must outlive evaluate(). Every node has
+//   value_type, width(), height() and cursor(),
+// and its Cursor (per-thread state) has
+//   Chunk seek(int y, int x0, int count) -- pixels [x0, x0 + count) of row y
+// where Chunk::operator[](i) is pixel x0 + i. A cursor that can write whole
+// rows faster by itself sets kFillsRow and provides fillRow(y, out).
+//
+// stencil3x3() is the one neighbourhood node: it pulls three rows of its
+// input per chunk into small buffers (replicated borders), so each input
+// value is computed three times. Put it over a Plane or a cheap chain.
+namespace px {
+
+// Pixels per chunk: a multiple of every vector width, small enough that a
+// chunk of int32 stays in L1.
+constexpr int kChunk = 256;
+constexpr int kTailStep = 32;
+
+struct Rgb8 {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+enum class Channel { R, G, B };
+
+// ---------------------------------------------------------------------------
+// Sources
+
+// An 8-bit (or any T) plane with packed samples; stride in elements.
+template <typename T>
+class Plane {
+public:
+    using value_type = T;
+
+    Plane(const T* data, int width, int height, size_t stride)
+        : data_(data), width_(width), height_(height), stride_(stride) {}
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    struct Chunk {
+        const T* p;
+        T operator[](int i) const { return p[i]; }
+    };
+
+    class Cursor {
+    public:
+        static constexpr bool kFillsRow = false;
+        explicit Cursor(const Plane& plane) : plane_(plane) {}
+        Chunk seek(int y, int x0, int /*count*/) const {
+            return Chunk{plane_.data_ + static_cast<size_t>(y) * plane_.stride_ + static_cast<size_t>(x0)};
+        }
+
+    private:
+        const Plane& plane_;
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+private:
+    const T* data_;
+    int width_;
+    int height_;
+    size_t stride_;
+};
+
+template <typename T>
+Plane<T> plane(const T* data, int width, int height, size_t stride) {
+    return Plane<T>(data, width, height, stride);
+}
+
+// Interleaved color pixels in layout F; yields Rgb8. stride in bytes.
+template <PixelFormat F>
+class Pixels {
+public:
+    using value_type = Rgb8;
+    using Layout = PixelLayout<F>;
+
+    Pixels(const uint8_t* data, int width, int height, size_t stride)
+        : data_(data), width_(width), height_(height), stride_(stride) {}
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const uint8_t* row(int y) const { return data_ + static_cast<size_t>(y) * stride_; }
+
+    struct Chunk {
+        const uint8_t* p;
+        Rgb8 operator[](int i) const {
+            const uint8_t* px = p + static_cast<size_t>(i) * Layout::kBytes;
+            return Rgb8{px[Layout::kR], px[Layout::kG], px[Layout::kB]};
+        }
+    };
+
+    class Cursor {
+    public:
+        static constexpr bool kFillsRow = false;
+        explicit Cursor(const Pixels& pixels) : pixels_(pixels) {}
+        Chunk seek(int y, int x0, int /*count*/) const {
+            return Chunk{pixels_.row(y) + static_cast<size_t>(x0) * Layout::kBytes};
+        }
+
+    private:
+        const Pixels& pixels_;
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+private:
+    const uint8_t* data_;
+    int width_;
+    int height_;
+    size_t stride_;
+};
+
+// Pixels of an ImageView (or anything with its data / width / height /
+// stride fields) whose format is F.
+template <PixelFormat F, typename View>
+Pixels<F> pixels(const View& view) {
+    const size_t stride = (view.stride > 0) ? static_cast<size_t>(view.stride)
+                                            : static_cast<size_t>(view.width) * PixelLayout<F>::kBytes;
+    return Pixels<F>(view.data, view.width, view.height, stride);
+}
+
+// Calls f(std::integral_constant<PixelFormat, F>()) for the runtime `format`,
+// so an expression over pixels<F> is compiled once per layout. `format` must
+// be valid.
+template <typename Fn>
+void withPixelFormat(PixelFormat format, Fn&& f) {
+    switch (format) {
+    case PixelFormat::RGBA: f(std::integral_constant<PixelFormat, PixelFormat::RGBA>()); break;
+    case PixelFormat::BGRA: f(std::integral_constant<PixelFormat, PixelFormat::BGRA>()); break;
+    case PixelFormat::ARGB: f(std::integral_constant<PixelFormat, PixelFormat::ARGB>()); break;
+    case PixelFormat::RGB: f(std::integral_constant<PixelFormat, PixelFormat::RGB>()); break;
+    case PixelFormat::BGR: f(std::integral_constant<PixelFormat, PixelFormat::BGR>()); break;
+    case PixelFormat::RGBX: f(std::integral_constant<PixelFormat, PixelFormat::RGBX>()); break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Point-wise operators
+
+// Applies `op` to every value of `inner`.
+template <typename E, typename Op>
+class Map {
+public:
+    using value_type = decltype(std::declval<const Op&>()(std::declval<typename E::value_type>()));
+
+    Map(const E& inner, const Op& op) : inner_(inner), op_(op) {}
+
+    int width() const { return inner_.width(); }
+    int height() const { return inner_.height(); }
+
+    template <typename InnerChunk>
+    struct Chunk {
+        InnerChunk inner;
+        Op op;
+        value_type operator[](int i) const { return op(inner[i]); }
+    };
+
+    class Cursor {
+    public:
+        static constexpr bool kFillsRow = false;
+        explicit Cursor(const Map& map) : inner_(map.inner_.cursor()), op_(map.op_) {}
+        auto seek(int y, int x0, int count) {
+            using InnerChunk = decltype(inner_.seek(y, x0, count));
+            return Chunk<InnerChunk>{inner_.seek(y, x0, count), op_};
+        }
+
+    private:
+        typename E::Cursor inner_;
+        Op op_;
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+private:
+    E inner_;
+    Op op_;
+};
+
+struct LumaOp {
+    uint8_t operator()(Rgb8 c) const { return lumaPixel(c.r, c.g, c.b); }
+};
+
+template <Channel R, Channel G, Channel B>
+struct SwizzleOp {
+    static uint8_t pick(Rgb8 c, Channel channel) {
+        return channel == Channel::R ? c.r : (channel == Channel::G ? c.g : c.b);
+    }
+    Rgb8 operator()(Rgb8 c) const { return Rgb8{pick(c, R), pick(c, G), pick(c, B)}; }
+};
+
+struct LutOp {
+    const uint8_t* table; // 256 entries
+    uint8_t operator()(uint8_t v) const { return table[v]; }
+};
+
+template <typename T>
+struct ClampOp {
+    T lo;
+    T hi;
+    T operator()(T v) const { return std::min(std::max(v, lo), hi); }
+};
+
+template <typename T>
+struct ThresholdOp {
+    T threshold;
+    uint8_t operator()(T v) const { return (v > threshold) ? 255 : 0; }
+};
+
+struct InvertOp {
+    uint8_t operator()(uint8_t v) const { return static_cast<uint8_t>(255 - v); }
+};
+
+// Luma of any Rgb8 expression, pixel by pixel.
+template <typename E>
+class Luma : public Map<E, LumaOp> {
+public:
+    explicit Luma(const E& inner) : Map<E, LumaOp>(inner, LumaOp()) {}
+};
+
+// Luma straight from a source: the SIMD row kernel fills an aligned chunk,
+// or the destination row itself when nothing else is applied.
+template <PixelFormat F>
+class Luma<Pixels<F>> {
+public:
+    using value_type = uint8_t;
+
+    explicit Luma(const Pixels<F>& inner) : inner_(inner) {}
+
+    int width() const { return inner_.width(); }
+    int height() const { return inner_.height(); }
+
+    class Cursor {
+    public:
+        static constexpr bool kFillsRow = true;
+        explicit Cursor(const Luma& luma) : inner_(luma.inner_), toGray_(lumaRowKernel(F)) {}
+
+        typename Plane<uint8_t>::Chunk seek(int y, int x0, int count) {
+            toGray_(inner_.row(y) + static_cast<size_t>(x0) * PixelLayout<F>::kBytes, chunk_, count);
+            return typename Plane<uint8_t>::Chunk{chunk_};
+        }
+        void fillRow(int y, uint8_t* out) { toGray_(inner_.row(y), out, inner_.width()); }
+
+    private:
+        const Pixels<F>& inner_;
+        LumaRowKernel toGray_;
+        alignas(64) uint8_t chunk_[kChunk];
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+private:
+    Pixels<F> inner_;
+};
+
+template <typename E>
+Luma<E> luma(const E& e) {
+    static_assert(std::is_same<typename E::value_type, Rgb8>::value, "luma() takes color pixels");
+    return Luma<E>(e);
+}
+
+// swizzle<Channel::B, Channel::G, Channel::R>(e) swaps red and blue.
+template <Channel R, Channel G, Channel B, typename E>
+Map<E, SwizzleOp<R, G, B>> swizzle(const E& e) {
+    static_assert(std::is_same<typename E::value_type, Rgb8>::value, "swizzle() takes color pixels");
+    return Map<E, SwizzleOp<R, G, B>>(e, SwizzleOp<R, G, B>());
+}
+
+// table[v] for 8-bit values; `table` has 256 entries and outlives evaluate().
+template <typename E>
+Map<E, LutOp> lut(const E& e, const uint8_t* table) {
+    static_assert(std::is_same<typename E::value_type, uint8_t>::value, "lut() takes 8-bit values");
+    return Map<E, LutOp>(e, LutOp{table});
+}
+
+template <typename E, typename T = typename E::value_type>
+Map<E, ClampOp<T>> clamp(const E& e, T lo, T hi) {
+    return Map<E, ClampOp<T>>(e, ClampOp<T>{lo, hi});
+}
+
+// 255 where the value is above `threshold`, else 0.
+template <typename E, typename T = typename E::value_type>
+Map<E, ThresholdOp<T>> threshold(const E& e, T threshold) {
+    return Map<E, ThresholdOp<T>>(e, ThresholdOp<T>{threshold});
+}
+
+template <typename E>
+Map<E, InvertOp> invert(const E& e) {
+    static_assert(std::is_same<typename E::value_type, uint8_t>::value, "invert() takes 8-bit values");
+    return Map<E, InvertOp>(e, InvertOp());
+}
+
+// ---------------------------------------------------------------------------
+// 3x3 stencils
+
+// The neighbourhood of one pixel: w(dx, dy) for dx, dy in [-1, 1]. Rows and
+// columns past the image border repeat the edge (BORDER_REPLICATE).
+template <typename T>
+struct Window3x3 {
+    const T* above;
+    const T* centre;
+    const T* below;
+    T operator()(int dx, int dy) const { return (dy < 0 ? above : (dy > 0 ? below : centre))[dx]; }
+};
+
+// Applies `op` to the 3x3 window around every value of `inner`.
+template <typename E, typename Op>
+class Stencil3x3 {
+public:
+    using input_type = typename E::value_type;
+    using value_type = decltype(std::declval<const Op&>()(std::declval<Window3x3<input_type>>()));
+
+    Stencil3x3(const E& inner, const Op& op) : inner_(inner), op_(op) {}
+
+    int width() const { return inner_.width(); }
+    int height() const { return inner_.height(); }
+
+    struct Chunk {
+        const input_type* rows[3]; // value x0 of rows y - 1, y, y + 1
+        Op op;
+        value_type operator[](int i) const { return op(Window3x3<input_type>{rows[0] + i, rows[1] + i, rows[2] + i}); }
+    };
+
+    class Cursor {
+    public:
+        static constexpr bool kFillsRow = false;
+        explicit Cursor(const Stencil3x3& stencil)
+            : inner_(stencil.inner_.cursor()), op_(stencil.op_), width_(stencil.width()), height_(stencil.height()) {}
+
+        Chunk seek(int y, int x0, int count) {
+            for (int r = 0; r < 3; ++r) load(std::min(std::max(y + r - 1, 0), height_ - 1), x0, count, rows_[r]);
+            return Chunk{{rows_[0] + 1, rows_[1] + 1, rows_[2] + 1}, op_};
+        }
+
+    private:
+        // Values [x0 - 1, x0 + count] of row y into buf. The inner chunk may
+        // live in the inner cursor, so it is copied before the next seek.
+        void load(int y, int x0, int count, input_type* buf) {
+            const auto chunk = inner_.seek(y, x0, count);
+            for (int i = 0; i < count; ++i) buf[i + 1] = chunk[i];
+            buf[0] = (x0 > 0) ? static_cast<input_type>(inner_.seek(y, x0 - 1, 1)[0]) : buf[1];
+            buf[count + 1] = (x0 + count < width_) ? static_cast<input_type>(inner_.seek(y, x0 + count, 1)[0]) : buf[count];
+        }
+
+        typename E::Cursor inner_;
+        Op op_;
+        int width_;
+        int height_;
+        input_type rows_[3][kChunk + 2];
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
+private:
+    E inner_;
+    Op op_;
+};
+
+struct Max3x3Op {
+    template <typename T>
+    T operator()(const Window3x3<T>& w) const {
+        T m = w(-1, -1);
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) m = std::max(m, w(dx, dy));
+        }
+        return m;
+    }
+};
+
+// op(Window3x3<value_type>) for every pixel of `e`.
+template <typename E, typename Op>
+Stencil3x3<E, Op> stencil3x3(const E& e, const Op& op) {
+    return Stencil3x3<E, Op>(e, op);
+}
+
+// 3x3 maximum, as DilateStage computes it.
+template <typename E>
+Stencil3x3<E, Max3x3Op> dilate3x3(const E& e) {
+    return Stencil3x3<E, Max3x3Op>(e, Max3x3Op());
+}
+
+// ---------------------------------------------------------------------------
+// Evaluation
+
+// Writes rows [y0, y1) of `e` to dst + y * dstStride (stride in elements of
+// T). dst may be the memory a Plane source reads, as long as each pixel is
+// read and written at the same position.
+template <typename E, typename T>
+void evaluateRows(const E& e, int y0, int y1, T* dst, size_t dstStride) {
+    typename E::Cursor cursor = e.cursor();
+    const int width = e.width();
+    for (int y = y0; y < y1; ++y) {
+        T* out = dst + static_cast<size_t>(y) * dstStride;
+        if constexpr (E::Cursor::kFillsRow && std::is_same<T, typename E::value_type>::value) {
+            cursor.fillRow(y, out);
+            continue;
+        }
+        int x = 0;
+        for (; x + kChunk <= width; x += kChunk) {
+            const auto chunk = cursor.seek(y, x, kChunk);
+            T* o = out + x;
+            EDGEVIEWER_VECTORIZE
+            for (int i = 0; i < kChunk; ++i) o[i] = static_cast<T>(chunk[i]);
+        }
+        if (x < width) {
+            // The rest of the row in steps of kTailStep, again with a
+            // constant trip count, and then pixel by pixel.
+            const int count = width - x;
+            const auto chunk = cursor.seek(y, x, count);
+            T* o = out + x;
+            int i = 0;
+            for (; i + kTailStep <= count; i += kTailStep) {
+                EDGEVIEWER_VECTORIZE
+                for (int j = i; j < i + kTailStep; ++j) o[j] = static_cast<T>(chunk[j]);
+            }
+            for (; i < count; ++i) o[i] = static_cast<T>(chunk[i]);
+        }
+    }
+}
+
+// evaluateRows over the whole image, in ranges of rows on `pool` (or on the
+// calling thread when it is null). About four ranges per thread, so cores
+// that finish early steal from the ones that do not.
+template <typename E, typename T>
+void evaluate(const E& e, T* dst, size_t dstStride, WorkerPool* pool = nullptr, int minBandRows = 16) {
+    const int height = e.height();
+    if (pool == nullptr || pool->threadCount() == 1 || height < 2 * minBandRows) {
+        evaluateRows(e, 0, height, dst, dstStride);
+        return;
+    }
+    const auto body = [&](int y0, int y1) { evaluateRows(e, y0, y1, dst, dstStride); };
+    // By reference: std::function never allocates for a reference_wrapper.
+    pool->parallelForRows(0, height, std::max(minBandRows, height / (4 * pool->threadCount())), std::cref(body));
+}
+
+} // namespace px
+} // namespace edgeviewer
@@ -0,0 +1,197 @@
+#include "pyramid.hpp"
+
+#include "cpu_features.hpp"
+#include "edge_mask.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+namespace edgeviewer {
+
+// Rounded mean of a block: factor^2 is 4 or 16, so the division is a shift.
+static inline uint8_t blockMean(int sum, int factor) {
+    return static_cast<uint8_t>((factor == 2) ? (sum + 2) >> 2 : (sum + 8) >> 4);
+}
+
+// Averages blocks [x0, count); the SIMD kernels finish their rows with it.
+static void areaTail(const uint8_t* const* rows, int factor, int x0, int count, uint8_t* out) {
+    for (int x = x0; x < count; ++x) {
+        int sum = 0;
+        for (int r = 0; r < factor; ++r) {
+            for (int k = 0; k < factor; ++k) sum += rows[r][x * factor + k];
+        }
+        out[x] = blockMean(sum, factor);
+    }
+}
+
+void areaRowScalar(const uint8_t* const* rows, int factor, int count, uint8_t* out) {
+    areaTail(rows, factor, 0, count, out);
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static void areaRowNeon(const uint8_t* const* rows, int factor, int count, uint8_t* out) {
+    // Pairwise widening adds (vpaddl/vpadal) sum horizontal pairs of every
+    // row into 16 bits; vrshrn applies the rounding shift while narrowing.
+    int x = 0;
+    if (factor == 2) {
+        for (; x + 16 <= count; x += 16) {
+            const uint8_t* a = rows[0] + 2 * x;
+            const uint8_t* b = rows[1] + 2 * x;
+            uint16x8_t lo = vpaddlq_u8(vld1q_u8(a));
+            uint16x8_t hi = vpaddlq_u8(vld1q_u8(a + 16));
+            lo = vpadalq_u8(lo, vld1q_u8(b));
+            hi = vpadalq_u8(hi, vld1q_u8(b + 16));
+            vst1q_u8(out + x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+        }
+    } else {
+        for (; x + 8 <= count; x += 8) {
+            uint16x8_t lo = vdupq_n_u16(0);
+            uint16x8_t hi = vdupq_n_u16(0);
+            for (int r = 0; r < 4; ++r) {
+                lo = vpadalq_u8(lo, vld1q_u8(rows[r] + 4 * x));
+                hi = vpadalq_u8(hi, vld1q_u8(rows[r] + 4 * x + 16));
+            }
+            const uint16x8_t quads = vcombine_u16(vpadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+                                                  vpadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+            vst1_u8(out + x, vrshrn_n_u16(quads, 4));
+        }
+    }
+    areaTail(rows, factor, x, count, out);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// pmaddubsw against all-ones bytes sums horizontal pixel pairs into 16 bits;
+// phaddw then joins pairs into the 4-wide sums. No AVX2 variant: the pass
+// reads factor^2 bytes per output and is bound by loads, not arithmetic.
+__attribute__((target("sse4.1")))
+static void areaRowSse41(const uint8_t* const* rows, int factor, int count, uint8_t* out) {
+    const __m128i ones = _mm_set1_epi8(1);
+    int x = 0;
+    if (factor == 2) {
+        const __m128i round = _mm_set1_epi16(2);
+        for (; x + 16 <= count; x += 16) {
+            __m128i lo = round;
+            __m128i hi = round;
+            for (int r = 0; r < 2; ++r) {
+                const uint8_t* src = rows[r] + 2 * x;
+                lo = _mm_add_epi16(lo, _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), ones));
+                hi = _mm_add_epi16(hi, _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), ones));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                             _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2)));
+        }
+    } else {
+        const __m128i round = _mm_set1_epi16(8);
+        for (; x + 16 <= count; x += 16) {
+            __m128i pairs[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+            for (int r = 0; r < 4; ++r) {
+                const uint8_t* src = rows[r] + 4 * x;
+                for (int c = 0; c < 4; ++c) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * c));
+                    pairs[c] = _mm_add_epi16(pairs[c], _mm_maddubs_epi16(v, ones));
+                }
+            }
+            const __m128i lo = _mm_add_epi16(_mm_hadd_epi16(pairs[0], pairs[1]), round);
+            const __m128i hi = _mm_add_epi16(_mm_hadd_epi16(pairs[2], pairs[3]), round);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                             _mm_packus_epi16(_mm_srli_epi16(lo, 4), _mm_srli_epi16(hi, 4)));
+        }
+    }
+    areaTail(rows, factor, x, count, out);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static AreaRowKernel selectAreaRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return areaRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) return areaRowSse41;
+#endif
+    (void)cpu;
+    return areaRowScalar;
+}
+
+AreaRowKernel areaRowKernel() {
+    static const AreaRowKernel kernel = selectAreaRowKernel();
+    return kernel;
+}
+
+std::vector<IsaKernel<AreaRowKernel>> areaRowKernels() {
+    std::vector<IsaKernel<AreaRowKernel>> kernels{{"scalar", areaRowScalar}};
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) kernels.push_back({"sse4.1", areaRowSse41});
+#endif
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) kernels.push_back({"neon", areaRowNeon});
+#endif
+    (void)cpu;
+    return kernels;
+}
+
+AreaDownsampleSource::AreaDownsampleSource(GrayRowSource& source, int width, int height, int factor)
+    : source_(source), width_(width), height_(height), factor_(factor), average_(areaRowKernel()) {}
+
+const uint8_t* AreaDownsampleSource::row(int y, uint8_t* scratch) {
+    if (factor_ == 1) return source_.row(y, scratch);
+
+    // All source rows of a block are held at once. Bands call row()
+    // concurrently, so the line buffer is per thread; it only grows.
+    thread_local std::vector<uint8_t> lines;
+    lines.resize(static_cast<size_t>(factor_) * static_cast<size_t>(width_));
+    const uint8_t* rows[4];
+    for (int i = 0; i < factor_; ++i) {
+        const int sy = std::min(y * factor_ + i, height_ - 1);
+        rows[i] = source_.row(sy, lines.data() + static_cast<size_t>(i) * static_cast<size_t>(width_));
+    }
+
+    const int whole = width_ / factor_;
+    average_(rows, factor_, whole, scratch);
+    if (whole * factor_ < width_) {
+        // Partial block at the right border: repeat the last column.
+        int sum = 0;
+        for (int i = 0; i < factor_; ++i) {
+            for (int k = 0; k < factor_; ++k) sum += rows[i][std::min(whole * factor_ + k, width_ - 1)];
+        }
+        scratch[whole] = blockMean(sum, factor_);
+    }
+    return scratch;
+}
+
+void upsamplePackedRow(const uint8_t* packed, int width, int factor, uint8_t* dst) {
+    std::memset(dst, 0, packedMaskStride(width));
+    forEachSetBit(packed, scaledSize(width, factor), [&](int x) {
+        const int end = std::min((x + 1) * factor, width);
+        for (int ox = x * factor; ox < end; ++ox) {
+            dst[ox >> 3] = static_cast<uint8_t>(dst[ox >> 3] | (1u << (ox & 7)));
+        }
+    });
+}
+
+void upsampleByteRow(const uint8_t* packed, int width, int factor, uint8_t on, uint8_t* dst) {
+    std::memset(dst, 0, static_cast<size_t>(width));
+    forEachSetBit(packed, scaledSize(width, factor), [&](int x) {
+        const int begin = x * factor;
+        std::memset(dst + begin, on, static_cast<size_t>(std::min(factor, width - begin)));
+    });
+}
+
+} // namespace edgeviewer
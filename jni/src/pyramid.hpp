@@ -0,0 +1,63 @@
+#pragma once
+
+#include "cpu_features.hpp"
+#include "gray_row_source.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Side of a width or height after reducing by `factor`; a partial block at
+// the right or bottom border still yields a pixel.
+inline int scaledSize(int size, int factor) {
+    return (size + factor - 1) / factor;
+}
+
+// Averages `count` whole factor x factor blocks (factor 2 or 4) into out[0,
+// count): out[x] is the rounded mean of rows[0..factor) at columns
+// [x * factor, (x + 1) * factor).
+using AreaRowKernel = void (*)(const uint8_t* const* rows, int factor, int count, uint8_t* out);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void areaRowScalar(const uint8_t* const* rows, int factor, int count, uint8_t* out);
+
+// Fastest kernel for the running CPU (NEON or SSE4.1), falling back to the
+// scalar reference. Resolved once; safe to call from any thread.
+AreaRowKernel areaRowKernel();
+
+// Every kernel the running CPU supports, scalar first and the one
+// areaRowKernel() returns last.
+std::vector<IsaKernel<AreaRowKernel>> areaRowKernels();
+
+// Streams a width x height source reduced by `factor` (1, 2 or 4): each
+// output pixel is the rounded mean of a factor x factor block (what
+// cv::resize(..., INTER_AREA) computes at an integer ratio, give or take one
+// level of float rounding). Blocks past the right or bottom border reuse the
+// last column / row. Output rows are
+// scaledSize(width, factor) bytes.
+class AreaDownsampleSource : public GrayRowSource {
+public:
+    AreaDownsampleSource(GrayRowSource& source, int width, int height, int factor);
+
+    const uint8_t* row(int y, uint8_t* scratch) override;
+
+private:
+    GrayRowSource& source_;
+    int width_;
+    int height_;
+    int factor_;
+    AreaRowKernel average_;
+};
+
+// Nearest-neighbour upsampling of one packed mask row (edge_mask.hpp layout)
+// by `factor`: output pixel x takes reduced pixel x / factor, so every edge
+// becomes a factor-pixel-wide stroke. `packed` holds scaledSize(width, factor)
+// pixels; `width` is the output width. Writes packedMaskStride(width) bytes,
+// padding bits cleared.
+void upsamplePackedRow(const uint8_t* packed, int width, int factor, uint8_t* dst);
+
+// Writes `width` bytes: `on` for edges, 0 elsewhere.
+void upsampleByteRow(const uint8_t* packed, int width, int factor, uint8_t on, uint8_t* dst);
+
+} // namespace edgeviewer
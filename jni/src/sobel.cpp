@@ -0,0 +1,277 @@
+#include "sobel.hpp"
+
+#include "cpu_features.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+// The SIMD kernels first reduce the three rows to two int16 column sums,
+// smooth = r0 + 2 r1 + r2 and diff = r2 - r0, then read each at x - 1, x and
+// x + 1: dx = smooth[x+1] - smooth[x-1], dy = diff[x-1] + 2 diff[x] + diff[x+1].
+// Every intermediate fits in int16 and magnitudes are formed in int32, so the
+// results equal the nine-tap loop exactly.
+
+namespace edgeviewer {
+
+static inline int magnitudeOf(int gx, int gy, SobelMagnitude magnitude) {
+    return (magnitude == SobelMagnitude::L1) ? std::abs(gx) + std::abs(gy) : gx * gx + gy * gy;
+}
+
+void sobelRowScalar(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                    int16_t* /*scratch*/, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude) {
+    auto sobelAt = [&](int x, int xl, int xr) {
+        const int gx = (r0[xr] - r0[xl]) + 2 * (r1[xr] - r1[xl]) + (r2[xr] - r2[xl]);
+        const int gy = (r2[xl] + 2 * r2[x] + r2[xr]) - (r0[xl] + 2 * r0[x] + r0[xr]);
+        dx[x] = static_cast<int16_t>(gx);
+        dy[x] = static_cast<int16_t>(gy);
+        if (magnitude != SobelMagnitude::None) mag[x] = magnitudeOf(gx, gy, magnitude);
+    };
+    sobelAt(0, 0, std::min(1, width - 1));
+    for (int x = 1; x < width - 1; ++x) {
+        sobelAt(x, x - 1, x + 1);
+    }
+    if (width > 1) sobelAt(width - 1, width - 2, width - 1);
+}
+
+// Column pass for x in [x0, x1).
+static void columnsScalar(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int x0, int x1,
+                          int16_t* smooth, int16_t* diff) {
+    for (int x = x0; x < x1; ++x) {
+        smooth[x] = static_cast<int16_t>(r0[x] + 2 * r1[x] + r2[x]);
+        diff[x] = static_cast<int16_t>(r2[x] - r0[x]);
+    }
+}
+
+// Replicates the edge columns into the slots at [-1] and [width].
+static void padColumns(int16_t* smooth, int16_t* diff, int width) {
+    smooth[-1] = smooth[0];
+    smooth[width] = smooth[width - 1];
+    diff[-1] = diff[0];
+    diff[width] = diff[width - 1];
+}
+
+// Row pass for x in [x0, x1) over padded column sums.
+static void rowsScalar(const int16_t* smooth, const int16_t* diff, int x0, int x1,
+                       int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude) {
+    for (int x = x0; x < x1; ++x) {
+        const int gx = smooth[x + 1] - smooth[x - 1];
+        const int gy = diff[x - 1] + 2 * diff[x] + diff[x + 1];
+        dx[x] = static_cast<int16_t>(gx);
+        dy[x] = static_cast<int16_t>(gy);
+        if (magnitude != SobelMagnitude::None) mag[x] = magnitudeOf(gx, gy, magnitude);
+    }
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+static void sobelRowNeon(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                         int16_t* scratch, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude) {
+    int16_t* smooth = scratch + 1;
+    int16_t* diff = smooth + width + 2;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t a = vld1q_u8(r0 + x);
+        const uint8x16_t b = vld1q_u8(r1 + x);
+        const uint8x16_t c = vld1q_u8(r2 + x);
+        const uint16x8_t sLo = vaddq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(c)), vshll_n_u8(vget_low_u8(b), 1));
+        const uint16x8_t sHi = vaddq_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(c)), vshll_n_u8(vget_high_u8(b), 1));
+        vst1q_s16(smooth + x, vreinterpretq_s16_u16(sLo));
+        vst1q_s16(smooth + x + 8, vreinterpretq_s16_u16(sHi));
+        vst1q_s16(diff + x, vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(c), vget_low_u8(a))));
+        vst1q_s16(diff + x + 8, vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(c), vget_high_u8(a))));
+    }
+    columnsScalar(r0, r1, r2, x, width, smooth, diff);
+    padColumns(smooth, diff, width);
+
+    int32_t* mag32 = reinterpret_cast<int32_t*>(mag);
+    x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const int16x8_t gx = vsubq_s16(vld1q_s16(smooth + x + 1), vld1q_s16(smooth + x - 1));
+        const int16x8_t gy = vaddq_s16(vaddq_s16(vld1q_s16(diff + x - 1), vld1q_s16(diff + x + 1)),
+                                       vshlq_n_s16(vld1q_s16(diff + x), 1));
+        vst1q_s16(dx + x, gx);
+        vst1q_s16(dy + x, gy);
+        if (magnitude == SobelMagnitude::L2Squared) {
+            vst1q_s32(mag32 + x, vmlal_s16(vmull_s16(vget_low_s16(gx), vget_low_s16(gx)), vget_low_s16(gy), vget_low_s16(gy)));
+            vst1q_s32(mag32 + x + 4, vmlal_s16(vmull_s16(vget_high_s16(gx), vget_high_s16(gx)), vget_high_s16(gy), vget_high_s16(gy)));
+        } else if (magnitude == SobelMagnitude::L1) {
+            const int16x8_t m = vaddq_s16(vabsq_s16(gx), vabsq_s16(gy));
+            vst1q_s32(mag32 + x, vmovl_s16(vget_low_s16(m)));
+            vst1q_s32(mag32 + x + 4, vmovl_s16(vget_high_s16(m)));
+        }
+    }
+    rowsScalar(smooth, diff, x, width, dx, dy, mag, magnitude);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+__attribute__((target("sse4.1")))
+static void sobelRowSse41(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                          int16_t* scratch, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude) {
+    int16_t* smooth = scratch + 1;
+    int16_t* diff = smooth + width + 2;
+    const __m128i zero = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + x));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r2 + x));
+        const __m128i aLo = _mm_unpacklo_epi8(a, zero), aHi = _mm_unpackhi_epi8(a, zero);
+        const __m128i bLo = _mm_unpacklo_epi8(b, zero), bHi = _mm_unpackhi_epi8(b, zero);
+        const __m128i cLo = _mm_unpacklo_epi8(c, zero), cHi = _mm_unpackhi_epi8(c, zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(smooth + x), _mm_add_epi16(_mm_add_epi16(aLo, cLo), _mm_slli_epi16(bLo, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(smooth + x + 8), _mm_add_epi16(_mm_add_epi16(aHi, cHi), _mm_slli_epi16(bHi, 1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(diff + x), _mm_sub_epi16(cLo, aLo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(diff + x + 8), _mm_sub_epi16(cHi, aHi));
+    }
+    columnsScalar(r0, r1, r2, x, width, smooth, diff);
+    padColumns(smooth, diff, width);
+
+    x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i gx = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(smooth + x + 1)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(smooth + x - 1)));
+        const __m128i gy = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(diff + x - 1)),
+                                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(diff + x + 1))),
+                                         _mm_slli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(diff + x)), 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dx + x), gx);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dy + x), gy);
+        if (magnitude == SobelMagnitude::L2Squared) {
+            // pmaddwd over (dx, dy) pairs gives dx^2 + dy^2 per pixel.
+            const __m128i lo = _mm_unpacklo_epi16(gx, gy);
+            const __m128i hi = _mm_unpackhi_epi16(gx, gy);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mag + x), _mm_madd_epi16(lo, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mag + x + 4), _mm_madd_epi16(hi, hi));
+        } else if (magnitude == SobelMagnitude::L1) {
+            const __m128i m = _mm_add_epi16(_mm_abs_epi16(gx), _mm_abs_epi16(gy));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mag + x), _mm_cvtepi16_epi32(m));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mag + x + 4), _mm_cvtepi16_epi32(_mm_srli_si128(m, 8)));
+        }
+    }
+    rowsScalar(smooth, diff, x, width, dx, dy, mag, magnitude);
+}
+
+__attribute__((target("avx2")))
+static void sobelRowAvx2(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                         int16_t* scratch, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude) {
+    int16_t* smooth = scratch + 1;
+    int16_t* diff = smooth + width + 2;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + x)));
+        const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + x)));
+        const __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r2 + x)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(smooth + x), _mm256_add_epi16(_mm256_add_epi16(a, c), _mm256_slli_epi16(b, 1)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(diff + x), _mm256_sub_epi16(c, a));
+    }
+    columnsScalar(r0, r1, r2, x, width, smooth, diff);
+    padColumns(smooth, diff, width);
+
+    x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i gx = _mm256_sub_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(smooth + x + 1)),
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(smooth + x - 1)));
+        const __m256i gy = _mm256_add_epi16(_mm256_add_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(diff + x - 1)),
+                                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diff + x + 1))),
+                                            _mm256_slli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(diff + x)), 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dx + x), gx);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dy + x), gy);
+        if (magnitude == SobelMagnitude::L2Squared) {
+            // The in-lane unpack leaves pixels 0-3/8-11 in lo and 4-7/12-15
+            // in hi; the lane permutes restore pixel order.
+            const __m256i lo = _mm256_unpacklo_epi16(gx, gy);
+            const __m256i hi = _mm256_unpackhi_epi16(gx, gy);
+            const __m256i mLo = _mm256_madd_epi16(lo, lo);
+            const __m256i mHi = _mm256_madd_epi16(hi, hi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mag + x), _mm256_permute2x128_si256(mLo, mHi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mag + x + 8), _mm256_permute2x128_si256(mLo, mHi, 0x31));
+        } else if (magnitude == SobelMagnitude::L1) {
+            const __m256i m = _mm256_add_epi16(_mm256_abs_epi16(gx), _mm256_abs_epi16(gy));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mag + x), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(m)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mag + x + 8), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(m, 1)));
+        }
+    }
+    rowsScalar(smooth, diff, x, width, dx, dy, mag, magnitude);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static SobelRowKernel selectSobelRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return sobelRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return sobelRowAvx2;
+    if (cpu.sse41) return sobelRowSse41;
+#endif
+    (void)cpu;
+    return sobelRowScalar;
+}
+
+SobelRowKernel sobelRowKernel() {
+    static const SobelRowKernel kernel = selectSobelRowKernel();
+    return kernel;
+}
+
+std::vector<IsaKernel<SobelRowKernel>> sobelRowKernels() {
+    std::vector<IsaKernel<SobelRowKernel>> kernels{{"scalar", sobelRowScalar}};
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) kernels.push_back({"sse4.1", sobelRowSse41});
+    if (cpu.avx2) kernels.push_back({"avx2", sobelRowAvx2});
+#endif
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) kernels.push_back({"neon", sobelRowNeon});
+#endif
+    (void)cpu;
+    return kernels;
+}
+
+void sobelRows(GrayRowSource& source,
+               int width,
+               int height,
+               int y0,
+               int y1,
+               int16_t* dx,
+               int16_t* dy,
+               int gradStride,
+               int* mag,
+               int magStride,
+               SobelMagnitude magnitude) {
+    constexpr int kRingRows = 3;
+    const size_t w = static_cast<size_t>(width);
+    std::vector<uint8_t> ring(kRingRows * w);
+    std::vector<int16_t> scratch(2 * (w + 2));
+    const uint8_t* rows[kRingRows] = {};
+    const SobelRowKernel sobelRow = sobelRowKernel();
+
+    int next = std::max(y0 - 1, 0);
+    for (int y = y0; y < y1; ++y) {
+        for (const int last = std::min(y + 1, height - 1); next <= last; ++next) {
+            rows[next % kRingRows] = source.row(next, ring.data() + (next % kRingRows) * w);
+        }
+        const size_t gradOffset = static_cast<size_t>(y) * static_cast<size_t>(gradStride);
+        int* magRow = (magnitude != SobelMagnitude::None) ? mag + static_cast<size_t>(y) * static_cast<size_t>(magStride) : nullptr;
+        sobelRow(rows[std::max(y - 1, 0) % kRingRows], rows[y % kRingRows], rows[std::min(y + 1, height - 1) % kRingRows],
+                 width, scratch.data(), dx + gradOffset, dy + gradOffset, magRow, magnitude);
+    }
+}
+
+} // namespace edgeviewer
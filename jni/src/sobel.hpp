@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cpu_features.hpp"
+#include "gray_row_source.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Optional magnitude written next to the gradients.
+enum class SobelMagnitude {
+    None,      // gradients only; `mag` may be null
+    L1,        // |dx| + |dy|
+    L2Squared, // dx * dx + dy * dy, what cv::Canny compares against squared thresholds
+};
+
+// 3x3 Sobel of one row: dx = right - left column, dy = bottom - top row, both
+// weighted [1 2 1], as int16 (|value| <= 1020). r0/r1/r2 are the rows above,
+// at and below the output row (the caller picks how to extend the image
+// vertically); left and right neighbours are replicated at the borders.
+// `scratch` holds 2 * (width + 2) int16 values.
+using SobelRowKernel = void (*)(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                                int16_t* scratch, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude);
+
+// Portable reference: the direct nine-tap loop. Every SIMD kernel, which
+// instead runs the separable form ([1 2 1] down the columns, then [-1 0 1]
+// and [1 2 1] along the row), is bit-exact with it.
+void sobelRowScalar(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int width,
+                    int16_t* scratch, int16_t* dx, int16_t* dy, int* mag, SobelMagnitude magnitude);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+SobelRowKernel sobelRowKernel();
+
+// Every kernel the running CPU supports, scalar first and the one
+// sobelRowKernel() returns last.
+std::vector<IsaKernel<SobelRowKernel>> sobelRowKernels();
+
+// Gradients for output rows [y0, y1) of a width x height image with
+// replicated borders on all sides (cv::Sobel with BORDER_REPLICATE). Row y
+// goes to dx/dy + y * gradStride and, unless `magnitude` is None,
+// mag + y * magStride (strides in elements).
+void sobelRows(GrayRowSource& source,
+               int width,
+               int height,
+               int y0,
+               int y1,
+               int16_t* dx,
+               int16_t* dy,
+               int gradStride,
+               int* mag,
+               int magStride,
+               SobelMagnitude magnitude);
+
+} // namespace edgeviewer
@@ -0,0 +1,344 @@
+#include "stage_graph.hpp"
+#include "gaussian.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace edgeviewer {
+
+namespace {
+    // Smallest band handed to a worker thread.
+    constexpr int kMinBandRows = 32;
+
+    // Rounds over the stages a Pipeline participant that finds nothing to
+    // do retries, yielding in between, before it sleeps.
+    constexpr int kSpinRounds = 32;
+
+    // Lets idle Pipeline participants sleep instead of spinning: every
+    // published stripe bumps `epoch`, and a participant that found nothing
+    // to do since it read `epoch` waits for it to change. The same
+    // handshake as WorkerPool's sleepers: a publisher that sees no sleeper
+    // skips the lock, and one that does takes it before notifying, so a
+    // sleeper between its check and its wait is not missed.
+    struct PipelineProgress {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<int> sleepers{0};
+        std::mutex mutex;
+        std::condition_variable published;
+
+        void publish() {
+            epoch.fetch_add(1);
+            if (sleepers.load() == 0) return;
+            { std::lock_guard<std::mutex> lock(mutex); }
+            published.notify_all();
+        }
+
+        void waitPast(uint64_t seen) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleepers.fetch_add(1);
+            published.wait(lock, [&] { return epoch.load() != seen; });
+            sleepers.fetch_sub(1);
+        }
+    };
+}
+
+// Extends row y of an image `height` rows tall past its top and bottom.
+static inline int borderRow(int y, int height, StageBorder border) {
+    if (border == StageBorder::Reflect101) return borderReflect101(y, height);
+    return std::min(std::max(y, 0), height - 1);
+}
+
+void StageGraph::append(std::unique_ptr<ImageStage> stage) {
+    stages_.push_back(std::move(stage));
+    planned_ = false;
+}
+
+int StageGraph::inputPixelBytes(size_t stage) const {
+    return (stage == 0) ? inputPixelBytes_ : stages_[stage - 1]->outputPixelBytes();
+}
+
+int StageGraph::outputPixelBytes() const {
+    return stages_.empty() ? 0 : stages_.back()->outputPixelBytes();
+}
+
+void StageGraph::setSchedule(StageSchedule schedule) {
+    schedule_ = schedule;
+    planned_ = false;
+}
+
+int StageGraph::bandCount(WorkerPool* pool) const {
+    if (schedule_ == StageSchedule::Pipeline) return 1;
+    const int threads = pool ? pool->threadCount() : 1;
+    return std::max(1, std::min(threads, height_ / kMinBandRows));
+}
+
+bool StageGraph::plan(int width, int height, int inputPixelBytes, WorkerPool* pool) {
+    planned_ = false;
+    passes_.clear();
+    slotBytes_.clear();
+    if (stages_.empty() || width <= 0 || height <= 0 || inputPixelBytes <= 0) return false;
+    for (const std::unique_ptr<ImageStage>& stage : stages_) {
+        const StageFootprint footprint = stage->footprint();
+        if (footprint.shape == StageShape::Stencil && (footprint.radius < 0 || footprint.radius > kMaxRadius)) return false;
+    }
+    width_ = width;
+    height_ = height;
+    inputPixelBytes_ = inputPixelBytes;
+
+    // Passes: a Frame stage alone, every run of row stages together.
+    for (size_t first = 0; first < stages_.size();) {
+        size_t last = first;
+        if (stages_[first]->footprint().shape != StageShape::Frame) {
+            while (last + 1 < stages_.size() && stages_[last + 1]->footprint().shape != StageShape::Frame) ++last;
+        }
+        passes_.push_back(Pass{first, last, -1, -1});
+        first = last + 1;
+    }
+
+    // Frame buffers: pass p's result is read by pass p + 1 only, so any slot
+    // other than the one pass p reads from is free for it, and two slots,
+    // each as large as the largest result it carries, cover any chain.
+    for (size_t p = 0; p + 1 < passes_.size(); ++p) {
+        Pass& pass = passes_[p];
+        if (p > 0) pass.source = passes_[p - 1].target;
+        const size_t bytes = static_cast<size_t>(width) * static_cast<size_t>(height) *
+                             static_cast<size_t>(stages_[pass.last]->outputPixelBytes());
+        int slot = 0;
+        while (slot == pass.source) ++slot;
+        if (static_cast<size_t>(slot) >= slotBytes_.size()) slotBytes_.resize(static_cast<size_t>(slot) + 1, 0);
+        slotBytes_[static_cast<size_t>(slot)] = std::max(slotBytes_[static_cast<size_t>(slot)], bytes);
+        pass.target = slot;
+    }
+    if (passes_.size() > 1) passes_.back().source = passes_[passes_.size() - 2].target;
+
+    // Row pipelines: walking a pass backwards gives each stage the halo its
+    // successors need; walking forwards, the iteration it runs at.
+    rowPlans_.assign(stages_.size(), RowPlan());
+    for (const Pass& pass : passes_) {
+        if (stages_[pass.first]->footprint().shape == StageShape::Frame) continue;
+        int halo = 0;
+        for (size_t k = pass.last + 1; k-- > pass.first;) {
+            const StageFootprint footprint = stages_[k]->footprint();
+            RowPlan& plan = rowPlans_[k];
+            plan.radius = (footprint.shape == StageShape::Stencil) ? footprint.radius : 0;
+            plan.border = footprint.border;
+            plan.halo = halo;
+            plan.ringRows = (k < pass.last) ? 2 * rowPlans_[k + 1].radius + 1 : 0;
+            // Room for the producer to get two stripes ahead.
+            if (k < pass.last && schedule_ == StageSchedule::Pipeline) plan.ringRows += 2 * kStripeRows;
+            plan.rowBytes = static_cast<size_t>(width) * static_cast<size_t>(stages_[k]->outputPixelBytes());
+            plan.scratchBytes = static_cast<const RowStage&>(*stages_[k]).scratchBytes(width);
+            halo += plan.radius;
+        }
+        int delay = 0;
+        for (size_t k = pass.first; k <= pass.last; ++k) {
+            if (k > pass.first) delay += rowPlans_[k].radius;
+            rowPlans_[k].delay = delay;
+        }
+    }
+
+    // Lay out one frame, so the arena's block fits every following one.
+    const int bands = bandCount(pool);
+    arena_.reset();
+    carveSlots();
+    for (const Pass& pass : passes_) {
+        FrameArena::Scope scope(arena_);
+        if (stages_[pass.first]->footprint().shape != StageShape::Frame) carvePass(pass, bands);
+    }
+    arena_.reset();
+    cursors_.reset(new StageCursor[stages_.size() + 1]);
+    planned_ = true;
+    return true;
+}
+
+uint8_t** StageGraph::carveSlots() {
+    uint8_t** slots = arena_.allocate<uint8_t*>(slotBytes_.size());
+    for (size_t s = 0; s < slotBytes_.size(); ++s) slots[s] = arena_.allocate<uint8_t>(slotBytes_[s]);
+    return slots;
+}
+
+StageGraph::PassBuffers StageGraph::carvePass(const Pass& pass, int bands) {
+    const size_t count = pass.last - pass.first + 1;
+    PassBuffers buffers;
+    buffers.rings = arena_.allocate<uint8_t*>(static_cast<size_t>(bands) * count);
+    buffers.scratch = arena_.allocate<void*>(static_cast<size_t>(bands) * count);
+    for (int b = 0; b < bands; ++b) {
+        for (size_t i = 0; i < count; ++i) {
+            const RowPlan& plan = rowPlans_[pass.first + i];
+            const size_t slot = static_cast<size_t>(b) * count + i;
+            buffers.rings[slot] = arena_.allocate<uint8_t>(static_cast<size_t>(plan.ringRows) * plan.rowBytes);
+            buffers.scratch[slot] = arena_.allocateBytes(plan.scratchBytes);
+        }
+    }
+    return buffers;
+}
+
+// Writes row y of stage k (of `pass`) from its input: the pass input for the
+// first stage, the previous stage's ring otherwise.
+void StageGraph::produceRow(const Pass& pass, uint8_t* const* rings, void* const* scratch, size_t k, int y,
+                            const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const {
+    const RowPlan& plan = rowPlans_[k];
+    const size_t index = k - pass.first;
+    const uint8_t* rows[2 * kMaxRadius + 1];
+    for (int t = 0; t <= 2 * plan.radius; ++t) {
+        const int row = borderRow(y - plan.radius + t, height_, plan.border);
+        if (k == pass.first) {
+            rows[t] = src + static_cast<size_t>(row) * srcStride;
+        } else {
+            const RowPlan& previous = rowPlans_[k - 1];
+            rows[t] = rings[index - 1] + static_cast<size_t>(row % previous.ringRows) * previous.rowBytes;
+        }
+    }
+    uint8_t* out = (k == pass.last) ? dst + static_cast<size_t>(y) * dstStride
+                                    : rings[index] + static_cast<size_t>(y % plan.ringRows) * plan.rowBytes;
+    static_cast<const RowStage&>(*stages_[k]).processRow(rows, width_, y, out, scratch[index]);
+}
+
+// Streams output rows [y0, y1) of one band through the pass. On iteration i
+// stage k produces its row i - delay, so every stage reads rows its
+// predecessor has just written and its ring still holds; the first stage
+// reads the pass input directly.
+void StageGraph::streamBand(const Pass& pass, const PassBuffers& buffers, int band, int y0, int y1,
+                            const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const {
+    const size_t count = pass.last - pass.first + 1;
+    uint8_t* const* rings = buffers.rings + static_cast<size_t>(band) * count;
+    void* const* scratch = buffers.scratch + static_cast<size_t>(band) * count;
+
+    const int begin = y0 - rowPlans_[pass.first].halo;
+    const int end = y1 + rowPlans_[pass.last].delay;
+    for (int i = begin; i < end; ++i) {
+        for (size_t k = pass.first; k <= pass.last; ++k) {
+            const RowPlan& plan = rowPlans_[k];
+            const int y = i - plan.delay;
+            if (y < std::max(y0 - plan.halo, 0) || y >= std::min(y1 + plan.halo, height_)) continue;
+            produceRow(pass, rings, scratch, k, y, src, srcStride, dst, dstStride);
+        }
+    }
+}
+
+// Pipeline schedule: writes up to a stripe of stage k's next rows, as far as
+// the stage before has published its input rows (row y needs them up to
+// y + radius) and the stage after has finished with the ring rows they
+// replace. The caller holds the stage's busy flag. Returns whether any row
+// was written.
+bool StageGraph::advanceStage(const Pass& pass, const PassBuffers& buffers, size_t k,
+                              const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const {
+    const RowPlan& plan = rowPlans_[k];
+    const int start = cursors_[k].done.load(std::memory_order_relaxed);
+    int limit = std::min(start + kStripeRows, height_);
+    if (k > pass.first) {
+        const int input = cursors_[k - 1].done.load(std::memory_order_acquire);
+        if (input < height_) limit = std::min(limit, input - plan.radius);
+    }
+    if (k < pass.last) {
+        // Row y replaces row y - ringRows, which the next stage reads until
+        // it has written row y - ringRows + its radius.
+        const int freed = cursors_[k + 1].done.load(std::memory_order_acquire);
+        limit = std::min(limit, freed + plan.ringRows - rowPlans_[k + 1].radius);
+    }
+    if (limit <= start) return false;
+
+    for (int y = start; y < limit; ++y) {
+        produceRow(pass, buffers.rings, buffers.scratch, k, y, src, srcStride, dst, dstStride);
+    }
+    cursors_[k].done.store(limit, std::memory_order_release);
+    if (k + 1 == stages_.size()) cursors_[stages_.size()].done.store(limit, std::memory_order_release);
+    return true;
+}
+
+// Runs one participant per stage (at most one per pool thread). Each starts
+// from its own stage and takes the first stage that is free and can move,
+// so every stage keeps one thread while there are enough, and the caller
+// alone still finishes the pass if no worker joins in. A participant that
+// finds no stage to move yields for a few rounds, then sleeps until another
+// one publishes a stripe; the last stripe of the pass wakes everyone.
+void StageGraph::streamPipelined(const Pass& pass, const PassBuffers& buffers, WorkerPool& pool,
+                                 const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const {
+    const size_t count = pass.last - pass.first + 1;
+    for (size_t k = pass.first; k <= pass.last; ++k) {
+        cursors_[k].done.store(0, std::memory_order_relaxed);
+        cursors_[k].busy.store(false, std::memory_order_relaxed);
+    }
+    const int participants = static_cast<int>(std::min<size_t>(static_cast<size_t>(pool.threadCount()), count));
+    PipelineProgress progress;
+    const auto participant = [&](int p) {
+        const size_t home = count * static_cast<size_t>(p) / static_cast<size_t>(participants);
+        int idle = 0;
+        while (cursors_[pass.last].done.load(std::memory_order_acquire) < height_) {
+            // Read before looking at the stages, so a stripe published after
+            // the look ends the wait below.
+            const uint64_t seen = progress.epoch.load();
+            bool advanced = false;
+            for (size_t n = 0; n < count && !advanced; ++n) {
+                StageCursor& cursor = cursors_[pass.first + (home + n) % count];
+                if (cursor.done.load(std::memory_order_relaxed) == height_ ||
+                    cursor.busy.exchange(true, std::memory_order_acquire)) {
+                    continue;
+                }
+                advanced = advanceStage(pass, buffers, pass.first + (home + n) % count, src, srcStride, dst, dstStride);
+                cursor.busy.store(false, std::memory_order_release);
+            }
+            if (advanced) {
+                progress.publish();
+                idle = 0;
+            } else if (++idle < kSpinRounds) {
+                std::this_thread::yield();
+            } else {
+                progress.waitPast(seen);
+            }
+        }
+    };
+    // By reference: std::function never allocates for a reference_wrapper.
+    pool.parallelFor(participants, std::cref(participant));
+}
+
+bool StageGraph::run(const uint8_t* input, size_t inputStride, uint8_t* output, size_t outputStride, WorkerPool* pool) {
+    if (!planned_ || input == nullptr || output == nullptr) return false;
+
+    arena_.reset();
+    uint8_t** slotData = carveSlots();
+    StageCursor& ready = cursors_[stages_.size()];
+    ready.done.store(0, std::memory_order_relaxed);
+
+    const int bands = bandCount(pool);
+    for (const Pass& pass : passes_) {
+        const uint8_t* src = (pass.source < 0) ? input : slotData[pass.source];
+        const size_t srcStride = (pass.source < 0) ? inputStride
+                                                   : static_cast<size_t>(width_) * static_cast<size_t>(inputPixelBytes(pass.first));
+        uint8_t* dst = (pass.target < 0) ? output : slotData[pass.target];
+        const size_t dstStride = (pass.target < 0) ? outputStride
+                                                   : static_cast<size_t>(width_) * static_cast<size_t>(stages_[pass.last]->outputPixelBytes());
+
+        if (stages_[pass.first]->footprint().shape == StageShape::Frame) {
+            static_cast<const FrameStage&>(*stages_[pass.first]).processFrame(src, srcStride, width_, height_, dst, dstStride);
+            continue;
+        }
+
+        // Rings are only live during their pass.
+        FrameArena::Scope scope(arena_);
+        const PassBuffers buffers = carvePass(pass, bands);
+        if (schedule_ == StageSchedule::Pipeline && pool && pool->threadCount() > 1 && pass.last > pass.first) {
+            streamPipelined(pass, buffers, *pool, src, srcStride, dst, dstStride);
+            continue;
+        }
+        const auto body = [&](int b) {
+            const int y0 = static_cast<int>(static_cast<int64_t>(height_) * b / bands);
+            const int y1 = static_cast<int>(static_cast<int64_t>(height_) * (b + 1) / bands);
+            streamBand(pass, buffers, b, y0, y1, src, srcStride, dst, dstStride);
+        };
+        if (pool && bands > 1) {
+            // By reference: std::function never allocates for a reference_wrapper.
+            pool->parallelFor(bands, std::cref(body));
+        } else {
+            body(0);
+        }
+    }
+    ready.done.store(height_, std::memory_order_release);
+    return true;
+}
+
+} // namespace edgeviewer
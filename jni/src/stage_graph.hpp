@@ -0,0 +1,226 @@
+#pragma once
+
+#include "frame_arena.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace edgeviewer {
+
+class WorkerPool;
+
+// How a stage reads its input, which decides how it can be scheduled.
+enum class StageShape {
+    PointWise, // output pixel (x, y) from input pixel (x, y)
+    Stencil,   // output row y from input rows y - radius .. y + radius
+    Frame,     // needs the whole input frame before producing anything
+};
+
+// How a Stencil stage's rows are extended past the top and bottom of the
+// image; each stage handles its own left and right borders.
+enum class StageBorder {
+    Replicate,  // cv::BORDER_REPLICATE
+    Reflect101, // cv::BORDER_REFLECT_101
+};
+
+// How StageGraph::run spreads a streaming pass over a pool's threads.
+enum class StageSchedule {
+    Bands,    // horizontal bands, each streamed through every stage by one thread
+    Pipeline, // stages side by side, each a few stripes behind the one before it
+};
+
+struct StageFootprint {
+    StageShape shape = StageShape::PointWise;
+    int radius = 0; // Stencil only, at most StageGraph::kMaxRadius
+    StageBorder border = StageBorder::Replicate;
+};
+
+// One image-to-image step of a StageGraph. Every stage keeps the frame size;
+// the pixel type of its input is whatever the previous stage (or the graph
+// input) produces, so stages are chained with matching types in mind.
+class ImageStage {
+public:
+    virtual ~ImageStage() = default;
+
+    virtual StageFootprint footprint() const = 0;
+
+    // Bytes per output pixel.
+    virtual int outputPixelBytes() const = 0;
+};
+
+// A PointWise or Stencil stage, run one output row at a time.
+class RowStage : public ImageStage {
+public:
+    // Working memory processRow needs for a row `width` pixels wide.
+    virtual size_t scratchBytes(int width) const {
+        (void)width;
+        return 0;
+    }
+
+    // Writes output row y. rows[k] is input row y - radius + k, already
+    // extended at the top and bottom per the footprint (one row for
+    // PointWise). Called concurrently for different bands, each with its own
+    // `scratch`; with StageSchedule::Pipeline, by one thread at a time but
+    // not always the same one.
+    virtual void processRow(const uint8_t* const* rows, int width, int y, uint8_t* out, void* scratch) const = 0;
+};
+
+// A stage that needs its whole input, e.g. a connected-component or global
+// histogram step.
+class FrameStage : public ImageStage {
+public:
+    virtual void processFrame(const uint8_t* src, size_t srcStride, int width, int height,
+                              uint8_t* dst, size_t dstStride) const = 0;
+};
+
+// A chain of stages compiled into as few passes over the frame as possible.
+//
+// plan() fuses each run of consecutive row stages into one pass that streams
+// the frame top to bottom: every stage hands its rows to the next through a
+// ring just deep enough for the next stage's stencil (2 * radius + 1 rows,
+// one for PointWise), so a gray -> blur -> Sobel -> threshold chain touches
+// only a few rows of intermediates at a time and they stay in cache. A Frame
+// stage gets a pass of its own, and the intermediate between two passes is
+// the only frame-sized buffer; those buffers are assigned to slots by
+// lifetime, so a slot is reused as soon as the pass reading it is done.
+// Rings, stage scratch and slots live in one FrameArena sized by plan().
+//
+// With a pool, streaming passes split the frame into horizontal bands that
+// each recompute the halo rows their stencils need, so the result is
+// identical to a single-threaded run.
+//
+// StageSchedule::Pipeline instead runs the stages of a pass side by side:
+// each streams the whole frame, one thread at a time, a few kStripeRows
+// stripes behind the stage before it, with deeper rings so neighbours do
+// not wait on each other row by row. Stripes are handed over through one
+// atomic row counter per stage (release when a stripe is written, acquire
+// before reading it or reusing its ring rows), without locks. Every thread
+// prefers its own stages but advances any stage that is ready and free, so
+// a pass finishes on however many threads the pool can spare, even just the
+// caller. A thread with no stage ready yields for a few rounds, then sleeps
+// until another publishes a stripe. The first output rows are final long
+// before the frame is converted (see rowsReady()), and no halo rows are
+// computed twice; the result is the same as with Bands.
+//
+// Not thread-safe: one graph per stream of frames.
+class StageGraph {
+public:
+    static constexpr int kMaxRadius = 7;
+    // Rows a Pipeline stage writes before publishing them.
+    static constexpr int kStripeRows = 16;
+
+    // Appends a stage constructed from `args` and returns it, so callers can
+    // keep adjusting its parameters between frames. Invalidates the plan.
+    template <typename Stage, typename... Args>
+    Stage& add(Args&&... args) {
+        std::unique_ptr<Stage> stage(new Stage(std::forward<Args>(args)...));
+        Stage& result = *stage;
+        append(std::move(stage));
+        return result;
+    }
+
+    // Groups the stages into passes and sizes every buffer for
+    // width x height frames whose input has `inputPixelBytes` per pixel.
+    // Returns false for an empty graph, a non-positive size or a stencil
+    // radius over kMaxRadius.
+    bool plan(int width, int height, int inputPixelBytes, WorkerPool* pool);
+
+    // Invalidates the plan; Bands by default.
+    void setSchedule(StageSchedule schedule);
+    StageSchedule schedule() const { return schedule_; }
+
+    bool isPlanned() const { return planned_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // Passes plan() settled on, and the frame-sized buffers between them.
+    size_t passCount() const { return passes_.size(); }
+    size_t frameBufferCount() const { return slotBytes_.size(); }
+
+    // Bytes per pixel of the graph's result (that of its last stage).
+    int outputPixelBytes() const;
+
+    // Runs every stage on a frame of the planned size, reading `input` and
+    // writing the result to `output` (row strides in bytes). `pool` may
+    // differ from the one planned with; a busier pool costs an allocation on
+    // its first frame. Returns false when the graph is not planned.
+    bool run(const uint8_t* input, size_t inputStride, uint8_t* output, size_t outputStride, WorkerPool* pool);
+
+    // Output rows [0, rowsReady()) of the frame run() is working on are
+    // final. Safe to poll from another thread during run(); with Bands it
+    // only moves when the frame is done.
+    int rowsReady() const { return planned_ ? cursors_[stages_.size()].done.load(std::memory_order_acquire) : 0; }
+
+    // Most bytes of rings, scratch and frame buffers a frame has needed.
+    size_t scratchHighWater() const { return arena_.highWater(); }
+
+private:
+    // Stages [first, last] run in one pass. Frame buffers are identified by
+    // slot; -1 means the graph input (source) or output (target).
+    struct Pass {
+        size_t first;
+        size_t last;
+        int source;
+        int target;
+    };
+
+    // Where a row stage sits in its pass: it produces its rows `delay`
+    // iterations after the pass's first stage, `halo` rows beyond the band
+    // on each side for the stencils after it, into a ring of `ringRows` rows
+    // of `rowBytes` (unless it is the pass's last stage).
+    struct RowPlan {
+        int radius;
+        StageBorder border;
+        int delay;
+        int halo;
+        int ringRows;
+        size_t rowBytes;
+        size_t scratchBytes;
+    };
+
+    // A row pass's rings and scratch, per band and stage.
+    struct PassBuffers {
+        uint8_t** rings;
+        void** scratch;
+    };
+
+    // Pipeline progress of one stage: rows written and published, and
+    // whether a thread is running it.
+    struct alignas(64) StageCursor {
+        std::atomic<int> done{0};
+        std::atomic<bool> busy{false};
+    };
+
+    void append(std::unique_ptr<ImageStage> stage);
+    int inputPixelBytes(size_t stage) const;
+    int bandCount(WorkerPool* pool) const;
+    uint8_t** carveSlots();
+    PassBuffers carvePass(const Pass& pass, int bands);
+    void produceRow(const Pass& pass, uint8_t* const* rings, void* const* scratch, size_t k, int y,
+                    const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const;
+    void streamBand(const Pass& pass, const PassBuffers& buffers, int band, int y0, int y1,
+                    const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const;
+    bool advanceStage(const Pass& pass, const PassBuffers& buffers, size_t k,
+                      const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const;
+    void streamPipelined(const Pass& pass, const PassBuffers& buffers, WorkerPool& pool,
+                         const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride) const;
+
+    std::vector<std::unique_ptr<ImageStage>> stages_;
+    std::vector<RowPlan> rowPlans_; // per stage; unused for Frame stages
+    std::vector<Pass> passes_;
+    std::vector<size_t> slotBytes_;
+    int width_ = 0;
+    int height_ = 0;
+    int inputPixelBytes_ = 0;
+    StageSchedule schedule_ = StageSchedule::Bands;
+    bool planned_ = false;
+    FrameArena arena_;
+    // One per stage, then one for the rows of the graph's output that are ready.
+    std::unique_ptr<StageCursor[]> cursors_;
+};
+
+} // namespace edgeviewer
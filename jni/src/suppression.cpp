@@ -0,0 +1,222 @@
+#include "suppression.hpp"
+
+#include "cpu_features.hpp"
+#include "edge_mask.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+// The SIMD kernels evaluate all three direction cases for every pixel and
+// blend the neighbour pair the quantized direction picks, so noisy rows, where
+// the direction changes from pixel to pixel, cost no branch mispredictions.
+// All arithmetic stays in int32 lanes (|dx| <= 1020, so |dx| << 16 fits).
+
+namespace edgeviewer {
+
+// tan(22.5 deg) in Q15, as used by OpenCV's direction quantization.
+static constexpr int kTan22Q15 = 13573;
+
+static inline bool isLocalMax(const int* prev, const int* cur, const int* next, int gx, int gy, int x) {
+    const int m = cur[x];
+    const int xs = std::abs(gx);
+    const int ys = std::abs(gy);
+    const int tg22x = xs * kTan22Q15;
+    const int yq = ys << 15;
+    if (yq < tg22x) {
+        return m > cur[x - 1] && m >= cur[x + 1];
+    }
+    const int tg67x = tg22x + (xs << 16);
+    if (yq > tg67x) {
+        return m > prev[x] && m >= next[x];
+    }
+    const int s = ((gx ^ gy) < 0) ? -1 : 1;
+    return m > prev[x - s] && m > next[x + s];
+}
+
+// Suppresses pixels [x0, width) of a row, x0 a multiple of 8, and clears the
+// rest of the row's padding.
+static void localMaxTail(const int* prev, const int* cur, const int* next, const int16_t* dx, const int16_t* dy,
+                         int x0, int width, int floor, uint8_t* mask) {
+    size_t byte = static_cast<size_t>(x0) / 8;
+    for (int x = x0; x < width; x += 8) {
+        const int count = (width - x < 8) ? width - x : 8;
+        uint8_t bits = 0;
+        for (int b = 0; b < count; ++b) {
+            const bool on = cur[x + b] > floor && isLocalMax(prev, cur, next, dx[x + b], dy[x + b], x + b);
+            bits |= static_cast<uint8_t>(on << b);
+        }
+        mask[byte++] = bits;
+    }
+    std::memset(mask + byte, 0, packedMaskStride(width) - byte);
+}
+
+void localMaxRowScalar(const int* prev, const int* cur, const int* next,
+                       const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask) {
+    localMaxTail(prev, cur, next, dx, dy, 0, width, floor, mask);
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+// Lanes of pixels x..x+3 that are maxima above the floor, as all-ones masks.
+static inline uint32x4_t localMax4Neon(const int* prev, const int* cur, const int* next,
+                                       int16x4_t dx, int16x4_t dy, int x, int32x4_t floor) {
+    const int32x4_t gx = vmovl_s16(dx);
+    const int32x4_t gy = vmovl_s16(dy);
+    const int32x4_t xs = vabsq_s32(gx);
+    const int32x4_t tg22x = vmulq_n_s32(xs, kTan22Q15);
+    const int32x4_t tg67x = vaddq_s32(tg22x, vshlq_n_s32(xs, 16));
+    const int32x4_t yq = vshlq_n_s32(vabsq_s32(gy), 15);
+    const uint32x4_t horizontal = vcltq_s32(yq, tg22x);
+    const uint32x4_t vertical = vcgtq_s32(yq, tg67x);
+    const uint32x4_t negative = vcltq_s32(veorq_s32(gx, gy), vdupq_n_s32(0));
+
+    const int32x4_t diagA = vbslq_s32(negative, vld1q_s32(prev + x + 1), vld1q_s32(prev + x - 1));
+    const int32x4_t diagB = vbslq_s32(negative, vld1q_s32(next + x - 1), vld1q_s32(next + x + 1));
+    const int32x4_t a = vbslq_s32(horizontal, vld1q_s32(cur + x - 1), vbslq_s32(vertical, vld1q_s32(prev + x), diagA));
+    const int32x4_t b = vbslq_s32(horizontal, vld1q_s32(cur + x + 1), vbslq_s32(vertical, vld1q_s32(next + x), diagB));
+
+    const int32x4_t m = vld1q_s32(cur + x);
+    const uint32x4_t beatsB = vorrq_u32(vcgtq_s32(m, b), vandq_u32(vceqq_s32(m, b), vorrq_u32(horizontal, vertical)));
+    return vandq_u32(vandq_u32(vcgtq_s32(m, a), beatsB), vcgtq_s32(m, floor));
+}
+
+static void localMaxRowNeon(const int* prev, const int* cur, const int* next,
+                            const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask) {
+    // Lane masks are narrowed to bytes, ANDed with their bit weights and
+    // folded into one mask byte per 8 pixels by pairwise adds.
+    static const uint8_t kWeights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x8_t weights = vld1_u8(kWeights);
+    const int32x4_t limit = vdupq_n_s32(floor);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const int16x8_t gx = vld1q_s16(dx + x);
+        const int16x8_t gy = vld1q_s16(dy + x);
+        const uint32x4_t lo = localMax4Neon(prev, cur, next, vget_low_s16(gx), vget_low_s16(gy), x, limit);
+        const uint32x4_t hi = localMax4Neon(prev, cur, next, vget_high_s16(gx), vget_high_s16(gy), x + 4, limit);
+        const uint8x8_t on = vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+        uint8x8_t sum = vand_u8(on, weights);
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        mask[x / 8] = vget_lane_u8(sum, 0);
+    }
+    localMaxTail(prev, cur, next, dx, dy, x, width, floor, mask);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+__attribute__((target("sse4.1")))
+static inline __m128i load4(const int* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i load8(const int* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+// Bits 0-3: pixels x..x+3 that are maxima above the floor.
+__attribute__((target("sse4.1")))
+static inline int localMax4Sse41(const int* prev, const int* cur, const int* next,
+                                 __m128i gx, __m128i gy, int x, __m128i floor) {
+    const __m128i xs = _mm_abs_epi32(gx);
+    const __m128i tg22x = _mm_mullo_epi32(xs, _mm_set1_epi32(kTan22Q15));
+    const __m128i tg67x = _mm_add_epi32(tg22x, _mm_slli_epi32(xs, 16));
+    const __m128i yq = _mm_slli_epi32(_mm_abs_epi32(gy), 15);
+    const __m128i horizontal = _mm_cmpgt_epi32(tg22x, yq);
+    const __m128i vertical = _mm_cmpgt_epi32(yq, tg67x);
+    const __m128i negative = _mm_srai_epi32(_mm_xor_si128(gx, gy), 31);
+
+    const __m128i diagA = _mm_blendv_epi8(load4(prev + x - 1), load4(prev + x + 1), negative);
+    const __m128i diagB = _mm_blendv_epi8(load4(next + x + 1), load4(next + x - 1), negative);
+    const __m128i a = _mm_blendv_epi8(_mm_blendv_epi8(diagA, load4(prev + x), vertical), load4(cur + x - 1), horizontal);
+    const __m128i b = _mm_blendv_epi8(_mm_blendv_epi8(diagB, load4(next + x), vertical), load4(cur + x + 1), horizontal);
+
+    const __m128i m = load4(cur + x);
+    const __m128i beatsB = _mm_or_si128(_mm_cmpgt_epi32(m, b),
+                                        _mm_and_si128(_mm_cmpeq_epi32(m, b), _mm_or_si128(horizontal, vertical)));
+    const __m128i on = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(m, a), beatsB), _mm_cmpgt_epi32(m, floor));
+    return _mm_movemask_ps(_mm_castsi128_ps(on));
+}
+
+__attribute__((target("sse4.1")))
+static void localMaxRowSse41(const int* prev, const int* cur, const int* next,
+                             const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask) {
+    const __m128i limit = _mm_set1_epi32(floor);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i gx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dx + x));
+        const __m128i gy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dy + x));
+        const int lo = localMax4Sse41(prev, cur, next, _mm_cvtepi16_epi32(gx), _mm_cvtepi16_epi32(gy), x, limit);
+        const int hi = localMax4Sse41(prev, cur, next, _mm_cvtepi16_epi32(_mm_srli_si128(gx, 8)),
+                                      _mm_cvtepi16_epi32(_mm_srli_si128(gy, 8)), x + 4, limit);
+        mask[x / 8] = static_cast<uint8_t>(lo | (hi << 4));
+    }
+    localMaxTail(prev, cur, next, dx, dy, x, width, floor, mask);
+}
+
+__attribute__((target("avx2")))
+static void localMaxRowAvx2(const int* prev, const int* cur, const int* next,
+                            const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask) {
+    const __m256i limit = _mm256_set1_epi32(floor);
+    const __m256i tan22 = _mm256_set1_epi32(kTan22Q15);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i gx = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dx + x)));
+        const __m256i gy = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dy + x)));
+        const __m256i xs = _mm256_abs_epi32(gx);
+        const __m256i tg22x = _mm256_mullo_epi32(xs, tan22);
+        const __m256i tg67x = _mm256_add_epi32(tg22x, _mm256_slli_epi32(xs, 16));
+        const __m256i yq = _mm256_slli_epi32(_mm256_abs_epi32(gy), 15);
+        const __m256i horizontal = _mm256_cmpgt_epi32(tg22x, yq);
+        const __m256i vertical = _mm256_cmpgt_epi32(yq, tg67x);
+        const __m256i negative = _mm256_srai_epi32(_mm256_xor_si256(gx, gy), 31);
+
+        const __m256i diagA = _mm256_blendv_epi8(load8(prev + x - 1), load8(prev + x + 1), negative);
+        const __m256i diagB = _mm256_blendv_epi8(load8(next + x + 1), load8(next + x - 1), negative);
+        const __m256i a = _mm256_blendv_epi8(_mm256_blendv_epi8(diagA, load8(prev + x), vertical), load8(cur + x - 1), horizontal);
+        const __m256i b = _mm256_blendv_epi8(_mm256_blendv_epi8(diagB, load8(next + x), vertical), load8(cur + x + 1), horizontal);
+
+        const __m256i m = load8(cur + x);
+        const __m256i beatsB = _mm256_or_si256(_mm256_cmpgt_epi32(m, b),
+                                               _mm256_and_si256(_mm256_cmpeq_epi32(m, b), _mm256_or_si256(horizontal, vertical)));
+        const __m256i on = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(m, a), beatsB), _mm256_cmpgt_epi32(m, limit));
+        mask[x / 8] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(on)));
+    }
+    _mm256_zeroupper(); // the scalar tail may run SSE code
+    localMaxTail(prev, cur, next, dx, dy, x, width, floor, mask);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static LocalMaxRowKernel selectLocalMaxRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return localMaxRowNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return localMaxRowAvx2;
+    if (cpu.sse41) return localMaxRowSse41;
+#endif
+    (void)cpu;
+    return localMaxRowScalar;
+}
+
+LocalMaxRowKernel localMaxRowKernel() {
+    static const LocalMaxRowKernel kernel = selectLocalMaxRowKernel();
+    return kernel;
+}
+
+} // namespace edgeviewer
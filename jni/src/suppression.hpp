@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace edgeviewer {
+
+// Non-maximum suppression of one row of gradient magnitudes, as in
+// cv::Canny: the gradient direction is quantized to 0, 45, 90 or 135 degrees
+// (tan 22.5 in Q15) and cur[x] must beat its two neighbours along it
+// (strictly on the far side of horizontal and vertical, both sides on the
+// diagonals). prev/cur/next are the magnitude rows above, at and below, each
+// with a readable sample at [-1] and [width]; dx/dy are the Sobel gradients
+// of the row. Writes bit x of `mask` (edge_mask.hpp packed layout,
+// packedMaskStride(width) bytes, padding cleared) where cur[x] > floor and
+// cur[x] is such a maximum.
+using LocalMaxRowKernel = void (*)(const int* prev, const int* cur, const int* next,
+                                   const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void localMaxRowScalar(const int* prev, const int* cur, const int* next,
+                       const int16_t* dx, const int16_t* dy, int width, int floor, uint8_t* mask);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+LocalMaxRowKernel localMaxRowKernel();
+
+} // namespace edgeviewer
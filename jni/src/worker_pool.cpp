@@ -0,0 +1,302 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+namespace edgeviewer {
+
+namespace {
+    // Deque entries; a loop needs about log2(count) per thread and nesting
+    // level, and a full deque only stops further splitting.
+    constexpr int kDequeCapacity = 128;
+
+    // Rounds of stealing an idle thread tries before it sleeps.
+    constexpr int kSpinRounds = 32;
+
+    // The pool the current thread works for and its deque there, so a task
+    // that starts a loop pushes to its own deque.
+    thread_local const WorkerPool* t_pool = nullptr;
+    thread_local int t_index = -1;
+    thread_local uint32_t t_random = 0;
+
+    std::mutex g_sharedMutex;
+    std::shared_ptr<WorkerPool> g_sharedPool;
+    int g_sharedThreads = 0;
+}
+
+static int resolveThreadCount(int threads) {
+    if (threads > 0) return threads;
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+// xorshift32, seeded per thread, for picking steal victims.
+static uint32_t nextRandom() {
+    if (t_random == 0) t_random = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+    t_random ^= t_random << 13;
+    t_random ^= t_random >> 17;
+    t_random ^= t_random << 5;
+    return t_random;
+}
+
+// A ring of tasks: the owner pushes and pops at the back, thieves take from
+// the front. Each has its own lock and cache line; locks are held for a few
+// instructions and are mostly uncontended.
+struct alignas(64) WorkerPool::TaskDeque {
+    std::mutex mutex;
+    Task tasks[kDequeCapacity];
+    int front = 0;
+    int size = 0;
+
+    Task& at(int i) { return tasks[(front + i) % kDequeCapacity]; }
+};
+
+WorkerPool::WorkerPool(int threads) {
+    const int total = resolveThreadCount(threads);
+    for (int i = 0; i < total; ++i) deques_.emplace_back(new TaskDeque());
+    workers_.reserve(static_cast<size_t>(total - 1));
+    for (int i = 0; i + 1 < total; ++i) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_.store(true);
+    }
+    wake_.notify_all();
+    for (std::thread& t : workers_) t.join();
+}
+
+FrameArena& WorkerPool::threadScratch() {
+    thread_local FrameArena scratch;
+    return scratch;
+}
+
+WorkerPool::TaskDeque& WorkerPool::ownDeque() {
+    return (t_pool == this) ? *deques_[static_cast<size_t>(t_index)] : *deques_.back();
+}
+
+bool WorkerPool::push(const Task& task) {
+    TaskDeque& deque = ownDeque();
+    {
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.size == kDequeCapacity) return false;
+        deque.at(deque.size++) = task;
+    }
+    signal();
+    return true;
+}
+
+bool WorkerPool::popOwn(Task& task) {
+    TaskDeque& deque = ownDeque();
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    if (deque.size == 0) return false;
+    task = deque.at(--deque.size);
+    return true;
+}
+
+bool WorkerPool::steal(Task& task) {
+    const size_t count = deques_.size();
+    const size_t start = nextRandom() % count;
+    for (size_t i = 0; i < count; ++i) {
+        TaskDeque& victim = *deques_[(start + i) % count];
+        if (&victim == &ownDeque()) continue;
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.size == 0) continue;
+        task = victim.at(0);
+        victim.front = (victim.front + 1) % kDequeCapacity;
+        --victim.size;
+        return true;
+    }
+    return false;
+}
+
+// The newest task of `group` in the caller's own deque, else the oldest one
+// in any other deque. Tasks of other groups are left where they are.
+bool WorkerPool::takeFromGroup(const TaskGroup& group, Task& task) {
+    TaskDeque& own = ownDeque();
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (int i = own.size; i-- > 0;) {
+            if (own.at(i).group != &group) continue;
+            task = own.at(i);
+            for (int k = i; k + 1 < own.size; ++k) own.at(k) = own.at(k + 1);
+            --own.size;
+            return true;
+        }
+    }
+    const size_t count = deques_.size();
+    const size_t start = nextRandom() % count;
+    for (size_t v = 0; v < count; ++v) {
+        TaskDeque& victim = *deques_[(start + v) % count];
+        if (&victim == &own) continue;
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        for (int i = 0; i < victim.size; ++i) {
+            if (victim.at(i).group != &group) continue;
+            task = victim.at(i);
+            for (int k = i; k > 0; --k) victim.at(k) = victim.at(k - 1);
+            victim.front = (victim.front + 1) % kDequeCapacity;
+            --victim.size;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Splits off upper halves for other threads until the range is at most a
+// grain, runs what is left, and marks it done in its group.
+void WorkerPool::execute(Task task) {
+    while (task.end - task.begin > task.grain) {
+        Task upper = task;
+        upper.begin = task.begin + (task.end - task.begin) / 2;
+        task.group->pending_.fetch_add(1, std::memory_order_relaxed);
+        if (!push(upper)) {
+            task.group->pending_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+        task.end = upper.begin;
+    }
+    task.run(task.body, task.begin, task.end);
+    if (task.group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) signal();
+}
+
+void WorkerPool::spawn(TaskGroup& group, RunRange run, const void* body, int64_t begin, int64_t end, int64_t grain) {
+    if (begin >= end) return;
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    const Task task{run, body, begin, end, std::max<int64_t>(grain, 1), &group};
+    // No room to queue it: run it now rather than lose it.
+    if (!push(task)) execute(task);
+}
+
+// A loop: the caller starts on the whole range itself, then waits.
+void WorkerPool::runRange(RunRange run, const void* body, int64_t begin, int64_t end, int64_t grain) {
+    if (begin >= end) return;
+    if (workers_.empty() || end - begin <= grain) {
+        for (int64_t i = begin; i < end; i += grain) run(body, i, std::min(i + grain, end));
+        return;
+    }
+    TaskGroup group(*this);
+    group.pending_.store(1, std::memory_order_relaxed);
+    execute(Task{run, body, begin, end, std::max<int64_t>(grain, 1), &group});
+}
+
+void WorkerPool::wait(TaskGroup& group) {
+    int idle = 0;
+    while (group.pending_.load(std::memory_order_acquire) != 0) {
+        Task task;
+        if (takeFromGroup(group, task)) {
+            execute(task);
+            idle = 0;
+            continue;
+        }
+        // The rest is running elsewhere: spin a little, then sleep until a
+        // push or a finished group changes the epoch.
+        if (++idle < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+        const uint64_t seen = epoch_.load();
+        if (group.pending_.load(std::memory_order_acquire) == 0 || takeFromGroup(group, task)) {
+            if (group.pending_.load(std::memory_order_acquire) != 0) execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        wake_.wait(lock, [&] { return epoch_.load() != seen; });
+        sleepers_.fetch_sub(1);
+    }
+}
+
+// Wakes sleepers after new work or a finished group. Sleepers check the
+// epoch under sleepMutex_ before waiting, so taking it here closes the gap
+// between their check and their wait.
+void WorkerPool::signal() {
+    epoch_.fetch_add(1);
+    if (sleepers_.load() == 0) return;
+    { std::lock_guard<std::mutex> lock(sleepMutex_); }
+    wake_.notify_all();
+}
+
+void WorkerPool::workerLoop(int index) {
+    t_pool = this;
+    t_index = index;
+    int idle = 0;
+    for (;;) {
+        Task task;
+        if (popOwn(task) || steal(task)) {
+            execute(task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < kSpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+        const uint64_t seen = epoch_.load();
+        if (popOwn(task) || steal(task)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        if (stop_.load()) return;
+        sleepers_.fetch_add(1);
+        wake_.wait(lock, [&] { return stop_.load() || epoch_.load() != seen; });
+        sleepers_.fetch_sub(1);
+        if (stop_.load()) return;
+    }
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& body) {
+    const RunRange run = [](const void* loop, int64_t begin, int64_t end) {
+        const std::function<void(int)>& f = *static_cast<const std::function<void(int)>*>(loop);
+        for (int64_t i = begin; i < end; ++i) f(static_cast<int>(i));
+    };
+    runRange(run, &body, 0, count, 1);
+}
+
+void WorkerPool::parallelForRows(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+    const RunRange run = [](const void* loop, int64_t y0, int64_t y1) {
+        (*static_cast<const std::function<void(int, int)>*>(loop))(static_cast<int>(y0), static_cast<int>(y1));
+    };
+    runRange(run, &body, begin, end, std::max(grain, 1));
+}
+
+void WorkerPool::parallelForTiles(int width, int height, int tileWidth, int tileHeight,
+                                  const std::function<void(const PoolTile&)>& body) {
+    if (width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0) return;
+    struct Tiles {
+        const std::function<void(const PoolTile&)>& body;
+        int width;
+        int height;
+        int tileWidth;
+        int tileHeight;
+        int tilesX;
+    };
+    const Tiles tiles{body, width, height, tileWidth, tileHeight, (width + tileWidth - 1) / tileWidth};
+    const int tilesY = (height + tileHeight - 1) / tileHeight;
+    const RunRange run = [](const void* loop, int64_t begin, int64_t end) {
+        const Tiles& t = *static_cast<const Tiles*>(loop);
+        for (int64_t i = begin; i < end; ++i) {
+            const int x = static_cast<int>(i % t.tilesX) * t.tileWidth;
+            const int y = static_cast<int>(i / t.tilesX) * t.tileHeight;
+            t.body(PoolTile{x, y, std::min(t.tileWidth, t.width - x), std::min(t.tileHeight, t.height - y)});
+        }
+    };
+    runRange(run, &tiles, 0, static_cast<int64_t>(tiles.tilesX) * tilesY, 1);
+}
+
+std::shared_ptr<WorkerPool> sharedWorkerPool() {
+    std::lock_guard<std::mutex> lock(g_sharedMutex);
+    if (!g_sharedPool) g_sharedPool = std::make_shared<WorkerPool>(g_sharedThreads);
+    return g_sharedPool;
+}
+
+void setSharedWorkerThreads(int threads) {
+    std::lock_guard<std::mutex> lock(g_sharedMutex);
+    g_sharedThreads = threads;
+    if (g_sharedPool && g_sharedPool->threadCount() == resolveThreadCount(threads)) return;
+    g_sharedPool.reset();
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "frame_arena.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace edgeviewer {
+
+class TaskGroup;
+
+// One tile of WorkerPool::parallelForTiles, clipped to the image.
+struct PoolTile {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Work-stealing pool shared by every parallel stage. Each worker owns a
+// deque of range tasks: it takes the newest from its own end, and an idle
+// worker steals the oldest (largest) from a randomly chosen victim. A
+// range task splits itself in halves when it starts, pushing the upper
+// halves for thieves, so a loop spreads out in log2(count) steps and a core
+// that falls behind gets its work taken over.
+//
+// The calling thread always takes part, so a pool of N threads owns N - 1
+// workers. A thread waiting for a loop or TaskGroup runs that group's own
+// tasks meanwhile, never unrelated ones: nested loops run in parallel
+// without deadlock, and a task never finds the thread's thread_local state
+// (a per-thread pipeline, threadScratch()) half-used by an outer task.
+//
+// Loops and groups allocate nothing; bodies are borrowed, not copied, and
+// must not throw.
+class WorkerPool {
+public:
+    // threads <= 0 picks std::thread::hardware_concurrency().
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int threadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Runs body(i) for every i in [0, count) and returns once all calls have
+    // finished. May be called from inside a body or from several threads.
+    void parallelFor(int count, const std::function<void(int)>& body);
+
+    // Runs body(y0, y1) over [begin, end) split into ranges of at most
+    // `grain` rows (about half that, or more).
+    void parallelForRows(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+    // Runs body(tile) for each tileWidth x tileHeight tile of a width x
+    // height image, the last ones in each direction clipped.
+    void parallelForTiles(int width, int height, int tileWidth, int tileHeight,
+                          const std::function<void(const PoolTile&)>& body);
+
+    // Scratch memory private to the calling thread, for buffers a task needs
+    // only while it runs. Take it under a FrameArena::Scope: a thread may
+    // run other tasks of a group it waits for, and scopes keep their
+    // allocations nested.
+    static FrameArena& threadScratch();
+
+private:
+    friend class TaskGroup;
+
+    using RunRange = void (*)(const void* body, int64_t begin, int64_t end);
+
+    // Run body over [begin, end), splitting down to `grain`; counted in
+    // `group` until it is done.
+    struct Task {
+        RunRange run;
+        const void* body;
+        int64_t begin;
+        int64_t end;
+        int64_t grain;
+        TaskGroup* group;
+    };
+
+    struct TaskDeque;
+
+    TaskDeque& ownDeque();
+    bool push(const Task& task);
+    bool popOwn(Task& task);
+    bool steal(Task& task);
+    bool takeFromGroup(const TaskGroup& group, Task& task);
+    void execute(Task task);
+    void spawn(TaskGroup& group, RunRange run, const void* body, int64_t begin, int64_t end, int64_t grain);
+    void runRange(RunRange run, const void* body, int64_t begin, int64_t end, int64_t grain);
+    void wait(TaskGroup& group);
+    void signal();
+    void workerLoop(int index);
+
+    std::vector<std::thread> workers_;
+    // One per worker, then one shared by every other thread using the pool.
+    std::vector<std::unique_ptr<TaskDeque>> deques_;
+
+    // Bumped by every push and every finished group; sleepers wait for it to
+    // change.
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<int> sleepers_{0};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stop_{false};
+};
+
+// Tasks that finish together: run() hands a task to the pool and wait()
+// returns once every task run so far has finished, running some of them on
+// the calling thread meanwhile. The destructor waits, so a group is scoped.
+// Tasks may run further loops and groups of their own.
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkerPool& pool) : pool_(pool) {}
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // Queues task(). The callable is borrowed and must outlive wait().
+    template <typename F>
+    void run(const F& task) {
+        pool_.spawn(*this, &invoke<F>, &task, 0, 1, 1);
+    }
+    template <typename F>
+    void run(const F&& task) = delete;
+
+    void wait() { pool_.wait(*this); }
+
+private:
+    friend class WorkerPool;
+
+    template <typename F>
+    static void invoke(const void* task, int64_t, int64_t) {
+        (*static_cast<const F*>(task))();
+    }
+
+    WorkerPool& pool_;
+    std::atomic<int64_t> pending_{0}; // tasks and split-off ranges not done
+};
+
+// Process-wide pool used by the pipeline entry points.
+std::shared_ptr<WorkerPool> sharedWorkerPool();
+
+// Resizes the shared pool; threads <= 0 means one per hardware thread and 1
+// runs everything on the calling thread. Loops already running keep the pool
+// they started on.
+void setSharedWorkerThreads(int threads);
+
+} // namespace edgeviewer
@@ -0,0 +1,231 @@
+#include "yuv_convert.hpp"
+
+#include "cpu_features.hpp"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define EDGEVIEWER_HAVE_NEON 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define EDGEVIEWER_HAVE_X86_SIMD 1
+#endif
+
+// All paths compute in 32-bit integers (the widest intermediate is about
+// 1192 * 239 + 2066 * 127 < 2^20) and use an arithmetic shift, so the SIMD
+// kernels are bit-exact with the scalar loop.
+
+namespace edgeviewer {
+
+namespace {
+    constexpr int kYScale = 1192;
+    constexpr int kVToR = 1634;
+    constexpr int kVToG = 833;
+    constexpr int kUToG = 400;
+    constexpr int kUToB = 2066;
+    constexpr int kShift = 10;
+}
+
+static inline uint8_t clampToByte(int v) {
+    return static_cast<uint8_t>(std::min(std::max(v, 0), 255));
+}
+
+void yuvRowToRgbaScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width) {
+    for (int x = 0; x < width; ++x) {
+        const int yf = kYScale * std::max(y[x] - 16, 0);
+        const int uf = u[x >> 1] - 128;
+        const int vf = v[x >> 1] - 128;
+        rgba[0] = clampToByte((yf + kVToR * vf) >> kShift);
+        rgba[1] = clampToByte((yf - kVToG * vf - kUToG * uf) >> kShift);
+        rgba[2] = clampToByte((yf + kUToB * uf) >> kShift);
+        rgba[3] = 255;
+        rgba += 4;
+    }
+}
+
+#ifdef EDGEVIEWER_HAVE_NEON
+
+// R, G, B for eight pixels: luma, duplicated chroma already widened to s16.
+static inline void yuvNeon8(int16x8_t yf, int16x8_t uf, int16x8_t vf,
+                            uint8x8_t& r, uint8x8_t& g, uint8x8_t& b) {
+    const int32x4_t yLo = vmull_n_s16(vget_low_s16(yf), kYScale);
+    const int32x4_t yHi = vmull_n_s16(vget_high_s16(yf), kYScale);
+
+    int32x4_t rLo = vmlal_n_s16(yLo, vget_low_s16(vf), kVToR);
+    int32x4_t rHi = vmlal_n_s16(yHi, vget_high_s16(vf), kVToR);
+    int32x4_t gLo = vmlsl_n_s16(vmlsl_n_s16(yLo, vget_low_s16(vf), kVToG), vget_low_s16(uf), kUToG);
+    int32x4_t gHi = vmlsl_n_s16(vmlsl_n_s16(yHi, vget_high_s16(vf), kVToG), vget_high_s16(uf), kUToG);
+    int32x4_t bLo = vmlal_n_s16(yLo, vget_low_s16(uf), kUToB);
+    int32x4_t bHi = vmlal_n_s16(yHi, vget_high_s16(uf), kUToB);
+
+    r = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(rLo, kShift)), vqmovn_s32(vshrq_n_s32(rHi, kShift))));
+    g = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(gLo, kShift)), vqmovn_s32(vshrq_n_s32(gHi, kShift))));
+    b = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(bLo, kShift)), vqmovn_s32(vshrq_n_s32(bHi, kShift))));
+}
+
+static void yuvRowToRgbaNeon(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width) {
+    int x = 0;
+    const int16x8_t bias = vdupq_n_s16(128);
+    for (; x + 16 <= width; x += 16) {
+        // max(Y - 16, 0) is a saturating byte subtract.
+        const uint8x16_t yq = vqsubq_u8(vld1q_u8(y + x), vdupq_n_u8(16));
+        const uint8x8x2_t uu = vzip_u8(vld1_u8(u + x / 2), vld1_u8(u + x / 2));
+        const uint8x8x2_t vv = vzip_u8(vld1_u8(v + x / 2), vld1_u8(v + x / 2));
+
+        uint8x16x4_t px;
+        uint8x8_t r0, g0, b0, r1, g1, b1;
+        yuvNeon8(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yq))),
+                 vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uu.val[0])), bias),
+                 vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[0])), bias), r0, g0, b0);
+        yuvNeon8(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yq))),
+                 vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uu.val[1])), bias),
+                 vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[1])), bias), r1, g1, b1);
+        px.val[0] = vcombine_u8(r0, r1);
+        px.val[1] = vcombine_u8(g0, g1);
+        px.val[2] = vcombine_u8(b0, b1);
+        px.val[3] = vdupq_n_u8(255);
+        vst4q_u8(rgba + x * 4, px);
+    }
+    yuvRowToRgbaScalar(y + x, u + x / 2, v + x / 2, rgba + x * 4, width - x);
+}
+
+#endif // EDGEVIEWER_HAVE_NEON
+
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+
+// Interleaves 16 R, G, B bytes with opaque alpha and stores 64 RGBA bytes.
+__attribute__((target("sse4.1")))
+static inline void storeRgba16(uint8_t* dst, __m128i r, __m128i g, __m128i b) {
+    const __m128i a = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i rgLo = _mm_unpacklo_epi8(r, g), rgHi = _mm_unpackhi_epi8(r, g);
+    const __m128i baLo = _mm_unpacklo_epi8(b, a), baHi = _mm_unpackhi_epi8(b, a);
+    __m128i* out = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+}
+
+// R, G, B (int32) for four pixels from widened luma and chroma.
+__attribute__((target("sse4.1")))
+static inline void yuvSse4(__m128i y, __m128i u, __m128i v, __m128i& r, __m128i& g, __m128i& b) {
+    const __m128i yf = _mm_mullo_epi32(_mm_max_epi32(_mm_sub_epi32(y, _mm_set1_epi32(16)), _mm_setzero_si128()),
+                                       _mm_set1_epi32(kYScale));
+    const __m128i uf = _mm_sub_epi32(u, _mm_set1_epi32(128));
+    const __m128i vf = _mm_sub_epi32(v, _mm_set1_epi32(128));
+    r = _mm_srai_epi32(_mm_add_epi32(yf, _mm_mullo_epi32(vf, _mm_set1_epi32(kVToR))), kShift);
+    g = _mm_srai_epi32(_mm_sub_epi32(_mm_sub_epi32(yf, _mm_mullo_epi32(vf, _mm_set1_epi32(kVToG))),
+                                     _mm_mullo_epi32(uf, _mm_set1_epi32(kUToG))), kShift);
+    b = _mm_srai_epi32(_mm_add_epi32(yf, _mm_mullo_epi32(uf, _mm_set1_epi32(kUToB))), kShift);
+}
+
+// Pixels 4k..4k+3 of a 16-pixel block; ud holds chroma already duplicated per pixel.
+template <int K>
+__attribute__((target("sse4.1")))
+static inline void yuvSseQuad(__m128i y, __m128i ud, __m128i vd, __m128i& r, __m128i& g, __m128i& b) {
+    yuvSse4(_mm_cvtepu8_epi32(_mm_srli_si128(y, 4 * K)),
+            _mm_cvtepu8_epi32(_mm_srli_si128(ud, 4 * K)),
+            _mm_cvtepu8_epi32(_mm_srli_si128(vd, 4 * K)), r, g, b);
+}
+
+__attribute__((target("sse4.1")))
+static void yuvRowToRgbaSse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        const __m128i uh = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2));
+        const __m128i vh = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2));
+        const __m128i ud = _mm_unpacklo_epi8(uh, uh);
+        const __m128i vd = _mm_unpacklo_epi8(vh, vh);
+
+        __m128i r0, g0, b0, r1, g1, b1, r2, g2, b2, r3, g3, b3;
+        yuvSseQuad<0>(yv, ud, vd, r0, g0, b0);
+        yuvSseQuad<1>(yv, ud, vd, r1, g1, b1);
+        yuvSseQuad<2>(yv, ud, vd, r2, g2, b2);
+        yuvSseQuad<3>(yv, ud, vd, r3, g3, b3);
+        // Signed then unsigned saturation clamps to [0, 255].
+        storeRgba16(rgba + x * 4,
+                    _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)),
+                    _mm_packus_epi16(_mm_packs_epi32(g0, g1), _mm_packs_epi32(g2, g3)),
+                    _mm_packus_epi16(_mm_packs_epi32(b0, b1), _mm_packs_epi32(b2, b3)));
+    }
+    yuvRowToRgbaScalar(y + x, u + x / 2, v + x / 2, rgba + x * 4, width - x);
+}
+
+// R, G, B (int32) for eight pixels.
+__attribute__((target("avx2")))
+static inline void yuvAvx8(__m256i y, __m256i u, __m256i v, __m256i& r, __m256i& g, __m256i& b) {
+    const __m256i yf = _mm256_mullo_epi32(_mm256_max_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(16)), _mm256_setzero_si256()),
+                                          _mm256_set1_epi32(kYScale));
+    const __m256i uf = _mm256_sub_epi32(u, _mm256_set1_epi32(128));
+    const __m256i vf = _mm256_sub_epi32(v, _mm256_set1_epi32(128));
+    r = _mm256_srai_epi32(_mm256_add_epi32(yf, _mm256_mullo_epi32(vf, _mm256_set1_epi32(kVToR))), kShift);
+    g = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_sub_epi32(yf, _mm256_mullo_epi32(vf, _mm256_set1_epi32(kVToG))),
+                                           _mm256_mullo_epi32(uf, _mm256_set1_epi32(kUToG))), kShift);
+    b = _mm256_srai_epi32(_mm256_add_epi32(yf, _mm256_mullo_epi32(uf, _mm256_set1_epi32(kUToB))), kShift);
+}
+
+// Saturates two vectors of eight int32 (pixels 0-7, 8-15) to 16 bytes in order.
+__attribute__((target("avx2")))
+static inline __m128i packAvx16(__m256i lo, __m256i hi) {
+    const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+}
+
+__attribute__((target("avx2")))
+static void yuvRowToRgbaAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i yv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        const __m128i uh = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2));
+        const __m128i vh = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2));
+        const __m128i ud = _mm_unpacklo_epi8(uh, uh);
+        const __m128i vd = _mm_unpacklo_epi8(vh, vh);
+
+        __m256i r0, g0, b0, r1, g1, b1;
+        yuvAvx8(_mm256_cvtepu8_epi32(yv), _mm256_cvtepu8_epi32(ud), _mm256_cvtepu8_epi32(vd), r0, g0, b0);
+        yuvAvx8(_mm256_cvtepu8_epi32(_mm_srli_si128(yv, 8)), _mm256_cvtepu8_epi32(_mm_srli_si128(ud, 8)),
+                _mm256_cvtepu8_epi32(_mm_srli_si128(vd, 8)), r1, g1, b1);
+        storeRgba16(rgba + x * 4, packAvx16(r0, r1), packAvx16(g0, g1), packAvx16(b0, b1));
+    }
+    yuvRowToRgbaScalar(y + x, u + x / 2, v + x / 2, rgba + x * 4, width - x);
+}
+
+#endif // EDGEVIEWER_HAVE_X86_SIMD
+
+static YuvRowKernel selectYuvRowKernel() {
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) return yuvRowToRgbaNeon;
+#endif
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.avx2) return yuvRowToRgbaAvx2;
+    if (cpu.sse41) return yuvRowToRgbaSse41;
+#endif
+    (void)cpu;
+    return yuvRowToRgbaScalar;
+}
+
+YuvRowKernel yuvRowKernel() {
+    static const YuvRowKernel kernel = selectYuvRowKernel();
+    return kernel;
+}
+
+std::vector<IsaKernel<YuvRowKernel>> yuvRowKernels() {
+    std::vector<IsaKernel<YuvRowKernel>> kernels{{"scalar", yuvRowToRgbaScalar}};
+    const CpuFeatures& cpu = cpuFeatures();
+#ifdef EDGEVIEWER_HAVE_X86_SIMD
+    if (cpu.sse41) kernels.push_back({"sse4.1", yuvRowToRgbaSse41});
+    if (cpu.avx2) kernels.push_back({"avx2", yuvRowToRgbaAvx2});
+#endif
+#ifdef EDGEVIEWER_HAVE_NEON
+    if (cpu.neon) kernels.push_back({"neon", yuvRowToRgbaNeon});
+#endif
+    (void)cpu;
+    return kernels;
+}
+
+} // namespace edgeviewer
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "cpu_features.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer {
+
+// Converts one row of 4:2:0 video-range YUV to RGBA (alpha = 255) with the
+// BT.601 fixed-point coefficients the app has always used:
+//   R = (1192 (Y-16) + 1634 (V-128)) >> 10
+//   G = (1192 (Y-16) -  833 (V-128) - 400 (U-128)) >> 10
+//   B = (1192 (Y-16) + 2066 (U-128)) >> 10
+// with Y-16 clamped at 0 and every channel clamped to [0, 255]. `y` holds
+// `width` packed samples; `u` and `v` hold (width + 1) / 2 packed samples,
+// each shared by two horizontally adjacent pixels.
+using YuvRowKernel = void (*)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width);
+
+// Portable reference implementation. Every SIMD kernel is bit-exact with it.
+void yuvRowToRgbaScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgba, int width);
+
+// Fastest kernel for the running CPU (NEON, AVX2 or SSE4.1), falling back to
+// the scalar reference. Resolved once; safe to call from any thread.
+YuvRowKernel yuvRowKernel();
+
+// Every kernel the running CPU supports, scalar first and the one
+// yuvRowKernel() returns last.
+std::vector<IsaKernel<YuvRowKernel>> yuvRowKernels();
+
+} // namespace edgeviewer
@@ -0,0 +1,184 @@
+// Edge mask layouts: packing and unpacking round-trip at every width around
+// the 64-bit word size, and unpacking ignores padding bits a caller left set
+// without touching any byte past the output. The Points and Runs encoders,
+// and the Canny entry points that produce them, decode back to the byte
+// mask, and a short buffer reports the size it needed.
+#include "edge_mask.hpp"
+#include "opencv_pipeline.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr uint8_t kCanary = 0xA5;
+constexpr size_t kGuard = 256;
+
+// A random 0/1-valued byte mask, about a third edges.
+std::vector<uint8_t> randomMask(int width, int height, uint32_t seed) {
+    std::vector<uint8_t> mask = test::randomBytes(static_cast<size_t>(width) * height, seed);
+    for (uint8_t& m : mask) m = (m < 85) ? 1 : 0;
+    return mask;
+}
+
+void checkPackedRoundTrip() {
+    uint32_t seed = 1;
+    for (int width = 1; width <= 200; ++width) {
+        for (int height : {1, 2, 5}) {
+            const std::vector<uint8_t> mask = randomMask(width, height, seed++);
+            const size_t stride = packedMaskStride(width);
+            std::vector<uint8_t> packed(stride * height);
+            size_t written = 0;
+            CHECK(packEdgeMask(PlaneView{mask.data(), width, height, width, 1}, packed.data(), packed.size(), written) &&
+                      written == packed.size(),
+                  "width %d height %d: pack failed", width, height);
+
+            // Set every padding bit, as a careless producer might.
+            for (int y = 0; y < height; ++y) {
+                for (size_t x = static_cast<size_t>(width); x < stride * 8; ++x) {
+                    packed[y * stride + x / 8] |= static_cast<uint8_t>(1u << (x % 8));
+                }
+            }
+
+            const size_t bytes = static_cast<size_t>(width) * height;
+            std::vector<uint8_t> out(bytes + kGuard, kCanary);
+            CHECK(unpackEdgeMask(packed.data(), width, height, out.data(), bytes, written) && written == bytes,
+                  "width %d height %d: unpack failed", width, height);
+            bool same = true;
+            for (size_t i = 0; i < bytes; ++i) same &= out[i] == (mask[i] ? 255 : 0);
+            CHECK(same, "width %d height %d: round trip differs", width, height);
+            bool guardIntact = true;
+            for (size_t i = bytes; i < out.size(); ++i) guardIntact &= out[i] == kCanary;
+            CHECK(guardIntact, "width %d height %d: unpack wrote past the buffer", width, height);
+        }
+    }
+}
+
+// Byte mask (0/255) of a Points result.
+std::vector<uint8_t> decodePoints(const uint8_t* data, size_t bytes, int width, int height) {
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height, 0);
+    std::vector<EdgePoint> points(bytes / sizeof(EdgePoint));
+    if (!points.empty()) std::memcpy(points.data(), data, points.size() * sizeof(EdgePoint));
+    int64_t previous = -1;
+    for (const EdgePoint& p : points) {
+        const int64_t at = static_cast<int64_t>(p.y) * width + p.x;
+        CHECK(p.x < width && p.y < height && at > previous, "point (%d, %d) out of range or order", p.x, p.y);
+        if (p.x >= width || p.y >= height) continue;
+        mask[static_cast<size_t>(at)] = 255;
+        previous = at;
+    }
+    return mask;
+}
+
+// Byte mask (0/255) of a Runs result.
+std::vector<uint8_t> decodeRuns(const uint8_t* data, size_t bytes, int width, int height) {
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height, 0);
+    const size_t headerBytes = (static_cast<size_t>(height) + 1) * sizeof(uint32_t);
+    CHECK(bytes >= headerBytes, "runs: %zu bytes, header alone is %zu", bytes, headerBytes);
+    if (bytes < headerBytes) return mask;
+    std::vector<uint32_t> rowStart(static_cast<size_t>(height) + 1);
+    std::memcpy(rowStart.data(), data, headerBytes);
+    CHECK(rowStart[0] == 0 && bytes == headerBytes + rowStart[height] * sizeof(EdgeRun),
+          "runs: header does not match the size");
+    std::vector<EdgeRun> runs(rowStart[height]);
+    if (!runs.empty()) std::memcpy(runs.data(), data + headerBytes, runs.size() * sizeof(EdgeRun));
+    for (int y = 0; y < height; ++y) {
+        int end = -1; // runs are separated by at least one pixel
+        for (uint32_t r = rowStart[y]; r < rowStart[y + 1] && r < runs.size(); ++r) {
+            const EdgeRun& run = runs[r];
+            CHECK(run.length > 0 && run.x > end && run.x + run.length <= width, "row %d: bad run at %d", y, run.x);
+            for (int x = run.x; x < std::min(run.x + run.length, width); ++x) mask[static_cast<size_t>(y) * width + x] = 255;
+            end = run.x + run.length;
+        }
+    }
+    return mask;
+}
+
+// appendSparseRow + writeSparseEdges against random packed rows.
+void checkSparseEncoders() {
+    uint32_t seed = 1000;
+    for (int width : {1, 7, 63, 64, 65, 127, 129, 201}) {
+        const int height = 5;
+        std::vector<uint8_t> mask = randomMask(width, height, seed++);
+        // Full rows and a run at the right border, where runs close late.
+        std::memset(mask.data() + width, 1, static_cast<size_t>(width));
+        mask[static_cast<size_t>(3) * width + width - 1] = 1;
+        std::vector<uint8_t> expected(mask.size());
+        for (size_t i = 0; i < mask.size(); ++i) expected[i] = mask[i] ? 255 : 0;
+
+        const size_t stride = packedMaskStride(width);
+        std::vector<uint8_t> packed(stride * height);
+        size_t written = 0;
+        packEdgeMask(PlaneView{mask.data(), width, height, width, 1}, packed.data(), packed.size(), written);
+        for (EdgeMaskFormat format : {EdgeMaskFormat::Points, EdgeMaskFormat::Runs}) {
+            SparseEdges edges;
+            edges.clear(format);
+            for (int y = 0; y < height; ++y) appendSparseRow(packed.data() + y * stride, width, y, format, edges);
+            const size_t bytes = sparseEdgeBytes(edges, format);
+            CHECK(bytes <= maxSparseEdgeBytes(width, height, format), "width %d: over the worst case", width);
+            std::vector<uint8_t> out(bytes);
+            writeSparseEdges(edges, format, out.data());
+            const std::vector<uint8_t> decoded = format == EdgeMaskFormat::Points
+                                                     ? decodePoints(out.data(), bytes, width, height)
+                                                     : decodeRuns(out.data(), bytes, width, height);
+            CHECK(decoded == expected, "width %d format %d: decodes to another mask", width, static_cast<int>(format));
+        }
+    }
+}
+
+// processLumaEdges in Points and Runs against its Bytes result, and the
+// size protocol for a buffer that is too small.
+void checkSparseEntryPoints() {
+    uint32_t seed = 2000;
+    for (const auto& size : {std::pair{1, 1}, {37, 23}, {131, 67}, {641, 17}, {320, 241}}) {
+        const int width = size.first, height = size.second;
+        const std::vector<uint8_t> gray = test::edgeImage(width, height, width, seed++);
+        const PlaneView luma{gray.data(), width, height, width, 1};
+        std::vector<uint8_t> bytesMask(static_cast<size_t>(width) * height);
+        size_t written = 0;
+        CHECK(processLumaEdges(luma, 50, 150, bytesMask.data(), bytesMask.size(), written),
+              "%dx%d: Bytes failed", width, height);
+        CHECK(width < 32 || std::count(bytesMask.begin(), bytesMask.end(), 255) > 0, "%dx%d: no edges to encode",
+              width, height);
+
+        for (EdgeMaskFormat format : {EdgeMaskFormat::Points, EdgeMaskFormat::Runs}) {
+            const int f = static_cast<int>(format);
+            // Size query: no buffer at all, which only fits an empty Points list.
+            size_t need = 0;
+            const bool fits = processLumaEdges(luma, 50, 150, nullptr, 0, need, BlurParams(), format);
+            CHECK(fits == (need == 0), "%dx%d format %d: empty buffer %s with size %zu", width, height, f,
+                  fits ? "accepted" : "rejected", need);
+            CHECK(need <= maxSparseEdgeBytes(width, height, format),
+                  "%dx%d format %d: size query returned %zu", width, height, f, need);
+
+            std::vector<uint8_t> out(need + kGuard, kCanary);
+            if (need > 0) {
+                size_t shortNeed = 0;
+                CHECK(!processLumaEdges(luma, 50, 150, out.data(), need - 1, shortNeed, BlurParams(), format) &&
+                          shortNeed == need,
+                      "%dx%d format %d: short buffer gave %zu, need %zu", width, height, f, shortNeed, need);
+            }
+            CHECK(processLumaEdges(luma, 50, 150, out.data(), need, written, BlurParams(), format) && written == need,
+                  "%dx%d format %d: exact buffer failed (%zu of %zu)", width, height, f, written, need);
+            bool guardIntact = true;
+            for (size_t i = need; i < out.size(); ++i) guardIntact &= out[i] == kCanary;
+            CHECK(guardIntact, "%dx%d format %d: wrote past the size it reported", width, height, f);
+            const std::vector<uint8_t> decoded = format == EdgeMaskFormat::Points
+                                                     ? decodePoints(out.data(), written, width, height)
+                                                     : decodeRuns(out.data(), written, width, height);
+            CHECK(decoded == bytesMask, "%dx%d format %d: differs from the Bytes mask", width, height, f);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    checkPackedRoundTrip();
+    checkSparseEncoders();
+    checkSparseEntryPoints();
+    return test::testResult();
+}
@@ -0,0 +1,274 @@
+// Pushes thousands of frames through FrameRing, FrameMailbox and EdgeWorker
+// (Latest, Queue and Parallel) with the producer and consumer on separate
+// threads. Every slot and mask that comes out must be intact, sequence
+// numbers must strictly increase, and once the worker has caught up the
+// EdgeWorkerStats invariants must hold exactly. Meant to run under
+// ThreadSanitizer as well (EDGEVIEWER_TSAN, see jni/CMakeLists.txt).
+#include "edge_worker.hpp"
+#include "frame_mailbox.hpp"
+#include "frame_ring.hpp"
+#include "test_support.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr uint64_t kSlotFrames = 20000;
+constexpr uint64_t kWorkerFrames = 3000;
+constexpr int kMaxWidth = 160;
+constexpr int kMaxHeight = 120;
+
+// A slot whose payload is derived from its sequence number, so a torn or
+// stale read shows up as a mismatch.
+struct Payload {
+    uint64_t sequence = 0;
+    std::vector<uint32_t> words = std::vector<uint32_t>(256);
+
+    void fill(uint64_t seq) {
+        sequence = seq;
+        for (size_t i = 0; i < words.size(); ++i) words[i] = static_cast<uint32_t>(seq * 2654435761u + i);
+    }
+    bool intact() const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (words[i] != static_cast<uint32_t>(sequence * 2654435761u + i)) return false;
+        }
+        return true;
+    }
+};
+
+// Every frame arrives, in order.
+void stressRing() {
+    FrameRing<Payload> ring(4);
+    std::thread producer([&] {
+        for (uint64_t seq = 0; seq < kSlotFrames; ++seq) {
+            Payload* slot;
+            while ((slot = ring.beginWrite()) == nullptr) std::this_thread::yield();
+            slot->fill(seq);
+            ring.commitWrite();
+        }
+    });
+    uint64_t expected = 0;
+    bool intact = true;
+    while (expected < kSlotFrames) {
+        const Payload* slot = ring.beginRead();
+        if (!slot) {
+            std::this_thread::yield();
+            continue;
+        }
+        intact &= slot->intact();
+        CHECK(slot->sequence == expected, "ring: got frame %llu, expected %llu",
+              static_cast<unsigned long long>(slot->sequence), static_cast<unsigned long long>(expected));
+        expected = slot->sequence + 1;
+        ring.endRead();
+    }
+    producer.join();
+    CHECK(intact, "ring: a slot was read while being written");
+    CHECK(ring.beginRead() == nullptr, "ring: slots left after the last frame");
+}
+
+// Frames may be skipped, never reordered, and the last one is never lost.
+void stressMailbox() {
+    FrameMailbox<Payload> mailbox;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        for (uint64_t seq = 0; seq < kSlotFrames; ++seq) {
+            mailbox.beginWrite()->fill(seq);
+            mailbox.commitWrite();
+            if (seq % 64 == 0) std::this_thread::yield();
+        }
+        done.store(true);
+    });
+    int64_t last = -1;
+    bool intact = true, increasing = true;
+    uint64_t taken = 0;
+    for (;;) {
+        const bool finished = done.load();
+        if (const Payload* slot = mailbox.beginRead()) {
+            intact &= slot->intact();
+            increasing &= static_cast<int64_t>(slot->sequence) > last;
+            last = static_cast<int64_t>(slot->sequence);
+            ++taken;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(intact, "mailbox: a slot was read while being written");
+    CHECK(increasing, "mailbox: sequence went backwards");
+    CHECK(last == static_cast<int64_t>(kSlotFrames - 1), "mailbox: last frame %lld lost", static_cast<long long>(last));
+    CHECK(taken > 0, "mailbox: nothing taken");
+}
+
+// Luma frames of a few sizes and patterns, each with the mask a
+// single-threaded EdgePipeline makes of it.
+struct TestFrame {
+    int width;
+    int height;
+    int rowStride;
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> mask;
+    EdgeThresholds thresholds;
+};
+
+std::vector<TestFrame> makeFrames(const EdgePipelineConfig& config) {
+    EdgePipelineConfig single = config;
+    single.parallelBands = false;
+    EdgePipeline reference(single);
+    std::vector<TestFrame> frames;
+    const int sizes[][2] = {{160, 120}, {96, 64}, {160, 120}, {33, 17}, {128, 120}, {160, 90}, {64, 64}, {160, 120}};
+    uint32_t seed = 1;
+    for (const auto& size : sizes) {
+        TestFrame f{size[0], size[1], size[0] + 8, {}, {}, {}};
+        f.pixels = test::randomBytes(static_cast<size_t>(f.rowStride) * f.height, seed++);
+        // Smooth gradients with a few bright blocks, so there are edges
+        // beyond the noise.
+        for (int y = 0; y < f.height; ++y) {
+            for (int x = 0; x < f.width; ++x) {
+                uint8_t& p = f.pixels[static_cast<size_t>(y) * f.rowStride + x];
+                const bool block = ((x / 16) + (y / 16) + static_cast<int>(seed)) % 3 == 0;
+                p = static_cast<uint8_t>((block ? 200 : x + y) + (p & 15));
+            }
+        }
+        f.mask.resize(reference.maxOutputBytes());
+        size_t written = 0;
+        const bool ok = reference.process(PlaneView{f.pixels.data(), f.width, f.height, f.rowStride, 1}, f.mask.data(),
+                                          f.mask.size(), written);
+        CHECK(ok, "reference pipeline rejected a %dx%d frame", f.width, f.height);
+        f.mask.resize(written);
+        f.thresholds = reference.lastThresholds();
+        frames.push_back(std::move(f));
+    }
+    return frames;
+}
+
+struct DisplayCheck {
+    uint64_t shown = 0;
+    uint64_t wrongMask = 0;
+    uint64_t notIncreasing = 0;
+    int64_t last = -1;
+
+    void take(const EdgeFrame& e, const std::vector<TestFrame>& frames) {
+        ++shown;
+        if (static_cast<int64_t>(e.sequence) <= last) ++notIncreasing;
+        last = static_cast<int64_t>(e.sequence);
+        const TestFrame& f = frames[e.sequence % frames.size()];
+        const bool same = e.width == f.width && e.height == f.height && e.bytes == f.mask.size() &&
+                          e.timestampNs == static_cast<int64_t>(e.sequence) * 1000 &&
+                          e.thresholds.low == f.thresholds.low && e.thresholds.high == f.thresholds.high &&
+                          std::memcmp(e.mask.data(), f.mask.data(), e.bytes) == 0;
+        if (!same) ++wrongMask;
+    }
+};
+
+void stressWorker(const char* name, FramePolicy policy, size_t slots, const EdgePipelineConfig& config,
+                  const std::vector<TestFrame>& frames, FramePolicy expectedPolicy) {
+    EdgeWorker worker;
+    CHECK(worker.start(config, policy, slots), "%s: start failed", name);
+    CHECK(worker.policy() == expectedPolicy, "%s: runs policy %d", name, static_cast<int>(worker.policy()));
+
+    std::atomic<bool> submitting{true};
+    DisplayCheck display;
+    std::thread displayThread([&] {
+        while (submitting.load()) {
+            if (const EdgeFrame* e = worker.takeLatest()) {
+                display.take(*e, frames);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Alternating back-to-back and paced stretches, with short pauses, so
+    // frames are both dropped and processed.
+    for (uint64_t i = 0; i < kWorkerFrames; ++i) {
+        const TestFrame& f = frames[i % frames.size()];
+        worker.submit(PlaneView{f.pixels.data(), f.width, f.height, f.rowStride, 1}, static_cast<int64_t>(i) * 1000);
+        if (i % 16 == 15) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else if ((i / 256) % 2 == 1) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    // Wait until every frame is dropped, failed or published.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    EdgeWorkerStats s = worker.stats();
+    while (s.received != s.dropped + s.failed + s.processed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        s = worker.stats();
+    }
+    submitting.store(false);
+    displayThread.join();
+    if (const EdgeFrame* e = worker.takeLatest()) display.take(*e, frames);
+    s = worker.stats();
+    worker.stop();
+
+    CHECK(s.received == kWorkerFrames, "%s: received %llu of %llu", name, static_cast<unsigned long long>(s.received),
+          static_cast<unsigned long long>(kWorkerFrames));
+    CHECK(s.received == s.dropped + s.failed + s.processed, "%s: received %llu != dropped %llu + failed %llu + processed %llu",
+          name, static_cast<unsigned long long>(s.received), static_cast<unsigned long long>(s.dropped),
+          static_cast<unsigned long long>(s.failed), static_cast<unsigned long long>(s.processed));
+    CHECK(s.processed == s.superseded + s.displayed, "%s: processed %llu != superseded %llu + displayed %llu", name,
+          static_cast<unsigned long long>(s.processed), static_cast<unsigned long long>(s.superseded),
+          static_cast<unsigned long long>(s.displayed));
+    CHECK(s.failed == 0, "%s: %llu frames failed", name, static_cast<unsigned long long>(s.failed));
+    CHECK(s.processed > 0 && s.displayed == display.shown, "%s: processed %llu, displayed %llu, shown %llu", name,
+          static_cast<unsigned long long>(s.processed), static_cast<unsigned long long>(s.displayed),
+          static_cast<unsigned long long>(display.shown));
+    CHECK(display.wrongMask == 0, "%s: %llu masks differ from the single-threaded pipeline", name,
+          static_cast<unsigned long long>(display.wrongMask));
+    CHECK(display.notIncreasing == 0, "%s: sequence did not increase %llu times", name,
+          static_cast<unsigned long long>(display.notIncreasing));
+    std::printf("%-10s received %5llu dropped %5llu processed %5llu superseded %5llu displayed %5llu\n", name,
+                static_cast<unsigned long long>(s.received), static_cast<unsigned long long>(s.dropped),
+                static_cast<unsigned long long>(s.processed), static_cast<unsigned long long>(s.superseded),
+                static_cast<unsigned long long>(s.displayed));
+}
+
+// start() and stop() while frames are still in flight, across policies.
+void stressRestart(const EdgePipelineConfig& config, const std::vector<TestFrame>& frames) {
+    EdgeWorker worker;
+    for (int i = 0; i < 60; ++i) {
+        const FramePolicy policy = static_cast<FramePolicy>(i % 3);
+        CHECK(worker.start(config, policy, 1 + i % 3), "restart %d: start failed", i);
+        for (int k = 0; k < 4; ++k) {
+            const TestFrame& f = frames[static_cast<size_t>(i + k) % frames.size()];
+            worker.submit(PlaneView{f.pixels.data(), f.width, f.height, f.rowStride, 1}, k);
+        }
+        worker.takeLatest();
+    }
+    worker.stop();
+    CHECK(!worker.isRunning(), "restart: still running after stop()");
+}
+
+} // namespace
+
+int main() {
+    stressRing();
+    stressMailbox();
+
+    EdgePipelineConfig config;
+    config.maxWidth = kMaxWidth;
+    config.maxHeight = kMaxHeight;
+    config.thresholds.mode = ThresholdMode::Otsu;
+    const std::vector<TestFrame> frames = makeFrames(config);
+
+    stressWorker("latest", FramePolicy::Latest, 1, config, frames, FramePolicy::Latest);
+    stressWorker("queue-1", FramePolicy::Queue, 1, config, frames, FramePolicy::Queue);
+    stressWorker("queue-3", FramePolicy::Queue, 3, config, frames, FramePolicy::Queue);
+    // Parallel runs its frames on the shared pool, which needs threads
+    // besides the caller's; with one it falls back to Queue.
+    setSharedWorkerThreads(4);
+    stressWorker("parallel-1", FramePolicy::Parallel, 1, config, frames, FramePolicy::Parallel);
+    stressWorker("parallel-3", FramePolicy::Parallel, 3, config, frames, FramePolicy::Parallel);
+    stressRestart(config, frames);
+    setSharedWorkerThreads(1);
+    stressWorker("parallel/1t", FramePolicy::Parallel, 3, config, frames, FramePolicy::Queue);
+    return test::testResult();
+}
@@ -0,0 +1,249 @@
+// Throughput of every kernel variant the CPU supports, per resolution, so
+// the speedups quoted in commits and the README can be reproduced:
+//   edgeviewer_bench [iterations]
+// Times are the best of `iterations` single-threaded passes over a frame.
+//   edgeviewer_bench threads [iterations]
+// instead times processCannyEdges and processGrayscale at 1, 2, 4, ... up to
+// one worker per hardware thread, with the speedup over one thread.
+#include "luma_kernels.hpp"
+#include "opencv_pipeline.hpp"
+#include "pixel_expr.hpp"
+#include "sobel.hpp"
+#include "test_support.hpp"
+#include "yuv_convert.hpp"
+#include "yuv_reference.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+using namespace edgeviewer;
+
+namespace {
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+constexpr Resolution kResolutions[] = {
+    {"480p", 640, 480},
+    {"720p", 1280, 720},
+    {"1080p", 1920, 1080},
+};
+
+int g_iterations = 20;
+
+// Best wall time of one `frame` pass, in milliseconds.
+double bestMs(const std::function<void()>& frame) {
+    double best = 1e30;
+    for (int i = 0; i < g_iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        frame();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* kernel, const Resolution& res, const char* isa, double ms, double baselineMs) {
+    const double mpix = static_cast<double>(res.width) * res.height / 1e6;
+    std::printf("%-14s %-6s %-8s %8.3f ms %8.1f Mpx/s %6.2fx\n", kernel, res.name, isa, ms, mpix / (ms / 1e3),
+                baselineMs / ms);
+}
+
+void benchLuma() {
+    for (const Resolution& res : kResolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        const std::vector<uint8_t> rgba = test::randomBytes(pixels * 4, 7);
+        std::vector<uint8_t> gray(pixels);
+        double scalarMs = 0;
+        for (const IsaKernel<LumaRowKernel>& k : lumaRowKernels(PixelFormat::RGBA)) {
+            const double ms = bestMs([&] {
+                for (int y = 0; y < res.height; ++y) {
+                    const size_t row = static_cast<size_t>(y) * res.width;
+                    k.kernel(rgba.data() + row * 4, gray.data() + row, res.width);
+                }
+            });
+            if (scalarMs == 0) scalarMs = ms;
+            report("luma RGBA", res, k.isa, ms, scalarMs);
+        }
+    }
+}
+
+// Gradients plus the L2-squared magnitude Canny compares, over a gray frame
+// with replicated top and bottom rows.
+void benchSobel() {
+    for (const Resolution& res : kResolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        const std::vector<uint8_t> gray = test::randomBytes(pixels, 17);
+        std::vector<int16_t> dx(pixels), dy(pixels), scratch(2 * (static_cast<size_t>(res.width) + 2));
+        std::vector<int> mag(pixels);
+        double scalarMs = 0;
+        for (const IsaKernel<SobelRowKernel>& k : sobelRowKernels()) {
+            const double ms = bestMs([&] {
+                for (int y = 0; y < res.height; ++y) {
+                    const auto row = [&](int r) { return gray.data() + static_cast<size_t>(r) * res.width; };
+                    const size_t at = static_cast<size_t>(y) * res.width;
+                    k.kernel(row(std::max(y - 1, 0)), row(y), row(std::min(y + 1, res.height - 1)), res.width,
+                             scratch.data(), dx.data() + at, dy.data() + at, mag.data() + at, SobelMagnitude::L2Squared);
+                }
+            });
+            if (scalarMs == 0) scalarMs = ms;
+            report("sobel L2", res, k.isa, ms, scalarMs);
+        }
+    }
+}
+
+// NV21 frames (the usual camera layout): the Kotlin loop port, each row
+// kernel on I420 rows, and the full convertYuv420ToRgba entry point (which
+// also gathers interleaved chroma and runs bands on the shared pool).
+void benchYuv() {
+    for (const Resolution& res : kResolutions) {
+        const test::YuvFrame nv21(res.width, res.height, test::ChromaLayout::NV21, 0, 11);
+        const test::YuvFrame i420(res.width, res.height, test::ChromaLayout::I420, 0, 13);
+        std::vector<uint8_t> rgba(static_cast<size_t>(res.width) * res.height * 4);
+
+        const double kotlinMs = bestMs([&] { test::kotlinYuv420ToRgba(nv21.view(), res.width, res.height, rgba.data()); });
+        report("yuv kotlin", res, "scalar", kotlinMs, kotlinMs);
+
+        const Yuv420View planes = i420.view();
+        for (const IsaKernel<YuvRowKernel>& k : yuvRowKernels()) {
+            const double ms = bestMs([&] {
+                for (int y = 0; y < res.height; ++y) {
+                    const size_t chroma = static_cast<size_t>(y / 2) * planes.u.rowStride;
+                    k.kernel(planes.y.data + static_cast<size_t>(y) * planes.y.rowStride, planes.u.data + chroma,
+                             planes.v.data + chroma, rgba.data() + static_cast<size_t>(y) * res.width * 4, res.width);
+                }
+            });
+            report("yuv rows", res, k.isa, ms, kotlinMs);
+        }
+
+        const double nativeMs = bestMs([&] {
+            size_t written = 0;
+            convertYuv420ToRgba(nv21.view(), rgba.data(), rgba.size(), written);
+        });
+        report("yuv convert", res, "native", nativeMs, kotlinMs);
+    }
+}
+
+// px::evaluate against the loop one would write by hand for the same
+// result, single-threaded: a fused luma + threshold, a LUT, and a 3x3
+// dilation (stencil3x3) of a plane.
+void benchPixelExpr() {
+    std::vector<uint8_t> table(256);
+    for (int i = 0; i < 256; ++i) table[i] = static_cast<uint8_t>(255 - i / 2);
+    for (const Resolution& res : kResolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        const std::vector<uint8_t> rgba = test::randomBytes(pixels * 4, 23);
+        const std::vector<uint8_t> gray = test::randomBytes(pixels, 29);
+        std::vector<uint8_t> out(pixels);
+        const ImageView view{rgba.data(), res.width, res.height, res.width * 4, PixelFormat::RGBA};
+        const auto plane = px::plane(gray.data(), res.width, res.height, static_cast<size_t>(res.width));
+
+        const double thresholdLoopMs = bestMs([&] {
+            for (size_t i = 0; i < pixels; ++i) {
+                const uint8_t* p = &rgba[i * 4];
+                out[i] = lumaPixel(p[0], p[1], p[2]) > 100 ? 255 : 0;
+            }
+        });
+        report("px threshold", res, "loop", thresholdLoopMs, thresholdLoopMs);
+        report("px threshold", res, "px", bestMs([&] {
+                   px::evaluate(px::threshold(px::luma(px::pixels<PixelFormat::RGBA>(view)), uint8_t(100)), out.data(),
+                                static_cast<size_t>(res.width));
+               }),
+               thresholdLoopMs);
+
+        const double lutLoopMs = bestMs([&] {
+            for (size_t i = 0; i < pixels; ++i) out[i] = table[gray[i]];
+        });
+        report("px lut", res, "loop", lutLoopMs, lutLoopMs);
+        report("px lut", res, "px", bestMs([&] {
+                   px::evaluate(px::lut(plane, table.data()), out.data(), static_cast<size_t>(res.width));
+               }),
+               lutLoopMs);
+
+        const double dilateLoopMs = bestMs([&] {
+            for (int y = 0; y < res.height; ++y) {
+                for (int x = 0; x < res.width; ++x) {
+                    uint8_t m = 0;
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        const size_t row = static_cast<size_t>(std::min(std::max(y + dy, 0), res.height - 1)) * res.width;
+                        for (int dx = -1; dx <= 1; ++dx) m = std::max(m, gray[row + std::min(std::max(x + dx, 0), res.width - 1)]);
+                    }
+                    out[static_cast<size_t>(y) * res.width + x] = m;
+                }
+            }
+        });
+        report("px dilate3x3", res, "loop", dilateLoopMs, dilateLoopMs);
+        report("px dilate3x3", res, "px", bestMs([&] {
+                   px::evaluate(px::dilate3x3(plane), out.data(), static_cast<size_t>(res.width));
+               }),
+               dilateLoopMs);
+    }
+}
+
+// Worker counts for the sweep: powers of two below the hardware thread
+// count, then the count itself.
+std::vector<int> threadCounts() {
+    const int hardware = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> counts;
+    for (int t = 1; t < hardware; t *= 2) counts.push_back(t);
+    counts.push_back(hardware);
+    return counts;
+}
+
+// The full entry points at every worker count. RGBA frames with real edges,
+// so hysteresis does the work it does on camera frames.
+void benchThreads() {
+    for (const Resolution& res : kResolutions) {
+        const size_t pixels = static_cast<size_t>(res.width) * res.height;
+        const std::vector<uint8_t> gray = test::edgeImage(res.width, res.height, res.width, 5);
+        std::vector<uint8_t> rgba(pixels * 4, 255);
+        for (size_t i = 0; i < pixels; ++i) std::memset(&rgba[i * 4], gray[i], 3);
+        const ImageView image{rgba.data(), res.width, res.height, res.width * 4, PixelFormat::RGBA};
+        std::vector<uint8_t> out(pixels);
+
+        double cannyBase = 0, grayBase = 0;
+        for (int threads : threadCounts()) {
+            setWorkerThreadCount(threads);
+            char label[16];
+            std::snprintf(label, sizeof(label), "%d thr", threads);
+            const double cannyMs = bestMs([&] {
+                size_t written = 0;
+                processCannyEdges(image, 50, 150, out.data(), out.size(), written);
+            });
+            const double grayMs = bestMs([&] {
+                size_t written = 0;
+                processGrayscale(image, out.data(), out.size(), written);
+            });
+            if (cannyBase == 0) cannyBase = cannyMs;
+            if (grayBase == 0) grayBase = grayMs;
+            report("canny", res, label, cannyMs, cannyBase);
+            report("grayscale", res, label, grayMs, grayBase);
+        }
+    }
+    setWorkerThreadCount(0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool threads = argc > 1 && std::strcmp(argv[1], "threads") == 0;
+    const int iterationsArg = threads ? 2 : 1;
+    if (argc > iterationsArg) g_iterations = std::max(1, std::atoi(argv[iterationsArg]));
+    if (threads) {
+        benchThreads();
+        return 0;
+    }
+    benchLuma();
+    benchSobel();
+    benchYuv();
+    benchPixelExpr();
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Every Gaussian row kernel the CPU supports against gaussianRowScalar, for
+// each kernel size and several sigmas, at widths below, around and past the
+// vector widths; bytes past the row end must stay untouched. The 2-D blur is
+// checked against a direct reflect-101 reference on images smaller than the
+// kernel, where the reflection wraps more than once.
+#include "gaussian.hpp"
+#include "opencv_pipeline.hpp"
+#include "test_support.hpp"
+
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr int kGuard = 40;
+constexpr uint8_t kCanary = 0xA5;
+constexpr int kMaxTaps = 2 * GaussianKernel::kMaxRadius + 1;
+
+constexpr int kSizes[] = {1, 3, 5, 7};
+constexpr double kSigmas[] = {0.0, 0.5, 0.8, 1.4, 2.5};
+
+// kMaxTaps rows of `width` samples, one byte in so none is vector aligned.
+struct Rows {
+    std::vector<uint8_t> bytes;
+    int width;
+    const uint8_t* row(int r) const { return bytes.data() + 1 + static_cast<size_t>(r) * width; }
+};
+
+Rows randomRows(int width, uint32_t seed) {
+    return {test::randomBytes(kMaxTaps * static_cast<size_t>(width) + 1, seed), width};
+}
+
+// 0/255 columns (pattern 0) or a checkerboard (1): the largest sums.
+Rows saturatedRows(int width, int pattern) {
+    Rows rows{std::vector<uint8_t>(kMaxTaps * static_cast<size_t>(width) + 1), width};
+    for (int r = 0; r < kMaxTaps; ++r) {
+        for (int x = 0; x < width; ++x) {
+            const int on = pattern == 0 ? x & 1 : (x + r) & 1;
+            rows.bytes[1 + static_cast<size_t>(r) * width + x] = on ? 255 : 0;
+        }
+    }
+    return rows;
+}
+
+std::vector<uint8_t> run(GaussianRowKernel kernel, const GaussianKernel& taps, const Rows& rows) {
+    const uint8_t* ptrs[kMaxTaps];
+    for (int k = 0; k < kMaxTaps; ++k) ptrs[k] = rows.row(k);
+    std::vector<uint16_t> scratch(static_cast<size_t>(rows.width) + 2 * GaussianKernel::kMaxRadius);
+    std::vector<uint8_t> out(static_cast<size_t>(rows.width) + kGuard, kCanary);
+    kernel(taps, ptrs, rows.width, scratch.data(), out.data());
+    return out;
+}
+
+void compare(const IsaKernel<GaussianRowKernel>& k, const GaussianKernel& taps, const Rows& rows, const char* what,
+             int size, double sigma) {
+    const std::vector<uint8_t> expected = run(gaussianRowScalar, taps, rows);
+    const std::vector<uint8_t> actual = run(k.kernel, taps, rows);
+    const size_t n = static_cast<size_t>(rows.width);
+    CHECK(std::memcmp(actual.data(), expected.data(), n) == 0, "%s %s width %d ksize %d sigma %.1f: differs from scalar",
+          k.isa, what, rows.width, size, sigma);
+    bool guardIntact = true;
+    for (int i = 0; i < kGuard; ++i) guardIntact &= actual[n + i] == kCanary;
+    CHECK(guardIntact, "%s %s width %d ksize %d: writes past the row", k.isa, what, rows.width, size);
+}
+
+void checkRowKernels() {
+    const std::vector<IsaKernel<GaussianRowKernel>> kernels = gaussianRowKernels();
+    CHECK(!kernels.empty() && kernels.back().kernel == gaussianRowKernel(),
+          "gaussianRowKernel is not the last supported kernel");
+
+    std::vector<int> widths;
+    for (int w = 1; w <= 80; ++w) widths.push_back(w);
+    for (int w : {95, 97, 127, 129, 255, 257, 641}) widths.push_back(w);
+
+    uint32_t seed = 1;
+    for (int size : kSizes) {
+        for (double sigma : kSigmas) {
+            GaussianKernel taps;
+            CHECK(makeGaussianKernel(size, sigma, taps), "ksize %d sigma %.1f rejected", size, sigma);
+            for (int width : widths) {
+                const Rows random = randomRows(width, seed++);
+                for (const IsaKernel<GaussianRowKernel>& k : kernels) {
+                    compare(k, taps, random, "random", size, sigma);
+                    for (int pattern = 0; pattern < 2; ++pattern) {
+                        compare(k, taps, saturatedRows(width, pattern), "saturated", size, sigma);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// BORDER_REFLECT_101 by its period, 2n - 2, rather than by repeated
+// mirroring as borderReflect101 does.
+int reflect101(int i, int n) {
+    if (n == 1) return 0;
+    const int period = 2 * n - 2;
+    i %= period;
+    if (i < 0) i += period;
+    return (i < n) ? i : period - i;
+}
+
+// The separable Q8 blur written out as one 2-D sum.
+std::vector<uint8_t> referenceBlur(const std::vector<uint8_t>& src, int width, int height, const GaussianKernel& taps) {
+    const int r = taps.radius;
+    std::vector<uint8_t> out(src.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint64_t sum = 1u << 15;
+            for (int j = -r; j <= r; ++j) {
+                for (int i = -r; i <= r; ++i) {
+                    sum += static_cast<uint64_t>(taps.taps[j + r]) * taps.taps[i + r] *
+                           src[static_cast<size_t>(reflect101(y + j, height)) * width + reflect101(x + i, width)];
+                }
+            }
+            out[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(sum >> 16);
+        }
+    }
+    return out;
+}
+
+void checkBorders() {
+    uint32_t seed = 500;
+    for (int size : kSizes) {
+        for (double sigma : kSigmas) {
+            GaussianKernel taps;
+            makeGaussianKernel(size, sigma, taps);
+            int sum = 0;
+            for (int k = 0; k < size; ++k) sum += taps.taps[k];
+            CHECK(sum == 256, "ksize %d sigma %.1f: taps sum to %d", size, sigma, sum);
+
+            for (int width = 1; width <= 12; ++width) {
+                for (int height = 1; height <= 9; ++height) {
+                    const std::vector<uint8_t> src = test::randomBytes(static_cast<size_t>(width) * height, seed++);
+                    std::vector<uint8_t> out(src.size() + kGuard, kCanary);
+                    size_t written = 0;
+                    CHECK(processGaussianBlur(PlaneView{src.data(), width, height, width, 1}, BlurParams{size, sigma},
+                                              out.data(), src.size(), written) &&
+                              written == src.size(),
+                          "%dx%d ksize %d: blur failed", width, height, size);
+                    bool guardIntact = true;
+                    for (int i = 0; i < kGuard; ++i) guardIntact &= out[src.size() + i] == kCanary;
+                    CHECK(guardIntact, "%dx%d ksize %d: writes past the plane", width, height, size);
+                    out.resize(src.size());
+                    CHECK(out == referenceBlur(src, width, height, taps), "%dx%d ksize %d sigma %.1f: border differs",
+                          width, height, size, sigma);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    checkRowKernels();
+    checkBorders();
+    return test::testResult();
+}
@@ -0,0 +1,168 @@
+// IncrementalEdgeDetector: an unchanged frame recomputes no tiles and still
+// equals full-frame Canny; a moved square dirties only the tiles it touches,
+// changes nothing outside their halo and matches ROI Canny inside it; new
+// sizes, thresholds or blur recompute everything; and the result does not
+// depend on the worker thread count.
+#include "incremental_edges.hpp"
+#include "opencv_pipeline.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+constexpr int kTile = 64;
+constexpr double kLow = 50;
+constexpr double kHigh = 150;
+
+// A bright square over `frame`, flat so it always has edges of its own.
+void drawSquare(std::vector<uint8_t>& frame, int width, int x0, int y0, int side) {
+    for (int y = y0; y < y0 + side; ++y) {
+        std::fill_n(frame.begin() + static_cast<size_t>(y) * width + x0, side, uint8_t(250));
+    }
+}
+
+std::vector<uint8_t> fullCanny(const std::vector<uint8_t>& frame,
+                               int width,
+                               int height,
+                               double low = kLow,
+                               const BlurParams& blur = BlurParams()) {
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height);
+    size_t written = 0;
+    CHECK(processLumaEdges(PlaneView{frame.data(), width, height, width, 1}, low, kHigh, mask.data(), mask.size(),
+                           written, blur),
+          "full Canny %dx%d failed", width, height);
+    return mask;
+}
+
+std::vector<uint8_t> incremental(IncrementalEdgeDetector& detector,
+                                 const std::vector<uint8_t>& frame,
+                                 int width,
+                                 int height,
+                                 double low = kLow,
+                                 const BlurParams& blur = BlurParams()) {
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height);
+    size_t written = 0;
+    CHECK(detector.processLuma(PlaneView{frame.data(), width, height, width, 1}, low, kHigh, mask.data(), mask.size(),
+                               written, blur) &&
+              written == mask.size(),
+          "incremental %dx%d failed", width, height);
+    return mask;
+}
+
+// Frames of one run: a static scene, then one square, then a second one
+// straddling two tiles.
+struct Scene {
+    std::vector<uint8_t> still = test::edgeImage(kWidth, kHeight, kWidth, 3);
+    std::vector<uint8_t> oneSquare = still;
+    std::vector<uint8_t> twoSquares;
+
+    Scene() {
+        drawSquare(oneSquare, kWidth, 140, 80, 20); // tile (2, 1)
+        twoSquares = oneSquare;
+        drawSquare(twoSquares, kWidth, 250, 150, 20); // tiles (3, 2) and (4, 2)
+    }
+};
+
+void checkUnchangedAndMoved(const Scene& scene) {
+    IncrementalEdgeDetector detector(IncrementalParams{kTile, 4, 256});
+    const std::vector<uint8_t> first = incremental(detector, scene.still, kWidth, kHeight);
+    CHECK(detector.tileCount() == 20 && detector.dirtyTileCount() == 20, "first frame recomputed %d of %d tiles",
+          detector.dirtyTileCount(), detector.tileCount());
+    const std::vector<uint8_t> full = fullCanny(scene.still, kWidth, kHeight);
+    CHECK(first == full, "first frame differs from processLumaEdges");
+    CHECK(std::count(full.begin(), full.end(), 255) > 0, "no edges in the scene");
+
+    const std::vector<uint8_t> again = incremental(detector, scene.still, kWidth, kHeight);
+    CHECK(detector.dirtyTileCount() == 0, "unchanged frame recomputed %d tiles", detector.dirtyTileCount());
+    CHECK(again == full, "unchanged frame differs from processLumaEdges");
+
+    // One dirty tile: outside it and its halo the cached mask stays, inside
+    // the result is Canny on the tile grown by the halo, as for an ROI.
+    const int halo = BlurParams().kernelSize / 2 + 2;
+    const std::vector<uint8_t> moved = incremental(detector, scene.oneSquare, kWidth, kHeight);
+    CHECK(detector.dirtyTileCount() == 1, "one square dirtied %d tiles", detector.dirtyTileCount());
+    const RoiRect tile{2 * kTile, kTile, kTile, kTile};
+    const RoiRect recomputed{tile.x - halo, tile.y - halo, tile.width + 2 * halo, tile.height + 2 * halo};
+    std::vector<uint8_t> roi(moved.size());
+    size_t written = 0;
+    CHECK(processLumaEdgesRoi(PlaneView{scene.oneSquare.data(), kWidth, kHeight, kWidth, 1}, &recomputed, 1,
+                              RoiLayout::FullFrame, kLow, kHigh, roi.data(), roi.size(), written),
+          "ROI reference failed");
+    int outside = 0, inside = 0;
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            const size_t i = static_cast<size_t>(y) * kWidth + x;
+            const bool near = x >= recomputed.x && x < recomputed.x + recomputed.width && y >= recomputed.y &&
+                              y < recomputed.y + recomputed.height;
+            if (near) {
+                inside += moved[i] != roi[i];
+            } else {
+                outside += moved[i] != full[i];
+            }
+        }
+    }
+    CHECK(outside == 0, "%d pixels changed outside the dirty tile's halo", outside);
+    CHECK(inside == 0, "%d pixels differ from ROI Canny inside the halo", inside);
+    CHECK(moved != full, "the square left no trace in the output");
+
+    // The second square straddles two tiles; the first one is now cached.
+    incremental(detector, scene.twoSquares, kWidth, kHeight);
+    CHECK(detector.dirtyTileCount() == 2, "second square dirtied %d tiles", detector.dirtyTileCount());
+}
+
+void checkFullRecompute(const Scene& scene) {
+    IncrementalEdgeDetector detector(IncrementalParams{kTile, 4, 256});
+    incremental(detector, scene.still, kWidth, kHeight);
+
+    // Lower low threshold.
+    CHECK(incremental(detector, scene.still, kWidth, kHeight, 30) == fullCanny(scene.still, kWidth, kHeight, 30) &&
+              detector.dirtyTileCount() == detector.tileCount(),
+          "threshold change recomputed %d tiles", detector.dirtyTileCount());
+
+    // Other blur.
+    const BlurParams wide{5, 1.4};
+    CHECK(incremental(detector, scene.still, kWidth, kHeight, 30, wide) ==
+                  fullCanny(scene.still, kWidth, kHeight, 30, wide) &&
+              detector.dirtyTileCount() == detector.tileCount(),
+          "blur change recomputed %d tiles", detector.dirtyTileCount());
+
+    // Smaller frame, same content where it overlaps.
+    const int width = kWidth - 1, height = kHeight - 3;
+    std::vector<uint8_t> cropped(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        std::copy_n(scene.still.begin() + static_cast<size_t>(y) * kWidth, width,
+                    cropped.begin() + static_cast<size_t>(y) * width);
+    }
+    CHECK(incremental(detector, cropped, width, height) == fullCanny(cropped, width, height) &&
+              detector.dirtyTileCount() == detector.tileCount() && detector.tileCount() == 20,
+          "size change recomputed %d of %d tiles", detector.dirtyTileCount(), detector.tileCount());
+}
+
+// The whole run, every output concatenated.
+std::vector<uint8_t> runAtThreads(const Scene& scene, int threads) {
+    setWorkerThreadCount(threads);
+    IncrementalEdgeDetector detector(IncrementalParams{kTile, 4, 256});
+    std::vector<uint8_t> all;
+    for (const std::vector<uint8_t>* frame : {&scene.still, &scene.oneSquare, &scene.twoSquares, &scene.still}) {
+        const std::vector<uint8_t> mask = incremental(detector, *frame, kWidth, kHeight);
+        all.insert(all.end(), mask.begin(), mask.end());
+    }
+    return all;
+}
+
+} // namespace
+
+int main() {
+    const Scene scene;
+    checkUnchangedAndMoved(scene);
+    checkFullRecompute(scene);
+
+    CHECK(runAtThreads(scene, 1) == runAtThreads(scene, 4), "output depends on the thread count");
+    setWorkerThreadCount(0);
+    return test::testResult();
+}
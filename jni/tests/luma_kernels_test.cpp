@@ -0,0 +1,67 @@
+// Every luma kernel the CPU supports against lumaRowScalar, for all pixel
+// formats, widths around each vector width and rows at padded (unaligned)
+// strides. Bytes past the row end must stay untouched.
+#include "luma_kernels.hpp"
+#include "test_support.hpp"
+
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr PixelFormat kFormats[] = {
+    PixelFormat::RGBA, PixelFormat::BGRA, PixelFormat::ARGB,
+    PixelFormat::RGB,  PixelFormat::BGR,  PixelFormat::RGBX,
+};
+
+constexpr uint8_t kCanary = 0xA5;
+constexpr int kGuard = 64;
+constexpr int kRows = 3;
+
+std::vector<int> testWidths() {
+    std::vector<int> widths;
+    for (int w = 0; w <= 80; ++w) widths.push_back(w);
+    for (int w : {95, 96, 97, 127, 128, 129, 255, 256, 257, 641, 1080, 1921}) widths.push_back(w);
+    return widths;
+}
+
+void checkFormat(PixelFormat format, int formatIndex) {
+    const std::vector<IsaKernel<LumaRowKernel>> kernels = lumaRowKernels(format);
+    CHECK(!kernels.empty() && kernels.back().kernel == lumaRowKernel(format),
+          "format %d: lumaRowKernel is not the last supported kernel", formatIndex);
+
+    const int bpp = bytesPerPixel(format);
+    uint32_t seed = 1;
+    for (int width : testWidths()) {
+        for (int pad : {0, 1, 3, 13}) {
+            const size_t stride = static_cast<size_t>(width) * bpp + pad;
+            const std::vector<uint8_t> image = test::randomBytes(stride * kRows + 1, seed++);
+            for (int row = 0; row < kRows; ++row) {
+                // Start one byte in, so no row is vector aligned.
+                const uint8_t* src = image.data() + 1 + row * stride;
+                std::vector<uint8_t> expected(static_cast<size_t>(width));
+                lumaRowScalar(src, expected.data(), width, format);
+                for (const IsaKernel<LumaRowKernel>& k : kernels) {
+                    std::vector<uint8_t> out(static_cast<size_t>(width) + kGuard, kCanary);
+                    k.kernel(src, out.data(), width);
+                    const bool same = std::memcmp(out.data(), expected.data(), expected.size()) == 0;
+                    CHECK(same, "%s format %d width %d pad %d row %d differs from scalar",
+                          k.isa, formatIndex, width, pad, row);
+                    bool guardIntact = true;
+                    for (int i = 0; i < kGuard; ++i) guardIntact &= out[static_cast<size_t>(width + i)] == kCanary;
+                    CHECK(guardIntact, "%s format %d width %d writes past the row", k.isa, formatIndex, width);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    for (int i = 0; i < static_cast<int>(sizeof(kFormats) / sizeof(kFormats[0])); ++i) {
+        checkFormat(kFormats[i], i);
+    }
+    return test::testResult();
+}
@@ -0,0 +1,107 @@
+// 3x3 stencil expressions against direct loops with replicated borders: over
+// a plane and over a fused luma/threshold chain, at widths around the chunk
+// size and heights down to one row, on one thread and on a worker pool.
+#include "opencv_pipeline.hpp"
+#include "pixel_expr.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+
+using namespace edgeviewer;
+
+namespace {
+
+// Sum of the window weighted 1 2 1 / 2 4 2 / 1 2 1, as int.
+struct SmoothOp {
+    int operator()(const px::Window3x3<uint8_t>& w) const {
+        int sum = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) sum += (2 - dx * dx) * (2 - dy * dy) * w(dx, dy);
+        }
+        return sum;
+    }
+};
+
+template <typename T, typename Fn>
+std::vector<T> reference(int width, int height, Fn at) {
+    std::vector<T> out(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) out[static_cast<size_t>(y) * width + x] = at(x, y);
+    }
+    return out;
+}
+
+// value(x + dx, y + dy) with the coordinates clamped to the image.
+template <typename Value>
+auto windowAt(int width, int height, Value value) {
+    return [=](int x, int y, int dx, int dy) {
+        return value(std::min(std::max(x + dx, 0), width - 1), std::min(std::max(y + dy, 0), height - 1));
+    };
+}
+
+void check(int width, int height, WorkerPool* pool, uint32_t seed) {
+    const char* where = pool ? "pool" : "serial";
+    const std::vector<uint8_t> gray = test::randomBytes(static_cast<size_t>(width) * height, seed);
+    const auto sample = windowAt(width, height, [&](int x, int y) { return gray[static_cast<size_t>(y) * width + x]; });
+    const auto plane = px::plane(gray.data(), width, height, static_cast<size_t>(width));
+
+    std::vector<uint8_t> out(gray.size());
+    px::evaluate(px::dilate3x3(plane), out.data(), static_cast<size_t>(width), pool);
+    CHECK(out == reference<uint8_t>(width, height,
+                                    [&](int x, int y) {
+                                        uint8_t m = 0;
+                                        for (int dy = -1; dy <= 1; ++dy) {
+                                            for (int dx = -1; dx <= 1; ++dx) m = std::max(m, sample(x, y, dx, dy));
+                                        }
+                                        return m;
+                                    }),
+          "%dx%d %s: dilate3x3 of a plane differs", width, height, where);
+
+    std::vector<int> sums(gray.size());
+    px::evaluate(px::stencil3x3(plane, SmoothOp()), sums.data(), static_cast<size_t>(width), pool);
+    CHECK(sums == reference<int>(width, height,
+                                 [&](int x, int y) {
+                                     int sum = 0;
+                                     for (int dy = -1; dy <= 1; ++dy) {
+                                         for (int dx = -1; dx <= 1; ++dx) {
+                                             sum += (2 - dx * dx) * (2 - dy * dy) * sample(x, y, dx, dy);
+                                         }
+                                     }
+                                     return sum;
+                                 }),
+          "%dx%d %s: weighted stencil differs", width, height, where);
+
+    // Over a chain whose source cursor reuses one chunk buffer per seek.
+    const std::vector<uint8_t> rgba = test::randomBytes(static_cast<size_t>(width) * height * 4, seed + 1);
+    const auto mask = windowAt(width, height, [&](int x, int y) {
+        const uint8_t* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+        return static_cast<uint8_t>(lumaPixel(p[0], p[1], p[2]) > 128 ? 255 : 0);
+    });
+    const ImageView view{rgba.data(), width, height, width * 4, PixelFormat::RGBA};
+    px::evaluate(px::dilate3x3(px::threshold(px::luma(px::pixels<PixelFormat::RGBA>(view)), uint8_t(128))), out.data(),
+                 static_cast<size_t>(width), pool);
+    CHECK(out == reference<uint8_t>(width, height,
+                                    [&](int x, int y) {
+                                        uint8_t m = 0;
+                                        for (int dy = -1; dy <= 1; ++dy) {
+                                            for (int dx = -1; dx <= 1; ++dx) m = std::max(m, mask(x, y, dx, dy));
+                                        }
+                                        return m;
+                                    }),
+          "%dx%d %s: dilate3x3 of threshold(luma) differs", width, height, where);
+}
+
+} // namespace
+
+int main() {
+    WorkerPool pool(4);
+    uint32_t seed = 1;
+    for (int width : {1, 2, 3, 31, 255, 256, 257, 513, 600}) {
+        for (int height : {1, 2, 3, 7, 70}) {
+            check(width, height, nullptr, seed);
+            check(width, height, &pool, seed);
+            seed += 2;
+        }
+    }
+    return test::testResult();
+}
@@ -0,0 +1,140 @@
+// Reduced-resolution edges: every area row kernel the CPU supports against
+// areaRowScalar, and the factor 2 and 4 entry points against Canny run on a
+// box-averaged copy of the image (partial border blocks repeating the last
+// row and column), returned at the reduced size or upsampled
+// nearest-neighbour, at sizes that leave partial blocks on both borders.
+#include "opencv_pipeline.hpp"
+#include "pyramid.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr int kGuard = 40;
+constexpr uint8_t kCanary = 0xA5;
+constexpr double kLow = 40;
+constexpr double kHigh = 120;
+
+void checkAreaKernels() {
+    const std::vector<IsaKernel<AreaRowKernel>> kernels = areaRowKernels();
+    CHECK(!kernels.empty() && kernels.back().kernel == areaRowKernel(), "areaRowKernel is not the last supported kernel");
+
+    std::vector<int> counts;
+    for (int c = 0; c <= 80; ++c) counts.push_back(c);
+    for (int c : {127, 129, 255, 257, 481}) counts.push_back(c);
+
+    uint32_t seed = 1;
+    for (int factor : {2, 4}) {
+        for (int count : counts) {
+            const size_t width = static_cast<size_t>(count) * factor;
+            for (int fill : {-1, 0, 255}) {
+                // Random rows, or constant ones where every sum saturates.
+                std::vector<uint8_t> bytes = test::randomBytes(factor * width + 1, seed++);
+                if (fill >= 0) std::fill(bytes.begin(), bytes.end(), static_cast<uint8_t>(fill));
+                const uint8_t* rows[4];
+                for (int r = 0; r < factor; ++r) rows[r] = bytes.data() + 1 + r * width;
+
+                std::vector<uint8_t> expected(static_cast<size_t>(count) + kGuard, kCanary);
+                areaRowScalar(rows, factor, count, expected.data());
+                for (const IsaKernel<AreaRowKernel>& k : kernels) {
+                    std::vector<uint8_t> actual(static_cast<size_t>(count) + kGuard, kCanary);
+                    k.kernel(rows, factor, count, actual.data());
+                    CHECK(std::memcmp(actual.data(), expected.data(), count) == 0,
+                          "%s factor %d count %d fill %d: differs from scalar", k.isa, factor, count, fill);
+                    CHECK(std::all_of(actual.begin() + count, actual.end(), [](uint8_t b) { return b == kCanary; }),
+                          "%s factor %d count %d: writes past the row", k.isa, factor, count);
+                }
+            }
+        }
+    }
+}
+
+// Rounded block means, written out directly; blocks past the border repeat
+// the last row and column.
+std::vector<uint8_t> boxAverage(const std::vector<uint8_t>& gray, int width, int height, int factor) {
+    const int w = scaledSize(width, factor), h = scaledSize(height, factor);
+    std::vector<uint8_t> out(static_cast<size_t>(w) * h);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            int sum = 0;
+            for (int j = 0; j < factor; ++j) {
+                for (int i = 0; i < factor; ++i) {
+                    sum += gray[static_cast<size_t>(std::min(y * factor + j, height - 1)) * width +
+                                std::min(x * factor + i, width - 1)];
+                }
+            }
+            const int n = factor * factor;
+            out[static_cast<size_t>(y) * w + x] = static_cast<uint8_t>((sum + n / 2) / n);
+        }
+    }
+    return out;
+}
+
+void checkScaledEdges() {
+    uint32_t seed = 100;
+    for (const auto& size : {std::pair{37, 23}, {101, 67}, {203, 151}, {258, 97}, {7, 5}}) {
+        const int width = size.first, height = size.second;
+        const std::vector<uint8_t> gray = test::edgeImage(width, height, width, seed++);
+        std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+        for (size_t i = 0; i < gray.size(); ++i) {
+            std::fill_n(rgba.begin() + i * 4, 3, gray[i]);
+            rgba[i * 4 + 3] = 255;
+        }
+        const PlaneView luma{gray.data(), width, height, width, 1};
+        const ImageView image{rgba.data(), width, height, width * 4, PixelFormat::RGBA};
+
+        for (int factor : {2, 4}) {
+            const int w = scaledSize(width, factor), h = scaledSize(height, factor);
+            const std::vector<uint8_t> reduced = boxAverage(gray, width, height, factor);
+            std::vector<uint8_t> expected(static_cast<size_t>(w) * h);
+            size_t written = 0;
+            CHECK(processLumaEdges(PlaneView{reduced.data(), w, h, w, 1}, kLow, kHigh, expected.data(), expected.size(),
+                                   written),
+                  "%dx%d: reference Canny failed", w, h);
+            CHECK(width < 100 || std::count(expected.begin(), expected.end(), 255) > 0,
+                  "%dx%d factor %d: no edges at the reduced size", width, height, factor);
+
+            // At the reduced size.
+            std::vector<uint8_t> out(expected.size() + kGuard, kCanary);
+            CHECK(processLumaEdges(luma, kLow, kHigh, out.data(), out.size(), written, BlurParams(),
+                                   EdgeMaskFormat::Bytes, ScaleParams{factor, false}) &&
+                      written == expected.size() && std::equal(expected.begin(), expected.end(), out.begin()),
+                  "%dx%d factor %d: luma reduced mask differs", width, height, factor);
+            CHECK(processCannyEdges(image, kLow, kHigh, out.data(), out.size(), written, BlurParams(),
+                                    EdgeMaskFormat::Bytes, ScaleParams{factor, false}) &&
+                      written == expected.size() && std::equal(expected.begin(), expected.end(), out.begin()),
+                  "%dx%d factor %d: RGBA reduced mask differs", width, height, factor);
+
+            // Upsampled back to the input size, as bytes and packed.
+            std::vector<uint8_t> upsampled(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    upsampled[static_cast<size_t>(y) * width + x] = expected[static_cast<size_t>(y / factor) * w + x / factor];
+                }
+            }
+            std::vector<uint8_t> full(upsampled.size());
+            CHECK(processLumaEdges(luma, kLow, kHigh, full.data(), full.size(), written, BlurParams(),
+                                   EdgeMaskFormat::Bytes, ScaleParams{factor, true}) &&
+                      full == upsampled,
+                  "%dx%d factor %d: upsampled mask differs", width, height, factor);
+            std::vector<uint8_t> packed(requiredEdgeMaskBytes(width, height, EdgeMaskFormat::Packed), 0xFF);
+            CHECK(processLumaEdges(luma, kLow, kHigh, packed.data(), packed.size(), written, BlurParams(),
+                                   EdgeMaskFormat::Packed, ScaleParams{factor, true}),
+                  "%dx%d factor %d: packed upsample failed", width, height, factor);
+            CHECK(unpackEdgeMask(packed.data(), width, height, full.data(), full.size(), written) && full == upsampled,
+                  "%dx%d factor %d: packed upsampled mask differs", width, height, factor);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    checkAreaKernels();
+    checkScaledEdges();
+    return test::testResult();
+}
@@ -0,0 +1,191 @@
+// ROI edge paths: a FullFrame result is 0 outside every ROI and, inside
+// each, equals Canny on the ROI grown by its halo (blur radius + 2, clamped
+// to the frame), with overlapping ROIs merged. PerRoi writes one block of
+// requiredEdgeMaskBytes per ROI in list order. Both report their size to a
+// null or short buffer, and reject ROIs outside the frame.
+#include "opencv_pipeline.hpp"
+#include "test_support.hpp"
+
+#include <algorithm>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr int kWidth = 203;
+constexpr int kHeight = 151;
+constexpr int kStride = kWidth + 13;
+constexpr double kLow = 50;
+constexpr double kHigh = 150;
+
+// Overlapping pairs, corners, and strips that touch each border.
+const RoiRect kRois[] = {
+    {10, 10, 60, 40}, {40, 30, 70, 50}, {0, 0, 21, 15},   {150, 100, 53, 51},
+    {0, 120, 203, 31}, {190, 0, 13, 151}, {60, 60, 1, 1}, {45, 35, 20, 20},
+};
+constexpr size_t kRoiCount = sizeof(kRois) / sizeof(kRois[0]);
+
+RoiRect grown(const RoiRect& roi, int halo) {
+    const int x0 = std::max(0, roi.x - halo);
+    const int y0 = std::max(0, roi.y - halo);
+    const int x1 = std::min(kWidth, roi.x + roi.width + halo);
+    const int y1 = std::min(kHeight, roi.y + roi.height + halo);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+// Byte mask of `roi` alone: Canny on the grown crop, cut back to the ROI.
+std::vector<uint8_t> roiReference(const std::vector<uint8_t>& gray, const RoiRect& roi, const BlurParams& blur) {
+    const RoiRect area = grown(roi, blur.kernelSize / 2 + 2);
+    const PlaneView crop{gray.data() + static_cast<size_t>(area.y) * kStride + area.x, area.width, area.height, kStride, 1};
+    std::vector<uint8_t> cropMask(static_cast<size_t>(area.width) * area.height);
+    size_t written = 0;
+    CHECK(processLumaEdges(crop, kLow, kHigh, cropMask.data(), cropMask.size(), written, blur),
+          "crop %dx%d failed", area.width, area.height);
+    std::vector<uint8_t> mask(static_cast<size_t>(roi.width) * roi.height);
+    for (int y = 0; y < roi.height; ++y) {
+        std::copy_n(cropMask.begin() + static_cast<size_t>(roi.y - area.y + y) * area.width + (roi.x - area.x),
+                    roi.width, mask.begin() + static_cast<size_t>(y) * roi.width);
+    }
+    return mask;
+}
+
+std::vector<uint8_t> fullFrameReference(const std::vector<uint8_t>& gray, const BlurParams& blur) {
+    std::vector<uint8_t> frame(static_cast<size_t>(kWidth) * kHeight, 0);
+    for (const RoiRect& roi : kRois) {
+        const std::vector<uint8_t> mask = roiReference(gray, roi, blur);
+        for (int y = 0; y < roi.height; ++y) {
+            for (int x = 0; x < roi.width; ++x) {
+                uint8_t& out = frame[static_cast<size_t>(roi.y + y) * kWidth + roi.x + x];
+                out = std::max(out, mask[static_cast<size_t>(y) * roi.width + x]);
+            }
+        }
+    }
+    return frame;
+}
+
+std::vector<uint8_t> unpacked(const uint8_t* packed, int width, int height) {
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height);
+    size_t written = 0;
+    CHECK(unpackEdgeMask(packed, width, height, mask.data(), mask.size(), written), "unpack %dx%d failed", width, height);
+    return mask;
+}
+
+void checkFullFrame(const std::vector<uint8_t>& gray, const std::vector<uint8_t>& rgba, const BlurParams& blur) {
+    const std::vector<uint8_t> expected = fullFrameReference(gray, blur);
+    CHECK(std::count(expected.begin(), expected.end(), 255) > 0, "ksize %d: no edges inside the ROIs", blur.kernelSize);
+    const PlaneView luma{gray.data(), kWidth, kHeight, kStride, 1};
+    const ImageView image{rgba.data(), kWidth, kHeight, kWidth * 4, PixelFormat::RGBA};
+
+    std::vector<uint8_t> out(expected.size(), 77);
+    size_t written = 0;
+    CHECK(processLumaEdgesRoi(luma, kRois, kRoiCount, RoiLayout::FullFrame, kLow, kHigh, out.data(), out.size(), written,
+                              blur) &&
+              written == out.size() && out == expected,
+          "ksize %d: luma FullFrame Bytes differs", blur.kernelSize);
+
+    std::fill(out.begin(), out.end(), 77);
+    CHECK(processCannyEdgesRoi(image, kRois, kRoiCount, RoiLayout::FullFrame, kLow, kHigh, out.data(), out.size(), written,
+                               blur) &&
+              out == expected,
+          "ksize %d: RGBA FullFrame Bytes differs", blur.kernelSize);
+
+    std::vector<uint8_t> packed(requiredEdgeMaskBytes(kWidth, kHeight, EdgeMaskFormat::Packed), 0xFF);
+    CHECK(processLumaEdgesRoi(luma, kRois, kRoiCount, RoiLayout::FullFrame, kLow, kHigh, packed.data(), packed.size(),
+                              written, blur, EdgeMaskFormat::Packed) &&
+              written == packed.size() && unpacked(packed.data(), kWidth, kHeight) == expected,
+          "ksize %d: luma FullFrame Packed differs", blur.kernelSize);
+}
+
+void checkPerRoi(const std::vector<uint8_t>& gray, const BlurParams& blur) {
+    const PlaneView luma{gray.data(), kWidth, kHeight, kStride, 1};
+    for (EdgeMaskFormat format : {EdgeMaskFormat::Bytes, EdgeMaskFormat::Packed}) {
+        const int f = static_cast<int>(format);
+        size_t total = 0;
+        for (const RoiRect& roi : kRois) total += requiredEdgeMaskBytes(roi.width, roi.height, format);
+        std::vector<uint8_t> out(total, 0xFF);
+        size_t written = 0;
+        CHECK(processLumaEdgesRoi(luma, kRois, kRoiCount, RoiLayout::PerRoi, kLow, kHigh, out.data(), out.size(), written,
+                                  blur, format) &&
+                  written == total,
+              "ksize %d format %d: PerRoi wrote %zu of %zu", blur.kernelSize, f, written, total);
+
+        size_t offset = 0;
+        for (size_t i = 0; i < kRoiCount; ++i) {
+            const RoiRect& roi = kRois[i];
+            const std::vector<uint8_t> block =
+                (format == EdgeMaskFormat::Packed)
+                    ? unpacked(out.data() + offset, roi.width, roi.height)
+                    : std::vector<uint8_t>(out.begin() + offset, out.begin() + offset + static_cast<size_t>(roi.width) * roi.height);
+            CHECK(block == roiReference(gray, roi, blur), "ksize %d format %d: PerRoi block %zu differs", blur.kernelSize,
+                  f, i);
+            offset += requiredEdgeMaskBytes(roi.width, roi.height, format);
+        }
+    }
+}
+
+// A null buffer and one a byte short both report the size; the exact size
+// succeeds.
+void checkCapacityQuery(const std::vector<uint8_t>& gray) {
+    const PlaneView luma{gray.data(), kWidth, kHeight, kStride, 1};
+    for (RoiLayout layout : {RoiLayout::FullFrame, RoiLayout::PerRoi}) {
+        for (EdgeMaskFormat format : {EdgeMaskFormat::Bytes, EdgeMaskFormat::Packed, EdgeMaskFormat::Runs}) {
+            if (layout == RoiLayout::PerRoi && format == EdgeMaskFormat::Runs) continue;
+            const int l = static_cast<int>(layout), f = static_cast<int>(format);
+            size_t need = 0;
+            CHECK(!processLumaEdgesRoi(luma, kRois, kRoiCount, layout, kLow, kHigh, nullptr, 0, need, BlurParams(), format) &&
+                      need > 0,
+                  "layout %d format %d: null buffer accepted or no size", l, f);
+            std::vector<uint8_t> out(need);
+            size_t shortNeed = 0;
+            CHECK(!processLumaEdgesRoi(luma, kRois, kRoiCount, layout, kLow, kHigh, out.data(), need - 1, shortNeed,
+                                       BlurParams(), format) &&
+                      shortNeed == need,
+                  "layout %d format %d: short buffer gave %zu, need %zu", l, f, shortNeed, need);
+            size_t written = 0;
+            CHECK(processLumaEdgesRoi(luma, kRois, kRoiCount, layout, kLow, kHigh, out.data(), need, written, BlurParams(),
+                                      format) &&
+                      written == need,
+                  "layout %d format %d: exact buffer failed", l, f);
+        }
+    }
+}
+
+void checkRejected(const std::vector<uint8_t>& gray) {
+    const PlaneView luma{gray.data(), kWidth, kHeight, kStride, 1};
+    std::vector<uint8_t> out(static_cast<size_t>(kWidth) * kHeight);
+    size_t written = 1;
+    for (const RoiRect& bad : {RoiRect{-1, 0, 10, 10}, RoiRect{0, 0, 0, 10}, RoiRect{200, 0, 4, 10}, RoiRect{0, 150, 10, 2}}) {
+        written = 1;
+        CHECK(!processLumaEdgesRoi(luma, &bad, 1, RoiLayout::FullFrame, kLow, kHigh, out.data(), out.size(), written) &&
+                  written == 0,
+              "ROI (%d, %d, %d, %d) accepted", bad.x, bad.y, bad.width, bad.height);
+    }
+    CHECK(!processLumaEdgesRoi(luma, kRois, kRoiCount, RoiLayout::PerRoi, kLow, kHigh, out.data(), out.size(), written,
+                               BlurParams(), EdgeMaskFormat::Points),
+          "PerRoi accepted Points");
+    CHECK(!processLumaEdgesRoi(luma, kRois, 0, RoiLayout::FullFrame, kLow, kHigh, out.data(), out.size(), written),
+          "empty ROI list accepted");
+}
+
+} // namespace
+
+int main() {
+    const std::vector<uint8_t> gray = test::edgeImage(kWidth, kHeight, kStride, 7);
+    std::vector<uint8_t> rgba(static_cast<size_t>(kWidth) * kHeight * 4);
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            uint8_t* p = &rgba[(static_cast<size_t>(y) * kWidth + x) * 4];
+            p[0] = p[1] = p[2] = gray[static_cast<size_t>(y) * kStride + x];
+            p[3] = 255;
+        }
+    }
+
+    for (int ksize : {3, 5, 7}) {
+        const BlurParams blur{ksize, 0.0};
+        checkFullFrame(gray, rgba, blur);
+        checkPerRoi(gray, blur);
+    }
+    checkCapacityQuery(gray);
+    checkRejected(gray);
+    return test::testResult();
+}
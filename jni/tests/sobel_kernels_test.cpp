@@ -0,0 +1,101 @@
+// Every Sobel row kernel the CPU supports against sobelRowScalar, for each
+// magnitude mode and for widths that are not a multiple of any vector width.
+// Besides random rows, saturated patterns drive dx, dy and the magnitude to
+// their extremes. Elements past the row end must stay untouched.
+#include "sobel.hpp"
+#include "test_support.hpp"
+
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr int kGuard = 40;
+constexpr int16_t kGradCanary = 0x5A5A;
+constexpr int kMagCanary = 0x5A5A5A5A;
+
+constexpr SobelMagnitude kModes[] = {SobelMagnitude::None, SobelMagnitude::L1, SobelMagnitude::L2Squared};
+
+// Three rows of `width` samples, one byte in so none is vector aligned.
+struct Rows {
+    std::vector<uint8_t> bytes;
+    int width;
+    const uint8_t* row(int r) const { return bytes.data() + 1 + static_cast<size_t>(r) * width; }
+};
+
+Rows randomRows(int width, uint32_t seed) {
+    return {test::randomBytes(3 * static_cast<size_t>(width) + 1, seed), width};
+}
+
+// 0/255 stripes: vertical (pattern 0), horizontal (1) or a checkerboard (2).
+Rows saturatedRows(int width, int pattern) {
+    Rows rows{std::vector<uint8_t>(3 * static_cast<size_t>(width) + 1), width};
+    for (int r = 0; r < 3; ++r) {
+        for (int x = 0; x < width; ++x) {
+            const int on = pattern == 0 ? (x / 2) & 1 : pattern == 1 ? r == 2 : (x + r) & 1;
+            rows.bytes[1 + static_cast<size_t>(r) * width + x] = on ? 255 : 0;
+        }
+    }
+    return rows;
+}
+
+struct Output {
+    std::vector<int16_t> dx, dy;
+    std::vector<int> mag;
+    explicit Output(int width)
+        : dx(width + kGuard, kGradCanary), dy(width + kGuard, kGradCanary), mag(width + kGuard, kMagCanary) {}
+};
+
+void run(SobelRowKernel kernel, const Rows& rows, SobelMagnitude mode, Output& out) {
+    std::vector<int16_t> scratch(2 * (static_cast<size_t>(rows.width) + 2));
+    kernel(rows.row(0), rows.row(1), rows.row(2), rows.width, scratch.data(), out.dx.data(), out.dy.data(),
+           mode == SobelMagnitude::None ? nullptr : out.mag.data(), mode);
+}
+
+void compare(const IsaKernel<SobelRowKernel>& k, const Rows& rows, SobelMagnitude mode, const char* what) {
+    const int width = rows.width;
+    Output expected(width);
+    Output actual(width);
+    run(sobelRowScalar, rows, mode, expected);
+    run(k.kernel, rows, mode, actual);
+    const size_t n = static_cast<size_t>(width);
+    CHECK(std::memcmp(actual.dx.data(), expected.dx.data(), n * sizeof(int16_t)) == 0 &&
+              std::memcmp(actual.dy.data(), expected.dy.data(), n * sizeof(int16_t)) == 0,
+          "%s %s width %d mode %d: gradients differ from scalar", k.isa, what, width, static_cast<int>(mode));
+    if (mode != SobelMagnitude::None) {
+        CHECK(std::memcmp(actual.mag.data(), expected.mag.data(), n * sizeof(int)) == 0,
+              "%s %s width %d mode %d: magnitude differs from scalar", k.isa, what, width, static_cast<int>(mode));
+    }
+    bool guardIntact = true;
+    for (int i = 0; i < kGuard; ++i) {
+        guardIntact &= actual.dx[n + i] == kGradCanary && actual.dy[n + i] == kGradCanary;
+        guardIntact &= actual.mag[n + i] == kMagCanary;
+    }
+    for (size_t i = 0; mode == SobelMagnitude::None && i < n; ++i) guardIntact &= actual.mag[i] == kMagCanary;
+    CHECK(guardIntact, "%s %s width %d mode %d writes outside its outputs", k.isa, what, width, static_cast<int>(mode));
+}
+
+} // namespace
+
+int main() {
+    const std::vector<IsaKernel<SobelRowKernel>> kernels = sobelRowKernels();
+    CHECK(!kernels.empty() && kernels.back().kernel == sobelRowKernel(),
+          "sobelRowKernel is not the last supported kernel");
+
+    std::vector<int> widths;
+    for (int w = 1; w <= 80; ++w) widths.push_back(w);
+    for (int w : {95, 97, 127, 129, 255, 257, 641, 1921}) widths.push_back(w);
+
+    uint32_t seed = 1;
+    for (int width : widths) {
+        const Rows random = randomRows(width, seed++);
+        for (SobelMagnitude mode : kModes) {
+            for (const IsaKernel<SobelRowKernel>& k : kernels) {
+                compare(k, random, mode, "random");
+                for (int pattern = 0; pattern < 3; ++pattern) compare(k, saturatedRows(width, pattern), mode, "saturated");
+            }
+        }
+    }
+    return test::testResult();
+}
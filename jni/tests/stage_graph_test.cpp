@@ -0,0 +1,46 @@
+// The Pipeline schedule, with its stages on separate pool threads that
+// sleep when they run out of rows, must give the same gradient mask as the
+// Bands schedule and as a single thread, for any pool size and frame shape.
+#include "opencv_pipeline.hpp"
+#include "test_support.hpp"
+
+using namespace edgeviewer;
+
+namespace {
+
+std::vector<uint8_t> gradientEdges(const std::vector<uint8_t>& rgba, int width, int height, int kernelSize,
+                                   StageSchedule schedule) {
+    const ImageView view{rgba.data(), width, height, width * 4, PixelFormat::RGBA};
+    BlurParams blur;
+    blur.kernelSize = kernelSize;
+    std::vector<uint8_t> out(static_cast<size_t>(width) * height);
+    size_t written = 0;
+    const bool ok = processGradientEdges(view, 40.0, out.data(), out.size(), written, blur, schedule);
+    CHECK(ok && written == out.size(), "%dx%d: processGradientEdges failed", width, height);
+    return out;
+}
+
+} // namespace
+
+int main() {
+    const std::pair<int, int> sizes[] = {{1, 1}, {5, 2}, {33, 3}, {640, 17}, {640, 97}, {1000, 300}, {1920, 1080}};
+    uint32_t seed = 1;
+    for (const auto& size : sizes) {
+        const int width = size.first, height = size.second;
+        const std::vector<uint8_t> rgba = test::randomBytes(static_cast<size_t>(width) * height * 4, seed++);
+        for (int kernelSize : {1, 3, 7}) {
+            setWorkerThreadCount(1);
+            const std::vector<uint8_t> expected = gradientEdges(rgba, width, height, kernelSize, StageSchedule::Bands);
+            for (int threads : {2, 3, 5}) {
+                setWorkerThreadCount(threads);
+                for (int repeat = 0; repeat < 3; ++repeat) {
+                    CHECK(gradientEdges(rgba, width, height, kernelSize, StageSchedule::Pipeline) == expected,
+                          "%dx%d blur %d, %d threads: Pipeline differs", width, height, kernelSize, threads);
+                }
+                CHECK(gradientEdges(rgba, width, height, kernelSize, StageSchedule::Bands) == expected,
+                      "%dx%d blur %d, %d threads: Bands differs", width, height, kernelSize, threads);
+            }
+        }
+    }
+    return test::testResult();
+}
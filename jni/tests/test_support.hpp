@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Minimal harness for the host tests: a failed CHECK prints where and why,
+// and the test's main returns testResult() so ctest sees the failure.
+namespace edgeviewer::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int testResult() {
+    if (failures() != 0) std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return failures() == 0 ? 0 : 1;
+}
+
+// Bytes from a fixed seed, so a failure reproduces.
+inline std::vector<uint8_t> randomBytes(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> bytes(count);
+    for (uint8_t& b : bytes) b = static_cast<uint8_t>(byte(rng));
+    return bytes;
+}
+
+// A width x height gray image (rows `stride` bytes apart, stride >= width)
+// with real edges: a diagonal ramp broken by bright 16x16 blocks, plus a
+// little noise so thresholds land between distinct gradient levels.
+inline std::vector<uint8_t> edgeImage(int width, int height, int stride, uint32_t seed) {
+    std::vector<uint8_t> image = randomBytes(static_cast<size_t>(stride) * height, seed);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t& p = image[static_cast<size_t>(y) * stride + x];
+            const bool block = ((x / 16) + (y / 16) + static_cast<int>(seed)) % 3 == 0;
+            p = static_cast<uint8_t>((block ? 200 : (x + y) & 127) + (p & 15));
+        }
+    }
+    return image;
+}
+
+} // namespace edgeviewer::test
+
+#define CHECK(cond, ...)                                                          \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, \
+                         #cond);                                                  \
+            std::fprintf(stderr, __VA_ARGS__);                                    \
+            std::fprintf(stderr, "\n");                                           \
+            ++::edgeviewer::test::failures();                                     \
+        }                                                                         \
+    } while (0)
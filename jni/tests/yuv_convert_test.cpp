@@ -0,0 +1,75 @@
+// Every YUV row kernel the CPU supports against yuvRowToRgbaScalar, and the
+// whole convertYuv420ToRgba path against a port of the original Kotlin loop
+// for I420, NV12 and NV21 at odd sizes and padded strides.
+#include "test_support.hpp"
+#include "yuv_convert.hpp"
+#include "yuv_reference.hpp"
+
+#include <cstring>
+
+using namespace edgeviewer;
+
+namespace {
+
+constexpr uint8_t kCanary = 0xA5;
+constexpr int kGuard = 64;
+
+void checkRowKernels() {
+    const std::vector<IsaKernel<YuvRowKernel>> kernels = yuvRowKernels();
+    CHECK(!kernels.empty() && kernels.back().kernel == yuvRowKernel(),
+          "yuvRowKernel is not the last supported kernel");
+
+    std::vector<int> widths;
+    for (int w = 0; w <= 80; ++w) widths.push_back(w);
+    for (int w : {95, 96, 97, 127, 128, 129, 641, 1921}) widths.push_back(w);
+
+    uint32_t seed = 1;
+    for (int width : widths) {
+        const size_t chroma = static_cast<size_t>(width + 1) / 2;
+        // One byte in, so no row is vector aligned.
+        const std::vector<uint8_t> y = test::randomBytes(width + 1, seed++);
+        const std::vector<uint8_t> u = test::randomBytes(chroma + 1, seed++);
+        const std::vector<uint8_t> v = test::randomBytes(chroma + 1, seed++);
+        std::vector<uint8_t> expected(static_cast<size_t>(width) * 4);
+        yuvRowToRgbaScalar(y.data() + 1, u.data() + 1, v.data() + 1, expected.data(), width);
+        for (const IsaKernel<YuvRowKernel>& k : kernels) {
+            std::vector<uint8_t> out(expected.size() + kGuard, kCanary);
+            k.kernel(y.data() + 1, u.data() + 1, v.data() + 1, out.data(), width);
+            CHECK(std::memcmp(out.data(), expected.data(), expected.size()) == 0,
+                  "%s width %d differs from scalar", k.isa, width);
+            bool guardIntact = true;
+            for (int i = 0; i < kGuard; ++i) guardIntact &= out[expected.size() + i] == kCanary;
+            CHECK(guardIntact, "%s width %d writes past the row", k.isa, width);
+        }
+    }
+}
+
+void checkFrames() {
+    const char* names[] = {"I420", "NV12", "NV21"};
+    uint32_t seed = 100;
+    for (int layout = 0; layout < 3; ++layout) {
+        for (const auto& size : {std::pair{1, 1}, {2, 2}, {3, 5}, {17, 9}, {64, 48}, {333, 101}, {640, 480}}) {
+            for (int pad : {0, 7}) {
+                const test::YuvFrame frame(size.first, size.second, static_cast<test::ChromaLayout>(layout), pad, seed++);
+                const size_t bytes = static_cast<size_t>(frame.width) * frame.height * 4;
+                std::vector<uint8_t> expected(bytes);
+                test::kotlinYuv420ToRgba(frame.view(), frame.width, frame.height, expected.data());
+                std::vector<uint8_t> out(bytes);
+                size_t written = 0;
+                const bool ok = convertYuv420ToRgba(frame.view(), out.data(), out.size(), written);
+                CHECK(ok && written == bytes, "%s %dx%d pad %d: conversion failed", names[layout], frame.width,
+                      frame.height, pad);
+                CHECK(out == expected, "%s %dx%d pad %d differs from the Kotlin loop", names[layout], frame.width,
+                      frame.height, pad);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    checkRowKernels();
+    checkFrames();
+    return test::testResult();
+}
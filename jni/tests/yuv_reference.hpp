@@ -0,0 +1,89 @@
+#pragma once
+
+#include "opencv_pipeline.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace edgeviewer::test {
+
+// Direct port of the per-pixel Kotlin loop YuvUtils.yuv420ToRgba ran before
+// conversion moved to native code: every sample is fetched through its
+// plane's row and pixel strides. The reference for convertYuv420ToRgba and
+// the baseline the YUV benchmark reports speedups against.
+inline void kotlinYuv420ToRgba(const Yuv420View& in, int width, int height, uint8_t* outRgba) {
+    const int yRowStride = in.y.rowStride, yPixelStride = in.y.pixelStride;
+    const int uRowStride = in.u.rowStride, uPixelStride = in.u.pixelStride;
+    const int vRowStride = in.v.rowStride, vPixelStride = in.v.pixelStride;
+    size_t out = 0;
+    for (int j = 0; j < height; ++j) {
+        const int yRow = j * yRowStride;
+        const int uvRow = (j >> 1) * uRowStride;
+        for (int i = 0; i < width; ++i) {
+            const int y = in.y.data[yRow + i * yPixelStride];
+            const int u = in.u.data[uvRow + (i >> 1) * uPixelStride];
+            const int v = in.v.data[(j >> 1) * vRowStride + (i >> 1) * vPixelStride];
+
+            const int yf = std::max(y - 16, 0);
+            const int uf = u - 128;
+            const int vf = v - 128;
+
+            const int r = (1192 * yf + 1634 * vf) >> 10;
+            const int g = (1192 * yf - 833 * vf - 400 * uf) >> 10;
+            const int b = (1192 * yf + 2066 * uf) >> 10;
+
+            outRgba[out++] = static_cast<uint8_t>(std::clamp(r, 0, 255));
+            outRgba[out++] = static_cast<uint8_t>(std::clamp(g, 0, 255));
+            outRgba[out++] = static_cast<uint8_t>(std::clamp(b, 0, 255));
+            outRgba[out++] = 255;
+        }
+    }
+}
+
+// Chroma layouts a camera delivers.
+enum class ChromaLayout { I420, NV12, NV21 };
+
+// A random width x height YUV_420_888 frame in `layout`, each plane row
+// padded by `pad` bytes. Owns its bytes; view() points into them.
+struct YuvFrame {
+    int width = 0;
+    int height = 0;
+    ChromaLayout layout = ChromaLayout::I420;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> chroma; // U then V for I420, interleaved otherwise
+    int yRowStride = 0;
+    int chromaRowStride = 0;
+
+    YuvFrame(int w, int h, ChromaLayout l, int pad, uint32_t seed) : width(w), height(h), layout(l) {
+        const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+        yRowStride = w + pad;
+        y = randomBytes(static_cast<size_t>(yRowStride) * h, seed);
+        chromaRowStride = (l == ChromaLayout::I420 ? cw : 2 * cw) + pad;
+        const size_t planes = (l == ChromaLayout::I420) ? 2 : 1;
+        chroma = randomBytes(planes * chromaRowStride * ch, seed + 1);
+    }
+
+    Yuv420View view() const {
+        const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+        const uint8_t* c = chroma.data();
+        Yuv420View v{{y.data(), width, height, yRowStride, 1}, {}, {}};
+        switch (layout) {
+        case ChromaLayout::I420:
+            v.u = {c, cw, ch, chromaRowStride, 1};
+            v.v = {c + static_cast<size_t>(chromaRowStride) * ch, cw, ch, chromaRowStride, 1};
+            break;
+        case ChromaLayout::NV12:
+            v.u = {c, cw, ch, chromaRowStride, 2};
+            v.v = {c + 1, cw, ch, chromaRowStride, 2};
+            break;
+        case ChromaLayout::NV21:
+            v.v = {c, cw, ch, chromaRowStride, 2};
+            v.u = {c + 1, cw, ch, chromaRowStride, 2};
+            break;
+        }
+        return v;
+    }
+};
+
+} // namespace edgeviewer::test